@@ -0,0 +1,44 @@
+#pragma once
+
+#include "OOBB.h"
+
+#include <string>
+
+struct BenchmarkConfig {
+    int type = 0;                   // spinning top type as in RigidBodyFactory, 0 = all tops
+    int poses = 50;                 // random relative poses for the triangle kernel
+    int steps = 500;                // steps of the scene benchmark
+    unsigned int seed = 0;
+    std::string model = "";         // hierarchy comparison only for models whose file name contains this
+    int resolution = 32;            // cells along the longest side of the distance fields
+};
+
+// Measures the collision detection of every spinning top: the throughput of the triangle kernel on overlapping octree
+// leaves (scalar against SIMD, which also have to agree) and the time and node visits per step of a scene with
+// colliding tops, with octrees and with SAH hierarchies, each with and without the coherence cache, whether two fast
+// tops pass through each other with and without continuous collisions, the rays per second of raycasts into the
+// scene, the time per step of a pile of tops with each contact solver and how far a stack of boxes drifts with each.
+// For every model in res/models both hierarchies are compared on their size and on the node visits and time of
+// intersectWith for random poses, convex models also against GJK/EPA, and the signed distance field on its build
+// time, memory and the time of intersectDistanceFields.
+class Benchmark {
+public:
+    Benchmark(const BenchmarkConfig &config);
+
+    // Reads key=value arguments, e.g. "type=3 poses=100 steps=1000 resolution=64"
+    static bool parseArguments(int argc, char *argv[], BenchmarkConfig &config);
+
+    void run();
+
+private:
+    void benchmarkTriangleKernel(int type);
+    void benchmarkScene(int type, OOBB::SplitMethod splitMethod, bool coherence);
+    void benchmarkTunnelling(int type, bool continuous);
+    void benchmarkRaycast(int type);
+    void benchmarkPile(int type);
+    void benchmarkStack(float dt);
+    void benchmarkHierarchy(const std::string &filename);
+    void benchmarkPoses(Mesh *mesh, bool convexContacts, bool distanceFields = false);
+
+    BenchmarkConfig m_config;
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Contact.h"
+#include "Parameters.h"
 #include "RigidBody.h"
 
 #include <vector>
@@ -9,14 +10,11 @@ using namespace glm;
 
 namespace Collision {
 
-    // Coefficient of restitution
-    static float e = 0.3f;
-    
     /* Assume groud as plane at y = 0
      *
      * Precondiditon: first contact in list is the single contact point for the collision response impulse
      */
-    static void collisionResponseWithGround(RigidBody &a, std::vector<Contact> &contacts) {
+    static void collisionResponseWithGround(RigidBody &a, std::vector<Contact> &contacts, const Parameters &parameters) {
         if (contacts.size() == 0) return;
         
         vec3 org_linearMomentum = a.getLinearMomentum();
@@ -33,9 +31,10 @@ namespace Collision {
         float vrelMagnitude = dot(normal, vrel);
         // printf("vrel: %f\n", vrelMagnitude);
         
-        if (vrelMagnitude > 0.8) return;
+        if (vrelMagnitude > parameters.separatingVelocity) return;
         
         // Colliding contact
+        float e = parameters.restitution;
         float j = -(1.f+e) * dot(vrel, normal) / (1.f/a.getMass() + dot(normal, cross(a.getInertiaTensorInv() * cross(ra, normal), ra)));
         j = max(0.0f, j);
         
@@ -58,11 +57,12 @@ namespace Collision {
             
             // Torque Friction from http://ch.mathworks.com/help/physmod/simscape/ref/rotationalfriction.html
             float frictionTorque;                       // T
-            float coulombFrictionTorque = 20;           // T_C; [N*m]
-            float breakawayFrictionTorque = 25;         // T_brk; [N*m];
-            float velocityThreshold = 0.001;            // omega_th; should be between 10^-3 and 10^-5
-            float viscousFrictionCoefficient = 0.001;   // f; [N*m/(rad/s)];
-            float coefficient = 10;                     // c_v; [rad/s]
+            float coulombFrictionTorque = parameters.coulombFrictionTorque;         // T_C; [N*m]
+            float breakawayFrictionTorque = parameters.breakawayFrictionTorque;     // T_brk; [N*m];
+            float velocityThreshold = parameters.torqueVelocityThreshold;           // omega_th; should be between 10^-3 and 10^-5
+            float viscousFrictionCoefficient = parameters.viscousFrictionTorque;    // f; [N*m/(rad/s)];
+            float coefficient = parameters.torqueCoefficient;                       // c_v; [rad/s]
+            float frictionScale = parameters.frictionScale;
             
             // x
             float omega = a.getAngularVelocity().x;
@@ -72,7 +72,7 @@ namespace Collision {
             } else {
                 frictionTorque = omega * (viscousFrictionCoefficient * velocityThreshold + (coulombFrictionTorque + (breakawayFrictionTorque - coulombFrictionTorque) * exp(-coefficient * velocityThreshold))) / velocityThreshold;
             }
-            a.addTorque(0.1f * vec3(-frictionTorque / numberContacts, 0.0, 0.0));
+            a.addTorque(frictionScale * vec3(-frictionTorque / numberContacts, 0.0, 0.0));
             
             // y
             omega = a.getAngularVelocity().y;
@@ -82,7 +82,7 @@ namespace Collision {
             } else {
                 frictionTorque = omega * (viscousFrictionCoefficient * velocityThreshold + (coulombFrictionTorque + (breakawayFrictionTorque - coulombFrictionTorque) * exp(-coefficient * velocityThreshold))) / velocityThreshold;
             }
-            a.addTorque(0.1f * vec3(0, -frictionTorque / numberContacts, 0));
+            a.addTorque(frictionScale * vec3(0, -frictionTorque / numberContacts, 0));
             
             // z
             omega = a.getAngularVelocity().z;
@@ -92,15 +92,15 @@ namespace Collision {
             } else {
                 frictionTorque = omega * (viscousFrictionCoefficient * velocityThreshold + (coulombFrictionTorque + (breakawayFrictionTorque - coulombFrictionTorque) * exp(-coefficient * velocityThreshold))) / velocityThreshold;
             }
-            a.addTorque(0.1f * vec3(0, 0, -frictionTorque / numberContacts));
+            a.addTorque(frictionScale * vec3(0, 0, -frictionTorque / numberContacts));
             
             // Linear Friction from http://ch.mathworks.com/help/physmod/simscape/ref/translationalfriction.html
             float frictionForce;                // F
-            float coulombFrictionForce = 20;    // F_C; [N]
-            float breakawayFrictionForce = 25;  // F_brk; [N];
-            velocityThreshold = 0.0001;         // omega_th; should be between 10^-4 and 10^-6
-            viscousFrictionCoefficient = 20;    // f; [N/(m//s)]; default = 100;
-            coefficient = 10;                   // c_v; [s/m]
+            float coulombFrictionForce = parameters.coulombFrictionForce;       // F_C; [N]
+            float breakawayFrictionForce = parameters.breakawayFrictionForce;   // F_brk; [N];
+            velocityThreshold = parameters.forceVelocityThreshold;              // omega_th; should be between 10^-4 and 10^-6
+            viscousFrictionCoefficient = parameters.groundViscousFrictionForce; // f; [N/(m//s)]; default = 100;
+            coefficient = parameters.forceCoefficient;                          // c_v; [s/m]
             
             // x
             float v = vrel.x;
@@ -109,7 +109,7 @@ namespace Collision {
             } else {
                 frictionForce = v * (viscousFrictionCoefficient * velocityThreshold + (coulombFrictionForce + (breakawayFrictionForce - coulombFrictionForce) * exp(-coefficient * velocityThreshold))) / velocityThreshold;
             }
-            a.addForce(0.1f * vec3(-frictionForce / numberContacts, 0, 0), p/* - vec3(0, distanceGround, 0)*/);
+            a.addForce(frictionScale * vec3(-frictionForce / numberContacts, 0, 0), p/* - vec3(0, distanceGround, 0)*/);
             
             // y
             v = vrel.y;
@@ -118,7 +118,7 @@ namespace Collision {
             } else {
                 frictionForce = v * (viscousFrictionCoefficient * velocityThreshold + (coulombFrictionForce + (breakawayFrictionForce - coulombFrictionForce) * exp(-coefficient * velocityThreshold))) / velocityThreshold;
             }
-            a.addForce(0.1f * vec3(0, -frictionForce / numberContacts, 0), p/* - vec3(0, distanceGround, 0)*/);
+            a.addForce(frictionScale * vec3(0, -frictionForce / numberContacts, 0), p/* - vec3(0, distanceGround, 0)*/);
             
             // z
             v = vrel.z;
@@ -127,13 +127,14 @@ namespace Collision {
             } else {
                 frictionForce = v * (viscousFrictionCoefficient * velocityThreshold + (coulombFrictionForce + (breakawayFrictionForce - coulombFrictionForce) * exp(-coefficient * velocityThreshold))) / velocityThreshold;
             }
-            a.addForce(0.1f * vec3(0, 0, -frictionForce / numberContacts), p/* - vec3(0, distanceGround, 0)*/);
+            a.addForce(frictionScale * vec3(0, 0, -frictionForce / numberContacts), p/* - vec3(0, distanceGround, 0)*/);
         }
     }
     
-    static void collisionResponseBetween(RigidBody &a, RigidBody &b, std::vector<Contact> &contacts) {
+    // Returns the magnitude of the impulse along the normal, 0 if the bodies separate
+    static float collisionResponseBetween(RigidBody &a, RigidBody &b, std::vector<Contact> &contacts, const Parameters &parameters) {
         int numberContacts = (int)contacts.size();
-        if (numberContacts == 0) return;
+        if (numberContacts == 0) return 0;
         
         vec3 theCollisionPoint = vec3(0,0,0);
         vec3 theCollisionNormal = vec3(0,0,0);
@@ -175,14 +176,15 @@ namespace Collision {
             float vrelMagnitude = dot(normal, vrel);
             // printf("vrel: %f\n", vrelMagnitude);
         
-            if (vrelMagnitude > 0.8) {
+            if (vrelMagnitude > parameters.separatingVelocity) {
                 // printf("no impuls added\n");
-                return;
+                return 0;
             }
         
             // Colliding contact
+            float e = parameters.restitution;
             float nom = -(1.f+e) * dot(vrel, normal);
-            float denom1 = 1.f/a.getMass() + 1.f/b.getMass();
+            float denom1 = a.getInverseMass() + b.getInverseMass();     // 0 for static bodies
             float denom2 = dot(normal, cross(a.getInertiaTensorInv() * cross(ra, normal), ra));
             float denom3 = dot(normal, cross(b.getInertiaTensorInv() * cross(rb, normal), rb));
             
@@ -199,5 +201,7 @@ namespace Collision {
             a.addImpulse(collisionImpulse, point);
             b.addImpulse(-collisionImpulse, point);
         // }
+        
+        return j;
     }
 }
\ No newline at end of file
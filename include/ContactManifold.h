@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Contact.h"
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+class RigidBody;
+
+// The contacts of one pair of bodies reduced to at most four well spread points with a common normal. The points are
+// kept between the steps: a new point close to one of the last step (in the space of both bodies) continues it, so
+// the impulse applied there can be used to warm start the response.
+class ContactManifold {
+public:
+    static const int maxNumberOfPoints = 4;
+
+    struct Point {
+        glm::vec3 position;             // world space
+        glm::vec3 localOne;             // in the model space of the first body
+        glm::vec3 localTwo;             // in the model space of the second body
+        float normalImpulse;            // share of the impulse along the normal in the last step
+        glm::vec3 frictionImpulse;      // in the tangent plane in the last step, only from the ContactSolver
+        int age;                        // steps the point has been continued
+    };
+
+    ContactManifold();
+
+    // Replaces the points by the reduced contacts of this step
+    void update(const std::vector<Contact> &contacts, const RigidBody &one, const RigidBody &two);
+    void clear();
+
+    const std::vector<Point> &getPoints() const;
+    glm::vec3 getNormal() const;
+
+    // The points as contacts, all with the common normal
+    std::vector<Contact> getContacts() const;
+
+    // Shares an impulse along the normal equally between the points
+    void setNormalImpulse(float impulse);
+
+    // Impulses the ContactSolver applied at a point
+    void setImpulses(size_t point, float normalImpulse, const glm::vec3 &frictionImpulse);
+
+private:
+    std::vector<Point> m_points;
+    glm::vec3 m_normal;
+};
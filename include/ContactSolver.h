@@ -0,0 +1,99 @@
+#pragma once
+
+#include "Contact.h"
+#include "ContactManifold.h"
+#include "Parameters.h"
+#include "RigidBody.h"
+
+#include <map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+class ThreadPool;
+
+// Projected Gauss-Seidel over the contacts of all pairs of a step (sequential impulses). Every contact point keeps
+// its accumulated impulse along the normal and in the tangent plane. Each iteration corrects the relative velocity at
+// every point in turn, clamps the normal impulse to push only and the friction impulse to the Coulomb cone, and hands
+// the change to the velocities of both bodies at once, so the next point already sees it. Points continued by a
+// ContactManifold start from the impulses of the last step (warm starting), which a resting pile mostly needs again.
+// The simulation also adds the contacts with the ground, against a static body, so the support of a pile reaches
+// every body within one solve.
+//
+// With solverColouring the pairs are coloured such that no two pairs of a colour share a dynamic body. The colours
+// are solved one after the other, the pairs of one colour in parallel on the pool.
+class ContactSolver {
+public:
+    ContactSolver();
+
+    // Workers for the batches of solverColouring, not owned. Without a pool the batches are solved on the calling
+    // thread, with the same result.
+    void setPool(ThreadPool *pool);
+
+    // Contacts with the normal pointing from b toward a, as for Collision::collisionResponseBetween. The points of the
+    // manifold (if any) have to be the contacts in the same order, they get the impulses after solve.
+    void add(RigidBody &a, RigidBody &b, const std::vector<Contact> &contacts, ContactManifold *manifold, const Parameters &parameters);
+
+    // Applies the impulses to the bodies and forgets the contacts
+    void solve(const Parameters &parameters);
+    void clear();
+
+    size_t getNumberOfContacts() const; // added since the last solve
+    int getLastIterations() const;      // iterations used by the last solve
+    size_t getLastNumberOfColours() const;  // batches of the last solve, 0 without solverColouring
+
+private:
+    // velocities of a body during the iterations
+    struct SolverBody {
+        RigidBody *body;
+        bool isStatic;
+        glm::vec3 velocity;
+        glm::vec3 angularVelocity;
+        float inverseMass;
+        glm::mat3 inverseInertia;       // world space
+    };
+
+    struct Constraint {
+        size_t a;                       // SolverBody indices
+        size_t b;
+        glm::vec3 point;
+        glm::vec3 normal;
+        glm::vec3 tangents[2];
+        glm::vec3 ra;
+        glm::vec3 rb;
+        float normalMass;
+        float tangentMasses[2];
+        float targetVelocity;           // along the normal after the step, from the restitution
+        float normalImpulse;
+        float tangentImpulses[2];
+        ContactManifold *manifold;      // where the impulses are kept for the next step, nullptr if not
+        size_t manifoldPoint;
+    };
+
+    // the constraints [begin, end) of one add
+    struct Pair {
+        size_t a;
+        size_t b;
+        size_t begin;
+        size_t end;
+    };
+
+    size_t solverBody(RigidBody &body);
+    void applyImpulse(const Constraint &constraint, const glm::vec3 &impulse);
+    float effectiveMass(const Constraint &constraint, const glm::vec3 &direction);
+    float solveConstraint(Constraint &constraint, const Parameters &parameters);
+    void colourPairs();
+    float solveBatches(const Parameters &parameters);
+
+    std::vector<SolverBody> m_bodies;
+    std::map<RigidBody *, size_t> m_bodyIndices;
+    std::vector<Constraint> m_constraints;
+    std::vector<Pair> m_pairs;
+    int m_lastIterations;
+
+    // pairs sorted by colour, those of colour c are m_batchPairs[m_batchOffsets[c], m_batchOffsets[c + 1])
+    std::vector<size_t> m_batchPairs;
+    std::vector<size_t> m_batchOffsets;
+    size_t m_numberOfColours;
+    ThreadPool *m_pool;
+};
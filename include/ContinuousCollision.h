@@ -0,0 +1,40 @@
+#pragma once
+
+#include "ConvexHull.h"
+#include "Ground.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+class RigidBody;
+
+// Conservative advancement of the convex hulls: the distance of two hulls divided by the fastest speed at which any
+// of their points can approach each other is a time step after which they still do not touch. Repeating this gives
+// the time of impact. The hulls contain the meshes, so the result is safe for all shapes and exact for convex ones.
+namespace ContinuousCollision {
+    // How RigidBody::update moves a body during a step: with the velocities at its beginning
+    struct Motion {
+        glm::vec3 position;
+        glm::quat orientation;
+        glm::vec3 scale;
+        glm::vec3 linearVelocity;
+        glm::vec3 angularVelocity;
+        float radius;                   // of the hull around the position
+        const ConvexHull *hull;         // nullptr if the body has no valid hull
+
+        Motion(RigidBody &body);
+
+        glm::mat4 modelAt(float time) const;
+    };
+
+    // Time until two bodies may overlap by more than the penetration: the time of impact plus the time to move this
+    // deep at the fastest approach. maxTime if that is not before maxTime, or if they touch already, which the
+    // contacts of the step handle.
+    float timeToPenetration(const Motion &a, const Motion &b, float maxTime, float penetration);
+
+    // The same for a body and the ground. A curved ground can come closer from any direction, so its bound uses the
+    // full speed of the body.
+    float timeToGroundPenetration(const Motion &motion, const Ground &ground, float maxTime, float penetration);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Convex hull of a point cloud, built incrementally: starting with a tetrahedron, every point outside of the current
+// hull replaces the faces it can see by a fan to the horizon.
+class ConvexHull {
+public:
+    struct Face {
+        int vertex1, vertex2, vertex3;  // counter clockwise seen from outside
+        glm::vec3 normal;               // pointing outwards
+        float offset;                   // dot(normal, point) for points on the plane
+    };
+
+    ConvexHull();
+    ConvexHull(const std::vector<glm::vec3> &points);
+
+    // false if all points are (nearly) coplanar
+    bool isValid() const;
+
+    const std::vector<glm::vec3> &getVertices() const;
+    const std::vector<Face> &getFaces() const;
+
+    float getVolume() const;
+
+    // Vertex of the hull farthest in the given direction
+    glm::vec3 support(const glm::vec3 &direction) const;
+
+    // Index of the vertex farthest in the given direction, found by walking along the edges from start to ever
+    // farther neighbours. Starting at the result of the last query makes this nearly constant for small rotations.
+    int supportIndex(const glm::vec3 &direction, int start) const;
+
+    // Vertices sharing an edge with the vertex
+    const std::vector<int> &getNeighbours(int vertex) const;
+
+    // Index of the vertex in the points the hull was built from
+    int getPointIndex(int vertex) const;
+
+    // Points which are not vertices of the hull but lie on one of the faces of the vertex (within the tolerance of
+    // the build), e.g. inside a flat face, by their index in the points the hull was built from
+    const std::vector<int> &getSurfacePoints(int vertex) const;
+
+    // How far a point inside lies below the surface, negative outside
+    float depthOf(const glm::vec3 &point) const;
+
+private:
+    std::vector<glm::vec3> m_vertices;
+    std::vector<Face> m_faces;
+    std::vector<std::vector<int> > m_neighbours;
+    std::vector<int> m_pointIndices;
+    std::vector<std::vector<int> > m_surfacePoints;
+};
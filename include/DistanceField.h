@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Mesh.h"
+#include "OOBB.h"
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Signed distance to the surface of a mesh, negative inside, sampled on a grid in model space. Only blocks of 8x8x8
+// samples near the surface (the narrow band) are stored, the other blocks only remember whether they are inside or
+// outside. Built with closest triangle queries on the hierarchy of the mesh.
+class DistanceField {
+public:
+    DistanceField();
+
+    // resolution: cells along the longest side of the mesh
+    DistanceField(Mesh *mesh, OOBB *root, int resolution);
+
+    bool isValid() const;
+    int getResolution() const;
+    float getCellSize() const;
+    size_t getMemorySize() const;       // bytes of the samples and block table
+
+    // Trilinear distance at a point in model space. Outside of the band it is clamped to the band width, outside of
+    // the grid it is the distance to the grid plus the band width.
+    float distanceAt(const glm::vec3 &point) const;
+
+    // Direction in which the distance grows fastest, the outward normal on the surface
+    glm::vec3 gradientAt(const glm::vec3 &point) const;
+
+    // Grid bounds in model space
+    bool contains(const glm::vec3 &point) const;
+
+private:
+    float sampleAt(int x, int y, int z) const;
+
+    int m_resolution;
+    glm::vec3 m_lower;
+    float m_cellSize;
+    float m_bandWidth;
+    int m_numberOfSamples[3];           // per axis
+    int m_numberOfBlocks[3];
+
+    // per block the index of its first sample, or OUTSIDE / INSIDE if it is away from the surface
+    std::vector<int> m_blocks;
+    std::vector<float> m_samples;
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Heightfield.h"
+#include "Parameters.h"
+#include "RigidBody.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Settings of an ensemble: the same scene simulated many times with small random perturbations
+struct EnsembleConfig {
+    int type = 3;                   // spinning top type as in RigidBodyFactory
+    bool rotating = true;
+    bool upsidedown = false;
+
+    int runs = 100;
+    int steps = 1000;
+    float timeStep = 0.01f;
+
+    float positionJitter = 0.05f;   // max offset in x and z
+    float tiltJitter = 0.05f;       // max tilt of the initial orientation [rad]
+    float spinJitter = 0.1f;        // max relative change of the initial spin
+
+    float toppleAngle = 1.f;        // tilt of the symmetry axis (relative to the start) that counts as toppled [rad]
+    float spinThreshold = 1.f;      // spin around the symmetry axis below which the top stopped spinning [rad/s]
+
+    Parameters parameters;          // contact and friction constants
+    std::string heightfield;        // grayscale image of the ground for groundShape=4 (optional)
+    glm::vec3 heightfieldSize = glm::vec3(20, 1, 20);     // extent along x, height, extent along z
+    std::shared_ptr<const Heightfield> heightfieldData;   // loaded once from the image, shared by all runs
+    bool deterministic = false;     // see Simulation::setDeterministic
+
+    unsigned int seed = 0;
+    unsigned int threads = 0;       // 0 = all cores
+    std::string output;             // csv file with one line per run (optional)
+    std::string hashes;             // prefix of the per run state hash files, e.g. "hashes/run" (optional)
+};
+
+// Summary of a single run
+struct EnsembleResult {
+    int run;
+    float timeToTopple;             // -1 if the top did not topple
+    float spinLifetime;             // last time the top was still spinning
+    glm::vec3 finalPosition;
+    glm::quat finalOrientation;
+    float finalTilt;                // angle between the initial and final symmetry axis [rad]
+    uint64_t finalHash;             // StateHash of the last state
+};
+
+// Runs independent simulations of the same scene in parallel. All simulations share the (read-only) assets and shapes.
+class Ensemble {
+public:
+    Ensemble(const EnsembleConfig &config);
+
+    // Reads key=value arguments, e.g. "type=3 runs=1000 restitution=0.5". Returns false for unknown keys.
+    static bool parseArguments(int argc, char *argv[], EnsembleConfig &config);
+    static bool parseArgument(const std::string &key, const std::string &value, EnsembleConfig &config);
+
+    // Loads the heightfield image of the config if it has one. Returns false if it cannot be loaded.
+    static bool loadHeightfield(EnsembleConfig &config);
+
+    // Simulates a single run. Runs are independent of each other, so this can be called from any thread.
+    static EnsembleResult simulate(const EnsembleConfig &config, int run);
+
+    void run();
+
+    const std::vector<EnsembleResult> &getResults() const;
+    double getScenesPerHour() const;
+
+    void printSummary() const;
+    bool writeResults(const std::string &filename) const;
+
+private:
+    EnsembleConfig m_config;
+
+    std::vector<EnsembleResult> m_results;
+    double m_seconds;
+};
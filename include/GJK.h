@@ -0,0 +1,16 @@
+#pragma once
+
+#include "ConvexHull.h"
+
+#include <glm/glm.hpp>
+
+// Gilbert-Johnson-Keerthi distance and expanding polytope penetration of two convex hulls. Both work in the space of
+// hull b, hull a is transformed into it with aToB. Only the support functions of the hulls are used.
+namespace GJK {
+    // Distance and closest points of the hulls, 0 if they overlap
+    float distance(const ConvexHull &a, const glm::mat4 &aToB, const ConvexHull &b, glm::vec3 &pointA, glm::vec3 &pointB);
+
+    // Contact of overlapping hulls: the point between the deepest points of both hulls, the normal pointing from a
+    // toward b and the penetration depth. Returns false if they do not overlap.
+    bool penetration(const ConvexHull &a, const glm::mat4 &aToB, const ConvexHull &b, glm::vec3 &point, glm::vec3 &normal, float &depth);
+}
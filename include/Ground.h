@@ -0,0 +1,52 @@
+#pragma once
+
+#include "ConvexHull.h"
+#include "Heightfield.h"
+#include "Parameters.h"
+
+#include <glm/glm.hpp>
+
+// Implicit surface the bodies rest on, with its lowest point at the origin and symmetric around the y axis, or a
+// heightfield. Everything above the surface is free. The distance of a point is found in closed form, so a curved
+// arena costs the same per candidate vertex as the flat ground instead of a large static mesh.
+class Ground {
+public:
+    enum Type {
+        PLANE,                          // y = 0
+        BOWL,                           // lower half of a sphere with the radius, a vertical wall above its center
+        PARABOLOID,                     // y = curvature * r^2
+        CONE,                           // y = slope * r
+        HEIGHTFIELD,                    // bilinear heights of a grid, not owned by the ground
+        NUMBER_OF_TYPES
+    };
+
+    Ground();                           // the plane
+    Ground(const Parameters &parameters, const Heightfield *heightfield = nullptr);
+
+    static Ground plane();
+    static Ground bowl(float radius);
+    static Ground paraboloid(float curvature);
+    static Ground cone(float slope);
+    static Ground heightfield(const Heightfield *heightfield);
+
+    Type getType() const;
+    bool isFlat() const;
+
+    // Signed distance of a point in world space, negative below the surface, and the normal at the closest point of
+    // the surface, pointing out of the ground
+    float distanceAt(const glm::vec3 &point, glm::vec3 &normal) const;
+
+    // true if the whole box in world space lies above the surface
+    bool isAbove(const glm::vec3 &lower, const glm::vec3 &upper) const;
+
+    // Hull vertex with the smallest distance, found by walking along the edges to neighbours closer to the surface
+    // from a few starting vertices. Passing the result of the last query as start keeps the walks short.
+    int lowestVertex(const ConvexHull &hull, const glm::mat4 &model, int start, float &distance, glm::vec3 &normal) const;
+
+private:
+    Type m_type;
+    float m_radius;
+    float m_curvature;
+    float m_slope;
+    const Heightfield *m_heightfield;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Height of an uneven ground over a grid in the x-z plane, centered at the origin. Heights between the samples are
+// bilinear. A pyramid of the lowest and highest height per cell, per 2x2 cells and so on bounds the height in any
+// rectangle with at most four lookups, which rejects whole bodies above the surface.
+class Heightfield {
+public:
+    Heightfield();
+
+    // Grayscale image, black at y = 0 and white at the height. size: extent along x, height, extent along z
+    Heightfield(const std::string &filename, const glm::vec3 &size);
+
+    // heights[x + width * z]
+    Heightfield(const std::vector<float> &heights, int width, int depth, const glm::vec3 &size);
+
+    // false if there are fewer than 2x2 samples, e.g. if the image could not be loaded
+    bool isValid() const;
+
+    int getWidth() const;
+    int getDepth() const;
+    glm::vec3 getSize() const;
+
+    // Bilinear height at a point, with the normal of the bilinear patch. Outside of the grid the border continues.
+    float heightAt(float x, float z, glm::vec3 &normal) const;
+
+    // Height of a point above the surface, measured along the normal below it, negative below
+    float distanceAt(const glm::vec3 &point, glm::vec3 &normal) const;
+
+    // Bounds of the height in a rectangle of the x-z plane
+    void heightRangeIn(float lowerX, float lowerZ, float upperX, float upperZ, float &lowest, float &highest) const;
+
+private:
+    void buildPyramid();
+    float sampleAt(int x, int z) const;
+    int cellIndex(float coordinate, int axis) const;
+
+    int m_width;
+    int m_depth;
+    glm::vec3 m_size;
+    glm::vec2 m_cellSize;
+    std::vector<float> m_heights;
+
+    // per level the lowest and highest height of each node, level 0 has one node per cell, each further level one per
+    // 2x2 nodes of the level below
+    std::vector<std::vector<float> > m_lowest;
+    std::vector<std::vector<float> > m_highest;
+    std::vector<int> m_levelWidths;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "RigidBody.h"
+
+#include <deque>
+#include <vector>
+
+// States of a simulation over time: full copies of all bodies (keyframes) every few steps and whenever bodies were
+// added or removed, plus the compact RigidBodyState of every body after every step. The step records are full
+// states, not deltas to the previous step, so every step can be restored without replaying the ones before it.
+// Steps are numbered from the last reset; the oldest ones are dropped when the history gets too long.
+class History {
+public:
+    History();
+
+    void clear();
+
+    void setMaxNumberOfSteps(size_t maxNumberOfSteps);
+    void setKeyframeInterval(size_t keyframeInterval);
+
+    // Appends the state of the next step. forceKeyframe has to be set if bodies were added, removed or replaced.
+    // Returns true if the step was stored as a keyframe.
+    bool record(const std::vector<RigidBody> &state, double time, bool forceKeyframe);
+
+    // Drops the given step and all following ones
+    void erase(size_t step);
+
+    bool isEmpty() const;
+    size_t getNumberOfSteps() const;
+    size_t getFirstStep() const;
+    size_t getLastStep() const;
+
+    double getTime(size_t step) const;
+
+    // Last step at or before the given time (the first step if time is earlier)
+    size_t findStep(double time) const;
+
+    // Step of the keyframe the given step is based on
+    size_t getKeyframeStep(size_t step) const;
+
+    // Copies the keyframe of the step and applies the step's body states, independent of the distance to the keyframe
+    bool restore(size_t step, std::vector<RigidBody> &state) const;
+
+private:
+    struct Keyframe {
+        size_t step;
+        std::vector<RigidBody> state;
+    };
+
+    struct Step {
+        size_t keyframe;                        // number of the keyframe the bodies belong to
+        double time;
+        std::vector<RigidBodyState> states;
+    };
+
+    std::deque<Keyframe> m_keyframes;
+    std::deque<Step> m_steps;
+
+    size_t m_firstStep;                         // number of m_steps.front()
+    size_t m_firstKeyframe;                     // number of m_keyframes.front()
+
+    size_t m_maxNumberOfSteps;
+    size_t m_keyframeInterval;
+};
@@ -6,6 +6,7 @@
 #include "Triangle.h"
 
 #include <algorithm>
+#include <limits>
 
 #include <glm/glm.hpp>
 
@@ -48,6 +49,57 @@ namespace IntersectionTest {
         return true;
     }
     
+    // closest point on a triangle (Ericson, Real-Time Collision Detection 5.1.5), onFace if it is not on an edge
+    static glm::vec3 closestPointTriangle(const glm::vec3 &p,
+                                         const glm::vec3 &a,
+                                         const glm::vec3 &b,
+                                         const glm::vec3 &c,
+                                         bool &onFace) {
+        onFace = false;
+        
+        glm::vec3 ab = b - a;
+        glm::vec3 ac = c - a;
+        glm::vec3 ap = p - a;
+        float d1 = glm::dot(ab, ap);
+        float d2 = glm::dot(ac, ap);
+        if (d1 <= 0 && d2 <= 0) {
+            return a;
+        }
+        
+        glm::vec3 bp = p - b;
+        float d3 = glm::dot(ab, bp);
+        float d4 = glm::dot(ac, bp);
+        if (d3 >= 0 && d4 <= d3) {
+            return b;
+        }
+        
+        float vc = d1 * d4 - d3 * d2;
+        if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+            return a + d1 / (d1 - d3) * ab;
+        }
+        
+        glm::vec3 cp = p - c;
+        float d5 = glm::dot(ab, cp);
+        float d6 = glm::dot(ac, cp);
+        if (d6 >= 0 && d5 <= d6) {
+            return c;
+        }
+        
+        float vb = d5 * d2 - d1 * d6;
+        if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+            return a + d2 / (d2 - d6) * ac;
+        }
+        
+        float va = d3 * d6 - d5 * d4;
+        if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) {
+            return b + (d4 - d3) / ((d4 - d3) + (d5 - d6)) * (c - b);
+        }
+        
+        onFace = true;
+        float denominator = 1.f / (va + vb + vc);
+        return a + ab * (vb * denominator) + ac * (vc * denominator);
+    }
+    
     // http://en.wikipedia.org/wiki/Möller–Trumbore_intersection_algorithm
     static bool intersectionRayTriangle(const glm::vec3 point1,
                                         const glm::vec3 point2,
@@ -105,56 +157,24 @@ namespace IntersectionTest {
                                    glm::vec3 boxOrigin,
                                    glm::vec3 boxRadii,
                                    float * t) {
-        float tmin1 = 0.f;
-        float tmax1 = 0.f;
-        
-        if (rayDirection.x != 0.f && rayDirection.y != 0.f) {
-            tmin1 = std::max((boxOrigin.x - rayOrigin.x) / rayDirection.x, (boxOrigin.y - rayOrigin.y) / rayDirection.y);
-            tmax1 = std::min((boxOrigin.x + boxRadii.x - rayOrigin.x) / rayDirection.x, (boxOrigin.y + boxRadii.y - rayOrigin.y) / rayDirection.y);
-        }
-        
-        float tmin2 = 0.f;
-        float tmax2 = 0.f;
-        
-        if (rayDirection.z != 0.f && rayDirection.y != 0.f) {
-            tmin1 = std::max((boxOrigin.z - rayOrigin.z) / rayDirection.z, (boxOrigin.y - rayOrigin.y) / rayDirection.y);
-            tmax1 = std::min((boxOrigin.z + boxRadii.z - rayOrigin.z) / rayDirection.z, (boxOrigin.y + boxRadii.y - rayOrigin.y) / rayDirection.y);
-        }
-        
-        float tmin3 = 0.f;
-        float tmax3 = 0.f;
-        
-        if (rayDirection.x != 0.f && rayDirection.z != 0.f) {
-            tmin1 = std::max((boxOrigin.z - rayOrigin.z) / rayDirection.z, (boxOrigin.x - rayOrigin.x) / rayDirection.x);
-            tmax1 = std::min((boxOrigin.z + boxRadii.z - rayOrigin.z) / rayDirection.z, (boxOrigin.x + boxRadii.x - rayOrigin.x) / rayDirection.x);
-        }
-        
-        if (rayDirection.x != 0 && rayDirection.y != 0 && rayDirection.z != 0) {
-            *t = tmin1;
-            return (tmin1 < tmax1 && tmin2 < tmax2 && tmin3 < tmax3);
-        } else if (rayDirection.x != 0 && rayDirection.y != 0) {
-            *t = tmin1;
-            return (tmin1 < tmax1 && rayOrigin.z >= boxOrigin.z && rayOrigin.z <= boxOrigin.z + boxRadii.z);
-        } else if (rayDirection.z != 0 && rayDirection.y != 0) {
-            *t = tmin2;
-            return (tmin2 < tmax2 && rayOrigin.x >= boxOrigin.x && rayOrigin.x <= boxOrigin.x + boxRadii.x);
-        } else if (rayDirection.z != 0 && rayDirection.x != 0) {
-            *t = tmin3;
-            return (tmin3 < tmax3 && rayOrigin.y >= boxOrigin.y && rayOrigin.y <= boxOrigin.y + boxRadii.y);
-        } else if (rayDirection.x != 0) {
-            *t = std::min((boxOrigin.x - rayOrigin.x) / rayDirection.x, (boxOrigin.x + boxRadii.x - rayOrigin.x) / rayDirection.x);
-            return (rayOrigin.y >= boxOrigin.y && rayOrigin.y <= boxOrigin.y + boxRadii.y && rayOrigin.z >= boxOrigin.z && rayOrigin.z <= boxOrigin.z + boxRadii.z);
-        } else if (rayDirection.y != 0) {
-            *t = std::min((boxOrigin.y - rayOrigin.y) / rayDirection.y, (boxOrigin.y + boxRadii.y - rayOrigin.y) / rayDirection.y);
-            return (rayOrigin.x >= boxOrigin.x && rayOrigin.x <= boxOrigin.x + boxRadii.x && rayOrigin.z >= boxOrigin.z && rayOrigin.z <= boxOrigin.z + boxRadii.z);
-        } else if (rayDirection.z != 0) {
-            *t = std::min((boxOrigin.z - rayOrigin.z) / rayDirection.z, (boxOrigin.z + boxRadii.z - rayOrigin.z) / rayDirection.z);
-            return (rayOrigin.y >= boxOrigin.y && rayOrigin.y <= boxOrigin.y + boxRadii.y && rayOrigin.x >= boxOrigin.x && rayOrigin.x <= boxOrigin.x + boxRadii.x);
+        // the ray is in the box between the largest entry and the smallest exit of the three slabs
+        float tmin = -std::numeric_limits<float>::max();
+        float tmax = std::numeric_limits<float>::max();
+        
+        for (int axis = 0; axis < 3; ++axis) {
+            if (rayDirection[axis] != 0.f) {
+                float t1 = (boxOrigin[axis] - rayOrigin[axis]) / rayDirection[axis];
+                float t2 = (boxOrigin[axis] + boxRadii[axis] - rayOrigin[axis]) / rayDirection[axis];
+                tmin = std::max(tmin, std::min(t1, t2));
+                tmax = std::min(tmax, std::max(t1, t2));
+            } else if (rayOrigin[axis] < boxOrigin[axis] || rayOrigin[axis] > boxOrigin[axis] + boxRadii[axis]) {
+                // parallel to the slab and outside of it
+                return false;
+            }
         }
         
-        printf("ERROR: Ray - Box intersection got something wrong.\n\trayDirection: %f %f %f\n", rayDirection.x, rayDirection.y, rayDirection.z); // This line should never be reached.
-        
-        return false;
+        *t = tmin;
+        return tmin <= tmax && tmax >= 0.f;
     }
     
     // The box needs to be axis-aligned (AABB)
@@ -354,8 +374,8 @@ namespace IntersectionTest {
     }
     
     // output: collision point
-    static bool intersectionTriangleTriangle(Triangle one,
-                                             Triangle two,
+    static bool intersectionTriangleTriangle(const Triangle &one,
+                                             const Triangle &two,
                                              glm::vec3 &outputPoint,
                                              glm::vec3 &ouputNormal) {
         // line triangle intersection
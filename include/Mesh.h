@@ -3,13 +3,14 @@
 #include "Shader.h"
 
 #include <string>
+#include <vector>
 
 // Handles loading and rendering of model assets. (Raw models without material, textures, transformations)
 class Mesh {
 public:
     Mesh(const std::string &filename);
     Mesh(GLfloat *vertices, int numVertices);
-    Mesh() {};
+    Mesh() : m_vao(0), m_vbo(0) {};
 
     void setGeometry(GLfloat *vertices, int numVertices);
     void setNormals(GLfloat *normals, int numNormals);
@@ -22,13 +23,31 @@ public:
     GLuint getNumDistinctVertices();
     GLfloat *getNormals();
     
+    // Index of the distinct vertex of every vertex, so triangle i is indices 3i, 3i+1 and 3i+2
+    const std::vector<GLuint> &getIndices() const;
+    
+    // Distinct vertices sharing an edge with a distinct vertex, in increasing order
+    GLuint getNumNeighbours(GLuint distinctVertex) const;
+    const GLuint *getNeighbours(GLuint distinctVertex) const;
+    
+    // Vertices closer than this to an earlier distinct vertex are welded to it by meshes created afterwards. 0 (the
+    // default) welds only equal vertices.
+    static void setWeldDistance(float distance);
+    static float getWeldDistance();
+    
     void loadFromFile(const std::string &filename);
+    
+    // Uploads the vertex data, creating the buffers the first time. render does it if needed, so only meshes that
+    // are rendered need a GL context.
     void loadVBO();
     void render();
 
     void destroy();
 
 private:
+    // Welds the vertices with a spatial hash of cells twice as large as the weld distance, and collects the edges
+    void weldVertices();
+    
     GLfloat *m_vertices;           // x, y, z
     GLfloat *m_distinctVertices;   // no vertex appears twice
     GLfloat *m_normals;            // vertex normals
@@ -40,8 +59,12 @@ private:
     GLuint m_numNormals;
     GLuint m_numUVs;
     GLuint m_numColors;
+    
+    std::vector<GLuint> m_indices;              // distinct vertex of every vertex
+    std::vector<GLuint> m_neighbourOffsets;     // neighbours of distinct vertex i are m_neighbours[offsets[i]] up to offsets[i+1]
+    std::vector<GLuint> m_neighbours;
 
-    GLuint m_vao;               // vertex array object
+    GLuint m_vao;               // vertex array object, 0 until the first upload
     GLuint m_vbo;               // vertex buffer object
 
     static const GLuint m_vPosition     = 0;    // reference to the variable "vPosition" in the shader
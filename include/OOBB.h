@@ -3,17 +3,45 @@
 #include "IntersectionTest.h"
 #include "Mesh.h"
 #include "Triangle.h"
+#include "TriangleBatch.h"
 
+#include <cstdint>
+#include <string>
 #include <vector>
 
 #include <GL/gl3w.h>
 #include <glm/glm.hpp>
 
+class ThreadPool;
+
 class OOBB {
 public:
+    // How the hierarchy of a mesh is built
+    enum SplitMethod {
+        OCTREE,     // 8 equal octants per node, triangles overlapping several octants are in each of them
+        SAH         // binary, every triangle in exactly one child, bounds fitted to the triangles (surface area heuristic)
+    };
+    
     OOBB();
     OOBB(std::vector<Triangle> includedTriangles, glm::vec3 origin, glm::vec3 radii);
-    OOBB(Mesh *mesh);
+    
+    // Loaded from the cache directory if it holds the hierarchy of the same vertices, normals and build parameters,
+    // otherwise built on the build pool and written to the cache
+    OOBB(Mesh *mesh, SplitMethod splitMethod = OCTREE);
+    
+    // Always built. Octrees are built in parallel on the pool, nullptr builds them on the calling thread.
+    OOBB(Mesh *mesh, SplitMethod splitMethod, ThreadPool *pool);
+    
+    // Pool of the constructor without one, with a thread per hardware thread, created on first use
+    static ThreadPool *getBuildPool();
+    
+    // Directory of the cached hierarchies, "cache" by default and created on first use. Empty turns the cache off.
+    static void setCacheDirectory(const std::string &directory);
+    static std::string getCacheDirectory();
+    
+    // "octree" or "sah"
+    static const char *getSplitMethodName(SplitMethod splitMethod);
+    static bool parseSplitMethod(const std::string &name, SplitMethod &splitMethod);
     
     glm::vec3 getOrigin();
     glm::vec3 getRadii();
@@ -23,30 +51,59 @@ public:
     
     int getDepth();
     
-    std::vector<Triangle> getIncludedTriangles();
+    const std::vector<Triangle> &getIncludedTriangles() const;     // of a leaf, at the root of the whole mesh
+    const TriangleBatch &getTriangleBatch() const;    // the included triangles of a leaf in SIMD layout
+    const std::vector<unsigned int> &getTriangleIndices() const;    // of the included triangles in the mesh, triangle i starts at vertex 3i
     std::vector<OOBB> *getChildren();
     
+    // Nearest triangle hit by a ray closer than t (in units of the direction), in the space of the hierarchy. Returns
+    // false and leaves the arguments unchanged if there is none, else the distance, the index of the triangle in the
+    // mesh (-1 for hierarchies not built from a mesh) and the unit face normal on the side of the mesh normal.
+    bool intersectRay(const glm::vec3 &origin, const glm::vec3 &direction, float &t, int &triangle, glm::vec3 &normal) const;
+    
     void split(int depth);
+    void splitSAH(int depth);
+    
+    // The same octree as split, with the triangles passed as indices into the triangles of the root. The children are
+    // built in place, and nodes with many triangles sort them into the octants and build their children on the pool.
+    void splitOctree(const std::vector<Triangle> &triangles, const std::vector<unsigned int> &indices, int depth, ThreadPool *pool);
     
     void print(bool recursive);
     
 private:
     void setDefaults();
     
+    // false if the octree could not be built
+    bool build(Mesh *mesh, SplitMethod splitMethod, ThreadPool *pool);
+    
+    // The cache file holds the nodes in depth first order, each with its bounds, the number of children and its
+    // triangles. Reading fails on a missing file or a file of other parameters or format, and leaves this node empty.
+    bool readCache(const std::string &filename, uint64_t key);
+    void writeCache(const std::string &filename, uint64_t key);
+    void writeNodes(std::vector<char> &data);
+    bool readNodes(const char *&data, const char *end, int depth);
+    
     void calculateBoundingBox();
     
     void realPrint(int depth);
     
     void setDepths(int depth);
     
+    void buildTriangleBatches();
+    
     void setBoundingVertices();
     
+    // the ray already enters this node
+    bool intersectRay(const glm::vec3 &origin, const glm::vec3 &direction, const glm::vec3 &inverseDirection, float &t, int &triangle, glm::vec3 &normal) const;
+    
     glm::vec3 m_origin; // lower left corner
     glm::vec3 m_radii; // width, height, depth
     
     GLfloat *m_vertices = nullptr;
     
     std::vector<Triangle> m_includedTriangles;
+    std::vector<unsigned int> m_triangleIndices;
+    TriangleBatch m_triangleBatch;
     
     std::vector<OOBB> m_children;
     
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Tuning constants of the contact and friction model. Every simulation has its own copy, so they can be changed at
+// runtime and differ between simulations running in parallel.
+struct Parameters {
+    float restitution = 0.3f;                   // e; coefficient of restitution
+    float separatingVelocity = 0.8f;            // no impulse between bodies which separate faster than this
+
+    int frictionMethod = 3;                     // 0 = forced based friction; 1 = Impulse-Based Friction Model (Coulomb friction model); NYI 2 = Wikipedia; 3 = MatLab
+    float frictionCoefficient = 0.8f;           // mu of frictionMethod 1
+    float frictionScale = 0.1f;                 // scales forces and torques of frictionMethod 3
+
+    // Torque Friction from http://ch.mathworks.com/help/physmod/simscape/ref/rotationalfriction.html
+    float coulombFrictionTorque = 20;           // T_C; [N*m]
+    float breakawayFrictionTorque = 25;         // T_brk; [N*m]
+    float torqueVelocityThreshold = 0.001f;     // omega_th; should be between 10^-3 and 10^-5
+    float viscousFrictionTorque = 0.001f;       // f; [N*m/(rad/s)]
+    float torqueCoefficient = 10;               // c_v; [rad/s]
+
+    // Linear Friction from http://ch.mathworks.com/help/physmod/simscape/ref/translationalfriction.html
+    float coulombFrictionForce = 20;            // F_C; [N]
+    float breakawayFrictionForce = 25;          // F_brk; [N]
+    float forceVelocityThreshold = 0.0001f;     // omega_th; should be between 10^-4 and 10^-6
+    float viscousFrictionForce = 10;            // f; [N/(m/s)]
+    float groundViscousFrictionForce = 20;      // f of Collision::collisionResponseWithGround; [N/(m/s)]
+    float forceCoefficient = 10;                // c_v; [s/m]
+
+    int ground = 1;                             // 0 = no ground plane at y = 0, e.g. if static bodies form the floor
+    int groundShape = 0;                        // 0 = plane; 1 = spherical bowl; 2 = paraboloid; 3 = cone; all with the lowest point at the origin; 4 = heightfield of the simulation
+    float groundRadius = 20;                    // [m] radius of the bowl
+    float groundCurvature = 0.05f;              // [1/m] y = curvature * r^2 of the paraboloid
+    float groundSlope = 0.2f;                   // y = slope * r of the cone
+    int primitiveColliders = 0;                 // 1 = bodies with a primitive (sphere, box, capsule) collide in closed form instead of with their mesh
+    int convexContacts = 0;                     // 1 = a single GJK/EPA contact for two convex shapes instead of the octree descent
+    int continuousCollisions = 0;               // 1 = bodies which could hit another body or the ground within a step move in substeps
+    float maxPenetration = 0.02f;               // [m] how deep the substeps let bodies get into each other within a step
+    int contactManifold = 0;                    // 1 = reduce the contacts of a pair to at most 4 points with one normal before the response; needed for warmStarting
+    int distanceFieldContacts = 0;              // 1 = contacts from the vertices of each body in the signed distance field of the other instead of the hierarchies
+    int contactSolver = 0;                      // 0 = one averaged impulse per pair, pair by pair; 1 = sequential impulses over all contacts of the step (see ContactSolver)
+    int solverIterations = 10;                  // at most this many passes over the contacts of contactSolver=1
+    int warmStarting = 1;                       // 1 = contactSolver=1 starts from the impulses of the last step at points continued by the manifold
+    int solverColouring = 0;                    // 1 = contactSolver=1 solves batches of pairs without a common body, in parallel on the pool of Simulation::setSolverPool
+    float coherenceMargin = 0;                  // relative motion of a pair, as fraction of the size of its second body, up to which the cached front of octree leaf pairs is reused; 0 = off
+
+    // "resting contacts"
+    float sleepVelocity = 0.6f;                 // average velocity on the ground below which a body starts to rest
+    float sleepDamping = 0.7f;                  // factor on the momenta of a resting body in every step
+
+    // Access by name, e.g. for parameter sweeps. Return false for unknown names.
+    bool set(const std::string &name, float value);
+    bool get(const std::string &name, float &value) const;
+
+    static std::vector<std::string> getNames();
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Contact.h"
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+class RigidBody;
+
+// Analytic collision geometry of a body in its model space (scaled with the body). Bodies with a primitive collide in
+// closed form instead of through the triangles of their mesh.
+struct Primitive {
+    enum Type {
+        MESH,                           // no primitive, use the hierarchy of the mesh
+        SPHERE,
+        BOX,
+        CAPSULE,                        // segment along the y axis with a radius
+        NUMBER_OF_TYPES
+    };
+
+    Type type = MESH;
+    glm::vec3 center = glm::vec3(0, 0, 0);
+    float radius = 0;                   // sphere and capsule
+    glm::vec3 halfExtents = glm::vec3(0, 0, 0);     // box
+    float halfHeight = 0;               // capsule: half the length of the segment
+
+    static Primitive sphere(float radius);
+    static Primitive box(const glm::vec3 &halfExtents);
+    static Primitive capsule(float radius, float halfHeight);
+};
+
+namespace PrimitiveCollision {
+    // Contacts of two bodies with the normal pointing from one toward two, from a dispatch matrix by the pair of
+    // primitive types. Returns false if the matrix has no test for the pair, then the hierarchies have to be used.
+    bool intersect(RigidBody &one, RigidBody &two, std::vector<Contact> &contacts);
+
+    // Height of the lowest point of a primitive above y = 0 and all points at that height (e.g. the corners of a box
+    // face lying flat). Returns false for meshes.
+    bool lowestPoints(RigidBody &body, float &distance, std::vector<glm::vec3> &points);
+
+    // Points of a primitive in world space which can be its deepest point in a convex or curved surface, each as a
+    // sphere with the radius (0 for box corners). Returns false for meshes.
+    bool groundCandidates(RigidBody &body, std::vector<glm::vec3> &points, float &radius);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <limits>
+
+#include <glm/glm.hpp>
+
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 direction;    // distances along the ray are in units of its length
+    float maxDistance = std::numeric_limits<float>::max();
+};
+
+// Nearest intersection of a ray with the bodies of a simulation
+struct RayHit {
+    bool hit = false;
+    float distance = 0;     // point = origin + distance * direction
+    glm::vec3 point;
+    glm::vec3 normal;       // unit face normal, on the outside of the mesh
+    int body = -1;          // index in the current state, or in the static bodies
+    bool isStatic = false;
+    int triangle = -1;      // in the mesh of the body, triangle i starts at vertex 3i
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// A spinning top as added by Simulation::addRigidBody
+struct RegressionBody {
+    int type;
+    bool rotating;
+    bool upsidedown;
+    float xOffset;
+    float yOffset;
+};
+
+struct RegressionScene {
+    std::string name;
+    std::vector<RegressionBody> bodies;
+    int steps;
+    float timeStep;
+};
+
+struct RegressionConfig {
+    std::string directory = "regression";   // one golden file per scene, committed
+    std::string budgets;                    // ms/step of every scene, empty for the committed reference <directory>/budgets.txt
+    std::string scene;                      // only run scenes whose name contains this (optional)
+    bool record = false;                    // write the golden files and budgets instead of comparing against them
+    bool recordBudgets = false;             // only write the budgets, e.g. on a new machine
+
+    float positionTolerance = 1e-3f;        // max distance to the golden position
+    float orientationTolerance = 1e-3f;     // max angle to the golden orientation [rad]
+    float budgetTolerance = -1;             // allowed relative slowdown compared to the recorded ms/step, < 0 for the
+                                            // tolerance stored in the budget file (0.25 if it has none)
+
+    int repeats = 3;                        // timing uses the fastest repeat
+    int sampleInterval = 10;                // steps between two stored states
+};
+
+// Sampled poses of all bodies and the timing of one scene. The golden files only keep the poses and the hash, which
+// deterministic mode makes independent of the machine; the timing goes to the budget file.
+struct RegressionTrajectory {
+    int steps;
+    int sampleInterval;
+    size_t numberOfBodies;
+    std::vector<glm::vec3> positions;       // sample * numberOfBodies + body
+    std::vector<glm::quat> orientations;
+    uint64_t hash;                          // StateHash of the last state
+    float msPerStep;
+};
+
+struct RegressionResult {
+    std::string scene;
+    bool passed;
+    float positionError;
+    float orientationError;
+    float msPerStep;
+    float budget;                           // recorded ms/step, 0 if there is no budget for the scene
+    bool identical;                         // same final state hash as the golden file
+    std::string message;
+};
+
+// Runs a fixed catalogue of scenes headless and compares the trajectories and the speed against golden files.
+class Regression {
+public:
+    Regression(const RegressionConfig &config);
+
+    // Reads key=value arguments, e.g. "record=1 dir=regression scene=collision"
+    static bool parseArguments(int argc, char *argv[], RegressionConfig &config);
+
+    static std::vector<RegressionScene> getScenes();
+
+    // Returns true if all scenes passed (or were recorded)
+    bool run();
+
+    const std::vector<RegressionResult> &getResults() const;
+    void printReport() const;
+
+private:
+    RegressionTrajectory simulate(const RegressionScene &scene, int sampleInterval) const;
+    RegressionResult compare(const RegressionScene &scene, const RegressionTrajectory &trajectory, const RegressionTrajectory &golden, float budget) const;
+
+    std::string getFilename(const RegressionScene &scene) const;
+    bool readGolden(const RegressionScene &scene, RegressionTrajectory &golden) const;
+    bool writeGolden(const RegressionScene &scene, const RegressionTrajectory &trajectory) const;
+
+    std::string getBudgetsFilename() const;
+    // scene name -> ms/step, empty if the file does not exist yet. Also sets m_budgetTolerance.
+    std::map<std::string, float> readBudgets();
+    bool writeBudgets(const std::map<std::string, float> &budgets) const;
+
+    RegressionConfig m_config;
+    float m_budgetTolerance;
+
+    std::vector<RegressionResult> m_results;
+};
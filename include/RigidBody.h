@@ -2,9 +2,53 @@
 
 #include "Body.h"
 #include "Contact.h"
+#include "Ground.h"
+#include "Parameters.h"
+#include "Primitive.h"
 
+#include <cstdint>
+#include <utility>
 #include <vector>
 
+class Shape;
+
+// Everything a step changes in a RigidBody, used to store the history compactly
+struct RigidBodyState {
+    glm::vec3 position;
+    glm::quat orientation;
+    glm::vec3 linearMomentum;
+    glm::vec3 angularMomentum;
+    glm::vec3 angularVelocity;
+    glm::vec3 force;                // applied in the next step
+    glm::vec3 torque;
+    float lastVelocities[10];
+    unsigned char numberOfLastVelocities;
+    bool active;                    // false if the body is at rest
+    bool isCurrentlyActive;         // selected by the user
+    int groundVertex;               // hull vertex the next ground query starts from
+};
+
+// Work done by RigidBody::intersectWith
+struct TraversalCounters {
+    size_t nodeVisits = 0;          // box tests of two hierarchy nodes
+    size_t trianglePairs = 0;       // triangle pairs tested in overlapping leaves
+    size_t cachedTests = 0;         // tests which started from a PairCache instead of the roots
+};
+
+// What intersectWith keeps between the steps for one pair of bodies. While the bodies move less than the margin
+// relative to each other, roots which were apart by more than the margin are not tested again and the leaf pair which
+// gave the last contacts is tested before descending from the roots. Resets itself if the hierarchies change.
+struct PairCache {
+    float margin = 0;                   // fraction of the size of the second hierarchy, 0 = always start at the roots
+    
+    OOBB *one = nullptr;                // roots the cache belongs to
+    OOBB *two = nullptr;
+    
+    bool valid = false;
+    glm::mat4 transform;                // first body into the space of the second at the last descent
+    std::pair<OOBB *, OOBB *> contactLeaves = std::pair<OOBB *, OOBB *>(nullptr, nullptr);  // none if the roots were apart
+};
+
 class RigidBody : public Body {
 public:
     RigidBody(const glm::vec3 &position, const glm::quat &orientation, const glm::vec3 &scale);
@@ -12,11 +56,17 @@ public:
     RigidBody();
     
     virtual void update(float dt);
+    void update(float dt, const Parameters &parameters);
+    void update(float dt, const Parameters &parameters, const Ground &ground);
     
     virtual void setMesh(Mesh *mesh);
     void setBodyInertiaTensorInv(const glm::mat3 bodyInertiaTensorInv);
     
     OOBB *getBoundingBox();
+    Shape *getShape();
+    
+    RigidBodyState getState() const;
+    void setState(const RigidBodyState &state);
     
     void addForce(const glm::vec3 force);
     void addForce(const glm::vec3 force, const glm::vec3 position);
@@ -26,28 +76,75 @@ public:
     
     void addTorque(const glm::vec3 torque);
     
+    // Analytic collision geometry used instead of the mesh (see PrimitiveCollision), MESH by default
+    void setPrimitive(const Primitive &primitive);
+    const Primitive &getPrimitive() const;
+    
+    // A static body has infinite mass: update does not move it and impulses and forces do not change it
+    void setStatic(bool isStatic);
+    bool isStatic() const;
+    
+    // Two bodies collide if the layer bits of each are in the mask of the other, the ground collides with every body.
+    // By default a body is on layer 1 and collides with all layers.
+    void setCollisionLayer(uint32_t layer);
+    void setCollisionMask(uint32_t mask);
+    uint32_t getCollisionLayer() const;
+    uint32_t getCollisionMask() const;
+    bool collidesWith(const RigidBody &body) const;
+    
     int type; // sphere, cube, sp1, etc...
     
     bool isCurrentlyActive;
     
-    std::vector<Contact> intersectWith(RigidBody &body);
+    // Contacts with the normal pointing from this body toward the other. Two convex shapes give a single contact from
+    // GJK/EPA if convexContacts is set, everything else descends the hierarchies. With a cache, the contacts of a
+    // resting pair can come from another overlapping leaf pair than the one found first from the roots.
+    std::vector<Contact> intersectWith(RigidBody &body, bool convexContacts = true, PairCache *cache = nullptr);
+    
+    // Contacts of the vertices of each body lying inside of the distance field of the other, with the normal from
+    // the gradient of the field and the point halfway between the vertex and the surface
+    std::vector<Contact> intersectDistanceFields(RigidBody &body);
+    
+    // With contactSolver=1 update leaves the ground to the simulation, which solves these contacts together with those
+    // between the bodies. Moves the body out of the ground like update does and returns the contacts on the ground
+    // surface with its normal, empty if the body does not touch it.
+    std::vector<Contact> contactsWithGround(const Parameters &parameters, const Ground &ground);
+    
+    // Sum over all intersectWith calls of the calling thread since the last reset
+    static TraversalCounters getTraversalCounters();
+    static void resetTraversalCounters();
     
     void renderOctree();
     
     glm::mat3 getInertiaTensorInv() { return m_inertiaTensorInv; }
-    glm::vec3 getLinearMomentum() { return m_linearMomentum; }
+    glm::vec3 getLinearMomentum() const { return m_linearMomentum; }
+    glm::vec3 getAngularMomentum() const { return m_angularMomentum; }
     glm::vec3 getAngularVelocity() { return m_angularVelocity; }
     float getMass() { return m_mass; }
+    float getInverseMass() { return m_static ? 0.f : 1.f / m_mass; }
     
 private:
     bool m_active;
+    bool m_static;
+    uint32_t m_collisionLayer;
+    uint32_t m_collisionMask;
     
     void setDefaults();
     
     void printState();
     
-    float distanceToGround();
-    std::vector<glm::vec3> intersectWithGround();
+    // Ground queries in closed form for primitives, else on the hull. The scans over all distinct vertices are only
+    // used for meshes without a hull. A curved ground gives its normal at the deepest point, which is the only contact.
+    float distanceToGround(bool primitives, const Ground &ground, glm::vec3 &normal);
+    float heightOfSurface(const ConvexHull &hull, int vertex, const glm::mat4 &myModel);
+    std::vector<glm::vec3> intersectWithGround(bool primitives, const Ground &ground);
+    float deepestPointInGround(bool primitives, const Ground &ground, glm::vec3 &point, glm::vec3 &normal);
+    float distanceToGroundOfVertices();
+    std::vector<glm::vec3> intersectWithGroundOfVertices();
+    std::vector<glm::vec3> groundContacts(std::vector<glm::vec3> points);
+    
+    // "resting contacts": deactivates a body touching the ground whose average velocity is below sleepVelocity
+    void restIfSlow(const Parameters &parameters);
     
     // constant values
     //virtual mat3 getBodyInertiaTensorInv() const;  // Override for all rigid bodies: depends on shape
@@ -70,6 +167,9 @@ private:
     
     std::vector<float> m_lastVelocities;
     
+    Shape *m_shape;             // shared with all bodies using the same mesh
+    Primitive m_primitive;
+    int m_groundVertex;         // hull vertex which was the lowest (or deepest in a curved ground) in the last step
     OOBB *m_boundingBox;
     
     std::vector<Body> *octreeMeshes;
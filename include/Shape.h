@@ -0,0 +1,52 @@
+#pragma once
+
+#include "ConvexHull.h"
+#include "DistanceField.h"
+#include "Mesh.h"
+#include "OOBB.h"
+
+#include <mutex>
+
+// Collision data of a mesh. It is built once per mesh and then shared read-only by all rigid bodies using that mesh,
+// also across simulations running on different threads.
+class Shape {
+public:
+    Shape(Mesh *mesh, OOBB::SplitMethod splitMethod = OOBB::OCTREE);
+
+    Mesh *getMesh() const;
+    OOBB *getBoundingBox() const;
+    OOBB::SplitMethod getSplitMethod() const;
+
+    // Hull of the mesh vertices. The mesh counts as convex if no vertex lies deeper than 1 % of the size below the
+    // hull and the hull encloses at most 1 % more volume than the mesh.
+    const ConvexHull &getConvexHull() const;
+    bool isConvex() const;
+
+    // Signed distance field of the mesh, built on first use with the resolution set for the mesh
+    const DistanceField &getDistanceField() const;
+
+    // Returns the shape of the mesh and builds it on first use. Can be called from several threads.
+    static Shape *get(Mesh *mesh);
+    static Shape *get(Mesh *mesh, OOBB::SplitMethod splitMethod);
+
+    // Hierarchy used by get(mesh) for this mesh, or for all meshes without their own choice. Bodies which already have
+    // a shape keep it.
+    static void setSplitMethod(Mesh *mesh, OOBB::SplitMethod splitMethod);
+    static void setDefaultSplitMethod(OOBB::SplitMethod splitMethod);
+    static OOBB::SplitMethod getSplitMethodOf(Mesh *mesh);
+
+    // Cells along the longest side of the distance field of this mesh. Shapes which already built it keep theirs.
+    static void setDistanceFieldResolution(Mesh *mesh, int resolution);
+    static int getDistanceFieldResolutionOf(Mesh *mesh);
+
+private:
+    Mesh *m_mesh;
+    OOBB *m_boundingBox;
+    OOBB::SplitMethod m_splitMethod;
+
+    ConvexHull m_convexHull;
+    bool m_convex;
+
+    mutable std::once_flag m_distanceFieldBuilt;
+    mutable DistanceField m_distanceField;
+};
@@ -1,9 +1,20 @@
 #pragma once
 
+#include "ContactManifold.h"
+#include "ContactSolver.h"
 #include "DebugPoint.h"
+#include "History.h"
+#include "Parameters.h"
+#include "Ray.h"
 #include "RigidBody.h"
 #include "RigidBodyFactory.h"
 
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+
 class Simulation {
 public:
     Simulation();
@@ -11,27 +22,168 @@ public:
     void reset();
     
     std::vector<RigidBody> *getCurrentState();
-    std::vector<RigidBody> *getLastState();
+    std::vector<RigidBody> *getLastState();     // state before the current step, nullptr if unknown
     
     size_t getNumberOfStates();
+    
+    // How many states are kept for rewinding (at least 1)
+    void setMaxNumberOfStates(size_t maxNumberOfStates);
+    
+    // Steps between two full copies of all bodies in the history
+    void setKeyframeInterval(size_t keyframeInterval);
+
+    // Contact and friction constants used by this simulation
+    Parameters *getParameters();
+    void setParameters(const Parameters &parameters);
+
+    // Surface of groundShape=4, not owned by the simulation. It has to live as long as the simulation uses it.
+    void setHeightfield(const Heightfield *heightfield);
+    const Heightfield *getHeightfield();
+
+    // Processes the contacts of each pair in a fixed order, so results only depend on the input and not on the order
+    // in which the narrow phase reports them. Use together with the DETERMINISTIC build option.
+    void setDeterministic(bool deterministic);
+    bool isDeterministic();
+
+    // Workers for solverColouring, not owned, nullptr solves the batches on the calling thread
+    void setSolverPool(ThreadPool *pool);
+
+    // Hash of the state after every forward step (see StateHash), only kept with setRecordStateHashes. Enable it
+    // before the first step, the hashes are numbered from the last reset.
+    void setRecordStateHashes(bool recordStateHashes);
+    const std::vector<uint64_t> &getStateHashes();
+    bool writeStateHashes(const std::string &filename);
 
+    // Simulates the next step. After a seek, the following steps of the history are replaced.
     void forwardStep(float dt);
     void backwardStep();
     
+    // Simulated time and step since the last reset
+    double getTime();
+    size_t getCurrentStep();
+    
+    // Substeps of the continuous collision detection since the last reset
+    size_t getNumberOfSubsteps();
+    
+    // First and last time which can be restored
+    double getFirstTime();
+    double getLastTime();
+    
+    // Restores the last stored step at or before the given time (or step). Does not change the history. The contact
+    // state of the pairs (manifolds, warm starting and coherence caches) is only stored with the keyframes, so the next
+    // forwardStep replays the steps since the keyframe to continue exactly like the original run did.
+    bool seek(double time);
+    bool seekStep(size_t step);
+    
     RigidBody *getActiveRigidBody();
+    void setActiveRigidBody(int index);
     void removeActiveRigidBody();
     void toggleActiveRigidBody();
     void addRigidBody(int type, bool rotating, bool upsidedown, float xOffset, float yOffset);
     void removeAllRigidBodies();
     
+    // Environment which collides with the bodies but never moves, e.g. tables and obstacles. Static bodies are not
+    // tested against each other and are not part of the history.
+    void addStaticBody(Mesh *mesh, const glm::vec3 &position, const glm::quat &orientation, const glm::vec3 &scale);
+    void removeAllStaticBodies();
+    std::vector<RigidBody> *getStaticBodies();
+    
+    // Pair filtering, checked before the narrow phase and the continuous collision detection, so excluded pairs cost
+    // nothing per step. A body with mask 0 only collides with the ground, e.g. a preview of a top. Static bodies take
+    // their layer and mask directly (see RigidBody::setCollisionLayer).
+    void setCollisionFilter(size_t body, uint32_t layer, uint32_t mask);
+    void setPairIgnored(size_t one, size_t two, bool ignored);
+    void clearIgnoredPairs();
+    bool canCollide(size_t one, size_t two);
+    
+    // Nearest body or static body hit by the ray, not the ground. Bodies whose bounding sphere the ray misses or
+    // enters behind the nearest hit so far are skipped, the others get the ray in their space and descend their
+    // hierarchy down to the SIMD ray test of the leaves.
+    bool raycast(const Ray &ray, RayHit &hit);
+    
+    // The same hits for many rays, body by body, so each body is transformed once for all rays and its hierarchy
+    // stays in the cache
+    void raycast(const std::vector<Ray> &rays, std::vector<RayHit> &hits);
+    
     std::vector<DebugPoint> getDebugPoints();
     void showDebugPoint(DebugPoint p);
     void showDebugPoint(glm::vec3 position);
     void showDebugPoint(glm::vec3 position, glm::vec3 color);
     
 private:
-    std::vector<std::vector<RigidBody> > m_simulationStates;
+    void updateActiveRigidBody();
+    
+    // what is kept between the steps for a pair of bodies
+    struct BodyPair {
+        PairCache cache;                // only used with coherenceMargin > 0
+        ContactManifold manifold;
+    };
+    
+    // all pairs at a keyframe of the history
+    struct KeyframePairs {
+        std::map<std::pair<size_t, size_t>, BodyPair> bodyPairs;
+        std::map<std::pair<size_t, size_t>, BodyPair> staticPairs;
+        std::map<size_t, BodyPair> groundPairs;
+    };
+    
+    // moves the bodies by one step, without the history
+    void step(float dt);
+    
+    // stores the pairs if the step was recorded as keyframe, and drops those of keyframes the history no longer has
+    void recordPairs(size_t step, bool keyframe);
+    
+    // brings the pairs from the keyframe of the current step to the current step after a seek
+    void replayPairs();
+    
+    // narrow phase and response of two bodies, with contactSolver=1 the response waits for solveContacts
+    void collide(RigidBody &one, RigidBody &two, BodyPair &pair);
+    void collide(size_t i, size_t j);
+    void collideWithStaticBodies(size_t i);
+    void collideWithGround(size_t i, const Ground &ground);   // only with contactSolver=1, else update handles the ground
+    void solveContacts();
+    
+    // drops the cached pairs of a body whose filter changed, and renumbers the ignored pairs after it is removed
+    void forgetPairsOf(size_t body);
+    void removeIgnoredPairsOf(size_t body);
+    
+    // For every included body the time until it could get deeper than maxPenetration into another included body or
+    // the ground, at most maxTime
+    std::vector<float> timesToPenetration(const std::vector<bool> &included, float maxTime);
+    void updateInSubsteps(const std::vector<bool> &substepped, float dt);
+    
+    std::vector<RigidBody> m_currentState;
+    std::vector<RigidBody> m_lastState;
+    bool m_hasLastState;
+    
+    History m_history;
+    size_t m_currentStep;
+    double m_time;
+    size_t m_numberOfSubsteps;
+    bool m_structureChanged;    // bodies were added or removed since the current step was recorded
+    
     std::vector<DebugPoint> m_debugPoints;
+    std::vector<uint64_t> m_stateHashes;
+    bool m_recordStateHashes;
+    
+    Parameters m_parameters;
+    const Heightfield *m_heightfield;
+    bool m_deterministic;
+    
+    std::vector<RigidBody> m_staticBodies;
+    ContactSolver m_contactSolver;
+    RigidBody m_ground;         // static body of the ground contacts in m_contactSolver
+    
+    // by the indices of both bodies, for static bodies by the index of the body and of the static body, for the ground
+    // by the index of the body
+    std::map<std::pair<size_t, size_t>, BodyPair> m_bodyPairs;
+    std::map<std::pair<size_t, size_t>, BodyPair> m_staticPairs;
+    std::map<size_t, BodyPair> m_groundPairs;
+    
+    std::map<size_t, KeyframePairs> m_keyframePairs;   // by the step of the keyframe
+    bool m_replayPairs;         // a seek cleared the pairs, the next forwardStep has to replay them
+    
+    // by the smaller and the larger index of the bodies
+    std::set<std::pair<size_t, size_t> > m_ignoredPairs;
     
     int m_activeRigidBody;
 };
\ No newline at end of file
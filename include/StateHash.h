@@ -0,0 +1,22 @@
+#pragma once
+
+#include "RigidBody.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 64 bit hashes of simulation states to find the first step in which two runs diverge
+namespace StateHash {
+
+    // FNV-1a over the exact bits of position, orientation and momenta of all bodies
+    extern uint64_t hash(const std::vector<RigidBody> &state);
+
+    // One hash per line, in hexadecimal
+    extern bool write(const std::string &filename, const std::vector<uint64_t> &hashes);
+    extern bool read(const std::string &filename, std::vector<uint64_t> &hashes);
+
+    // Index of the first differing hash, or -1 if both sequences are equal (also in length)
+    extern long firstDivergence(const std::vector<uint64_t> &a, const std::vector<uint64_t> &b);
+
+};
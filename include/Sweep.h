@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Ensemble.h"
+
+#include <string>
+#include <vector>
+
+// Range of one parameter (see Parameters::set) in a sweep
+struct SweepRange {
+    std::string name;
+    float min;
+    float max;
+    int steps;      // grid points, including min and max
+};
+
+struct SweepConfig {
+    EnsembleConfig scene;               // scene, runs per configuration and default parameters
+    std::vector<SweepRange> ranges;
+    int samples = 0;                    // 0 = full grid over all ranges, otherwise number of random configurations
+    std::string output = "sweep.csv";
+};
+
+// Summary of all runs with one parameter configuration
+struct SweepResult {
+    Parameters parameters;
+    int toppled;
+    float meanTimeToTopple;             // over the toppled runs
+    float meanSpinLifetime;
+    float meanFinalTilt;
+    float meanFinalHeight;
+};
+
+// Simulates a scene headless for many configurations of the contact and friction parameters, all in parallel.
+class Sweep {
+public:
+    Sweep(const SweepConfig &config);
+
+    // Reads the ensemble arguments plus ranges "name=min:max:steps" and "samples=N"
+    static bool parseArguments(int argc, char *argv[], SweepConfig &config);
+
+    void run();
+
+    const std::vector<SweepResult> &getResults() const;
+    bool writeResults(const std::string &filename) const;
+
+private:
+    std::vector<Parameters> createConfigurations() const;
+
+    SweepConfig m_config;
+
+    std::vector<SweepResult> m_results;
+};
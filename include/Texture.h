@@ -8,7 +8,7 @@
 
 class Texture {
 public:
-    Texture() {};
+    Texture() : m_textureUnit(0), m_textureID(0) {};
     Texture(const std::string &texturePath);
     Texture(const std::string &xpos, const std::string &xneg, const std::string &ypos, const std::string &yneg, const std::string &zpos, const std::string &zneg);
     
@@ -24,5 +24,9 @@ private:
     
     char *readFile(const std::string &filename);
     
+    // the image is uploaded by the first use, so textures can be created without a GL context
+    void upload();
+    
+    std::string m_path;
     GLuint m_textureID;
 };
\ No newline at end of file
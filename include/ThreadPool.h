@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work stealing thread pool. Every worker owns a task queue, works on it from the back and steals from the front of
+// the other queues when it runs dry. The thread waiting in parallelFor(...) helps, so nested calls do not deadlock.
+class ThreadPool {
+public:
+    // 0 threads = one per hardware thread
+    ThreadPool(unsigned int numberOfThreads = 0);
+    ~ThreadPool();
+
+    unsigned int getNumberOfThreads() const;
+
+    // Calls task(i) for every i in [0, count) and returns once all calls are finished.
+    void parallelFor(size_t count, const std::function<void(size_t)> &task);
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()> > tasks;
+    };
+
+    void push(size_t queue, std::function<void()> task);
+    bool runPendingTask(size_t queue);
+    void workerLoop(size_t queue);
+
+    std::vector<std::thread> m_threads;
+    std::vector<std::unique_ptr<Queue> > m_queues; // one per worker plus one for outside threads
+
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    std::atomic<size_t> m_pendingTasks;
+    std::atomic<size_t> m_nextQueue;
+    bool m_stop;
+};
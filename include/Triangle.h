@@ -23,6 +23,18 @@ struct Triangle {
     
         return transformedTriangle;
     }
+    
+    // Same as above, with the normal matrix transpose(inverse(mat3(model))) computed once by the caller
+    Triangle transformWith(const glm::mat4 &model, const glm::mat3 &normalMatrix) const {
+        Triangle transformedTriangle;
+        transformedTriangle.vertex1 = glm::vec3(model * glm::vec4(vertex1.x, vertex1.y, vertex1.z, 1.f));
+        transformedTriangle.vertex2 = glm::vec3(model * glm::vec4(vertex2.x, vertex2.y, vertex2.z, 1.f));
+        transformedTriangle.vertex3 = glm::vec3(model * glm::vec4(vertex3.x, vertex3.y, vertex3.z, 1.f));
+        
+        transformedTriangle.normal = normalMatrix * normal;
+        
+        return transformedTriangle;
+    }
 
     glm::vec3 vertex1;
     glm::vec3 vertex2;
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Triangle.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Result of TriangleBatch::intersect for one triangle of the batch
+struct TriangleHit {
+    size_t index;
+    glm::vec3 point;
+    glm::vec3 normal;
+};
+
+// Triangles of an octree leaf as structure of arrays: first vertices, second vertices, edges and normals, each padded
+// to a multiple of the widest SIMD width. Intersects a triangle with 8 (AVX), 4 (SSE) or 1 (scalar) triangles at once.
+class TriangleBatch {
+public:
+    TriangleBatch();
+    TriangleBatch(const std::vector<Triangle> &triangles);
+
+    size_t size() const;
+
+    // Same points and normals as IntersectionTest::intersectionTriangleTriangle(one, triangles[index]) for every
+    // intersecting triangle, in increasing index order
+    void intersect(const Triangle &one, std::vector<TriangleHit> &hits) const;
+    void intersectScalar(const Triangle &one, std::vector<TriangleHit> &hits) const;
+
+    // Nearest triangle which IntersectionTest::intersectionRayTriangle hits closer than t (in units of the direction).
+    // Returns false and leaves t and index unchanged if there is none.
+    bool intersectRay(const glm::vec3 &origin, const glm::vec3 &direction, float &t, size_t &index) const;
+    bool intersectRayScalar(const glm::vec3 &origin, const glm::vec3 &direction, float &t, size_t &index) const;
+
+    // Instruction set and number of lanes of intersect
+    static const char *getInstructionSet();
+    static int getWidth();
+
+    enum Row {
+        V1X, V1Y, V1Z,
+        V2X, V2Y, V2Z,
+        E12X, E12Y, E12Z,   // vertex2 - vertex1
+        E13X, E13Y, E13Z,   // vertex3 - vertex1
+        E23X, E23Y, E23Z,   // vertex3 - vertex2
+        NX, NY, NZ,
+        NUMBER_OF_ROWS
+    };
+
+    const float *getRow(Row row) const;
+
+private:
+    size_t m_size;
+    size_t m_paddedSize;
+
+    std::vector<float> m_data;      // row * m_paddedSize + triangle
+};
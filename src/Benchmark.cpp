@@ -0,0 +1,541 @@
+#include "Benchmark.h"
+
+#include "IntersectionTest.h"
+#include "RigidBodyFactory.h"
+#include "Shape.h"
+#include "Simulation.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+using namespace glm;
+
+namespace {
+    const char *models[] = {
+        "res/models/cube.obj",
+        "res/models/plane.obj",
+        "res/models/skybox.obj",
+        "res/models/sphere.obj",
+        "res/models/spinningTop1.obj",
+        "res/models/spinningTop2.obj",
+        "res/models/spinningTop3.obj",
+        "res/models/spinningTop3_BottomHeavy.obj",
+        "res/models/spinningTop3_TopHeavy.obj",
+        "res/models/spinningTop4.obj",
+        "res/models/spinningTop4Bottom.obj",
+        "res/models/spinningTop4Top.obj",
+        "res/models/spinningTop5.obj",
+        "res/models/spinningTop6.obj",
+        "res/models/table.obj"
+    };
+
+    const OOBB::SplitMethod splitMethods[] = { OOBB::OCTREE, OOBB::SAH };
+
+    // Overlapping leaves of two octrees, descending like intersectOctrees but without stopping at the first contact
+    struct LeafPair {
+        OOBB *one;
+        OOBB *two;
+        size_t pose;
+    };
+
+    void collectLeafPairs(OOBB *one, OOBB *two, const mat4 &invBox2ModelMatTimesBox1ModelMat, size_t pose, std::vector<LeafPair> &pairs) {
+        if (!IntersectionTest::intersectionBoxBox(one->getOrigin(), one->getRadii(), two->getOrigin(), two->getRadii(), invBox2ModelMatTimesBox1ModelMat)) {
+            return;
+        }
+
+        std::vector<OOBB> *childrenOne = one->getChildren();
+        std::vector<OOBB> *childrenTwo = two->getChildren();
+
+        if (childrenOne->size() > 0) {
+            for (size_t i = 0; i < childrenOne->size(); ++i) {
+                collectLeafPairs(&childrenOne->at(i), two, invBox2ModelMatTimesBox1ModelMat, pose, pairs);
+            }
+        } else if (childrenTwo->size() > 0) {
+            for (size_t i = 0; i < childrenTwo->size(); ++i) {
+                collectLeafPairs(one, &childrenTwo->at(i), invBox2ModelMatTimesBox1ModelMat, pose, pairs);
+            }
+        } else {
+            LeafPair pair;
+            pair.one = one;
+            pair.two = two;
+            pair.pose = pose;
+            pairs.push_back(pair);
+        }
+    }
+
+    struct HierarchyStatistics {
+        size_t nodes = 0;
+        size_t leaves = 0;
+        size_t triangleReferences = 0;  // triangles in all leaves, the octree stores some more than once
+        int depth = 0;
+    };
+
+    void collectStatistics(OOBB *node, int depth, HierarchyStatistics &statistics) {
+        statistics.nodes++;
+        statistics.depth = std::max(statistics.depth, depth);
+
+        std::vector<OOBB> *children = node->getChildren();
+        if (children->size() == 0) {
+            statistics.leaves++;
+            statistics.triangleReferences += node->getIncludedTriangles().size();
+        }
+        for (size_t i = 0; i < children->size(); ++i) {
+            collectStatistics(&children->at(i), depth + 1, statistics);
+        }
+    }
+
+    // Random rotation and a translation of up to offset along each axis
+    void randomPose(std::mt19937 &random, float offset, quat &rotation, vec3 &translation) {
+        std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+
+        vec3 axis = vec3(uniform(random), uniform(random), uniform(random));
+        rotation = angleAxis(3.14159265f * uniform(random), length(axis) > 0 ? normalize(axis) : vec3(0, 1, 0));
+        translation = offset * vec3(uniform(random), uniform(random), uniform(random));
+    }
+
+    double secondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+Benchmark::Benchmark(const BenchmarkConfig &config) {
+    m_config = config;
+}
+
+bool Benchmark::parseArguments(int argc, char *argv[], BenchmarkConfig &config) {
+    for (int i = 0; i < argc; ++i) {
+        const char *separator = strchr(argv[i], '=');
+        if (separator == nullptr) {
+            printf("ERROR: Argument '%s' is not of the form key=value.\n", argv[i]);
+            return false;
+        }
+
+        std::string key = std::string(argv[i], separator - argv[i]);
+        std::string value = std::string(separator + 1);
+
+        if (key == "type") {
+            config.type = atoi(value.c_str());
+        } else if (key == "poses") {
+            config.poses = atoi(value.c_str());
+        } else if (key == "steps") {
+            config.steps = atoi(value.c_str());
+        } else if (key == "seed") {
+            config.seed = (unsigned int)atoi(value.c_str());
+        } else if (key == "model") {
+            config.model = value;
+        } else if (key == "resolution") {
+            config.resolution = atoi(value.c_str());
+        } else {
+            printf("ERROR: Unknown argument '%s'.\n", key.c_str());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void Benchmark::run() {
+    printf("Info: Triangle kernel uses %s (%d lanes).\n", TriangleBatch::getInstructionSet(), TriangleBatch::getWidth());
+
+    for (int type = 1; type <= 6; ++type) {
+        if (m_config.type != 0 && m_config.type != type) {
+            continue;
+        }
+
+        printf("Spinning top %d\n", type);
+        benchmarkTriangleKernel(type);
+        for (size_t i = 0; i < sizeof(splitMethods) / sizeof(splitMethods[0]); ++i) {
+            benchmarkScene(type, splitMethods[i], false);
+            benchmarkScene(type, splitMethods[i], true);
+        }
+        benchmarkTunnelling(type, false);
+        benchmarkTunnelling(type, true);
+        benchmarkRaycast(type);
+        benchmarkPile(type);
+    }
+
+    printf("Stack of boxes\n");
+    benchmarkStack(0.01f);
+    benchmarkStack(0.05f);
+
+    for (size_t i = 0; i < sizeof(models) / sizeof(models[0]); ++i) {
+        if (std::string(models[i]).find(m_config.model) != std::string::npos) {
+            benchmarkHierarchy(models[i]);
+        }
+    }
+}
+
+void Benchmark::benchmarkTriangleKernel(int type) {
+    RigidBody rb;
+    RigidBodyFactory::resetSpinningTop(rb, type, false, false, 0, 0);
+    OOBB *root = rb.getBoundingBox();
+
+    std::mt19937 random(m_config.seed);
+
+    vec3 center = root->getOrigin() + 0.5f * root->getRadii();
+    float offset = 0.5f * length(root->getRadii());
+
+    // random poses of the second copy, close enough for the octrees to overlap
+    std::vector<LeafPair> pairs = std::vector<LeafPair>();
+    std::vector<mat4> poses = std::vector<mat4>();
+    std::vector<mat3> normalPoses = std::vector<mat3>();
+
+    for (int i = 0; i < m_config.poses; ++i) {
+        quat rotation;
+        vec3 translation;
+        randomPose(random, offset, rotation, translation);
+
+        mat4 pose = translate(mat4(1.f), center + translation) * mat4_cast(rotation) * translate(mat4(1.f), -center);
+        poses.push_back(pose);
+        normalPoses.push_back(transpose(inverse(mat3(pose))));
+
+        collectLeafPairs(root, root, pose, poses.size() - 1, pairs);
+    }
+
+    // both variants test the same transformed triangles
+    std::vector<std::vector<Triangle> > trianglesOne = std::vector<std::vector<Triangle> >(pairs.size());
+    size_t trianglePairs = 0;
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        const std::vector<Triangle> &triangles = pairs[i].one->getIncludedTriangles();
+        for (size_t j = 0; j < triangles.size(); ++j) {
+            trianglesOne[i].push_back(triangles[j].transformWith(poses[pairs[i].pose], normalPoses[pairs[i].pose]));
+        }
+        trianglePairs += triangles.size() * pairs[i].two->getIncludedTriangles().size();
+    }
+
+    std::vector<TriangleHit> scalarHits = std::vector<TriangleHit>();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        const std::vector<Triangle> &trianglesTwo = pairs[i].two->getIncludedTriangles();
+        for (size_t j = 0; j < trianglesOne[i].size(); ++j) {
+            for (size_t k = 0; k < trianglesTwo.size(); ++k) {
+                TriangleHit hit;
+                if (IntersectionTest::intersectionTriangleTriangle(trianglesOne[i][j], trianglesTwo[k], hit.point, hit.normal)) {
+                    hit.index = k;
+                    scalarHits.push_back(hit);
+                }
+            }
+        }
+    }
+
+    double scalarSeconds = secondsSince(start);
+
+    std::vector<TriangleHit> batchHits = std::vector<TriangleHit>();
+    start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        const TriangleBatch &batch = pairs[i].two->getTriangleBatch();
+        for (size_t j = 0; j < trianglesOne[i].size(); ++j) {
+            batch.intersect(trianglesOne[i][j], batchHits);
+        }
+    }
+
+    double batchSeconds = secondsSince(start);
+
+    size_t mismatches = scalarHits.size() > batchHits.size() ? scalarHits.size() - batchHits.size() : batchHits.size() - scalarHits.size();
+    for (size_t i = 0; i < std::min(scalarHits.size(), batchHits.size()); ++i) {
+        if (scalarHits[i].index != batchHits[i].index || scalarHits[i].point != batchHits[i].point || scalarHits[i].normal != batchHits[i].normal) {
+            mismatches++;
+        }
+    }
+
+    printf("\ttriangle kernel: %lu leaf pairs, %lu triangle pairs, %lu hits\n", pairs.size(), trianglePairs, scalarHits.size());
+    printf("\t\tscalar: %8.2f M triangle pairs/s\n", scalarSeconds > 0 ? trianglePairs / scalarSeconds * 1e-6 : 0.0);
+    printf("\t\t%-6s: %8.2f M triangle pairs/s (%.2fx)\n", TriangleBatch::getInstructionSet(), batchSeconds > 0 ? trianglePairs / batchSeconds * 1e-6 : 0.0, batchSeconds > 0 ? scalarSeconds / batchSeconds : 0.0);
+
+    if (mismatches > 0) {
+        printf("ERROR: %lu hits of the %s kernel differ from the scalar test.\n", mismatches, TriangleBatch::getInstructionSet());
+    }
+}
+
+void Benchmark::benchmarkScene(int type, OOBB::SplitMethod splitMethod, bool coherence) {
+    // the 2x2 grid of the V key, close enough to collide
+    Shape::setDefaultSplitMethod(splitMethod);
+    Simulation simulation;
+    simulation.setMaxNumberOfStates(2);
+    simulation.getParameters()->coherenceMargin = coherence ? 0.05f : 0.f;
+    for (int i = 0; i < 2; ++i) {
+        for (int j = 0; j < 2; ++j) {
+            simulation.addRigidBody(type, true, false, 1.9f * i, 1.9f * j);
+        }
+    }
+
+    RigidBody::resetTraversalCounters();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int step = 0; step < m_config.steps; ++step) {
+        simulation.forwardStep(0.01f);
+    }
+    double seconds = secondsSince(start);
+    TraversalCounters counters = RigidBody::getTraversalCounters();
+    Shape::setDefaultSplitMethod(OOBB::OCTREE);
+
+    double steps = std::max(m_config.steps, 1);
+    printf("\tscene (4 colliding tops, %s%s): %.4f ms/step, %.1f node visits/step, %lu pair tests from the cache\n", OOBB::getSplitMethodName(splitMethod),
+           coherence ? ", coherent" : "", seconds * 1000.0 / steps, counters.nodeVisits / steps, counters.cachedTests);
+}
+
+void Benchmark::benchmarkRaycast(int type) {
+    Simulation simulation;
+    simulation.setMaxNumberOfStates(2);
+    for (int i = 0; i < 2; ++i) {
+        for (int j = 0; j < 2; ++j) {
+            simulation.addRigidBody(type, true, false, 1.9f * i, 1.9f * j);
+        }
+    }
+    simulation.forwardStep(0.01f);
+
+    // a pinhole camera in front of the tops, looking at the middle of the grid at the height they start from
+    const int raysPerSide = 256;
+    vec3 target = vec3(0, 0, 0);
+    for (size_t i = 0; i < simulation.getCurrentState()->size(); ++i) {
+        target += simulation.getCurrentState()->at(i).getPosition() / (float)simulation.getCurrentState()->size();
+    }
+    vec3 eye = target + vec3(0, 1.5f, 7.f);
+    vec3 forward = normalize(target - eye);
+    vec3 right = normalize(cross(forward, vec3(0, 1, 0)));
+    vec3 up = cross(right, forward);
+
+    std::vector<Ray> rays = std::vector<Ray>(raysPerSide * raysPerSide);
+    for (int y = 0; y < raysPerSide; ++y) {
+        for (int x = 0; x < raysPerSide; ++x) {
+            float u = (x + 0.5f) / raysPerSide - 0.5f;
+            float v = (y + 0.5f) / raysPerSide - 0.5f;
+            rays[x + raysPerSide * y].origin = eye;
+            rays[x + raysPerSide * y].direction = normalize(forward + 0.5f * u * right + 0.5f * v * up);
+        }
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<RayHit> singleHits = std::vector<RayHit>(rays.size());
+    for (size_t i = 0; i < rays.size(); ++i) {
+        simulation.raycast(rays[i], singleHits[i]);
+    }
+    double singleSeconds = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    std::vector<RayHit> batchHits;
+    simulation.raycast(rays, batchHits);
+    double batchSeconds = secondsSince(start);
+
+    size_t hits = 0;
+    size_t mismatches = 0;
+    for (size_t i = 0; i < rays.size(); ++i) {
+        hits += singleHits[i].hit ? 1 : 0;
+        if (singleHits[i].hit != batchHits[i].hit || singleHits[i].distance != batchHits[i].distance || singleHits[i].triangle != batchHits[i].triangle) {
+            mismatches++;
+        }
+    }
+
+    printf("\traycast (%lu rays, %lu hits): %.2f Mrays/s one at a time, %.2f Mrays/s batched, %lu mismatches\n", rays.size(), hits,
+           rays.size() / singleSeconds / 1e6, rays.size() / batchSeconds / 1e6, mismatches);
+}
+
+void Benchmark::benchmarkPile(int type) {
+    // a grid of tops as close as in the scene benchmark, so every top touches its neighbours
+    const int topsPerSide = 8;
+    const int steps = std::min(m_config.steps, 100);
+    ThreadPool pool;
+
+    const char *names[] = { "pair by pair", "sequential impulses", "coloured batches", "coloured batches on the pool" };
+    uint64_t colouredHash = 0;
+    for (int solver = 0; solver < 4; ++solver) {
+        Simulation simulation;
+        simulation.setMaxNumberOfStates(2);
+        simulation.getParameters()->contactManifold = 1;
+        simulation.getParameters()->contactSolver = solver > 0 ? 1 : 0;
+        simulation.getParameters()->solverColouring = solver > 1 ? 1 : 0;
+        simulation.setSolverPool(solver == 3 ? &pool : nullptr);
+        simulation.setRecordStateHashes(true);
+        for (int i = 0; i < topsPerSide; ++i) {
+            for (int j = 0; j < topsPerSide; ++j) {
+                simulation.addRigidBody(type, true, false, 1.9f * i, 1.9f * j);
+            }
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int step = 0; step < steps; ++step) {
+            simulation.forwardStep(0.01f);
+        }
+        double seconds = secondsSince(start);
+
+        // the batches share no body, so the pool has to give exactly the same states
+        uint64_t hash = simulation.getStateHashes().empty() ? 0 : simulation.getStateHashes().back();
+        if (solver == 2) {
+            colouredHash = hash;
+        }
+        printf("\tpile (%d tops, %s): %.4f ms/step%s\n", topsPerSide * topsPerSide, names[solver], seconds * 1000.0 / std::max(steps, 1),
+               solver == 3 ? (hash == colouredHash ? ", same states as on one thread" : ", DIFFERENT states than on one thread") : "");
+    }
+}
+
+void Benchmark::benchmarkStack(float dt) {
+    // five cubes of 2 m resting on each other on the ground, for two seconds
+    const int boxes = 5;
+    const int steps = (int)(2.f / dt);
+
+    const char *names[] = { "pair by pair", "sequential impulses without warm starting", "sequential impulses with warm starting" };
+    for (int solver = 0; solver < 3; ++solver) {
+        Simulation simulation;
+        simulation.setMaxNumberOfStates(2);
+        simulation.getParameters()->contactManifold = 1;
+        simulation.getParameters()->contactSolver = solver > 0 ? 1 : 0;
+        simulation.getParameters()->warmStarting = solver > 1 ? 1 : 0;
+
+        std::vector<vec3> start = std::vector<vec3>();
+        for (int i = 0; i < boxes; ++i) {
+            simulation.addRigidBody(9, false, false, 0, 0);
+            start.push_back(vec3(0.f, 1.f + 2.f * i, 0.f));
+            simulation.getCurrentState()->back().setPosition(start.back());
+        }
+
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        for (int step = 0; step < steps; ++step) {
+            simulation.forwardStep(dt);
+        }
+        double seconds = secondsSince(begin);
+
+        // a stack at rest stays where it was put
+        std::vector<RigidBody> *bodies = simulation.getCurrentState();
+        float drift = 0;
+        for (int i = 0; i < boxes; ++i) {
+            drift = std::max(drift, length(bodies->at(i).getPosition() - start[i]));
+        }
+        float top = bodies->back().getPosition().y;
+        printf("\tstack (%d boxes, %.2f s steps, %s): drift %.4f m, top box at %.3f m of %.3f m%s, %.4f ms/step\n", boxes, dt, names[solver],
+               drift, top, start.back().y, top > start.back().y - 1 ? "" : " (COLLAPSED)", seconds * 1000.0 / std::max(steps, 1));
+    }
+}
+
+void Benchmark::benchmarkTunnelling(int type, bool continuous) {
+    // two tops 6 m apart shot at each other, each moves 5 m per step, so one step takes them past each other
+    const float speed = 100;
+    const float dt = 0.05f;
+    const int steps = 10;
+
+    Simulation simulation;
+    simulation.setMaxNumberOfStates(2);
+    simulation.getParameters()->continuousCollisions = continuous ? 1 : 0;
+    simulation.addRigidBody(type, false, false, -3, 0);
+    simulation.addRigidBody(type, false, false, 3, 0);
+
+    std::vector<RigidBody> *bodies = simulation.getCurrentState();
+    bodies->at(0).addImpulse(bodies->at(0).getMass() * vec3(speed, 0, 0));
+    bodies->at(1).addImpulse(bodies->at(1).getMass() * vec3(-speed, 0, 0));
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int step = 0; step < steps; ++step) {
+        simulation.forwardStep(dt);
+    }
+    double seconds = secondsSince(start);
+
+    bool passed = bodies->at(0).getPosition().x > bodies->at(1).getPosition().x;
+    printf("\ttunnelling (2 tops at %.0f m/s, %.2f s steps%s): %s, %lu substeps, %.4f ms/step\n", speed, dt, continuous ? ", continuous" : "",
+           passed ? "passed through" : "bounced", simulation.getNumberOfSubsteps(), seconds * 1000.0 / steps);
+}
+
+void Benchmark::benchmarkHierarchy(const std::string &filename) {
+    // the shapes refer to the mesh, so it has to live as long as the program
+    Mesh *mesh = new Mesh(filename);
+    printf("Model %s (%u triangles)\n", filename.c_str(), mesh->getNumVertices() / 9);
+
+    for (size_t i = 0; i < sizeof(splitMethods) / sizeof(splitMethods[0]); ++i) {
+        OOBB::SplitMethod splitMethod = splitMethods[i];
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Shape *shape = Shape::get(mesh, splitMethod);
+        double buildSeconds = secondsSince(start);
+
+        HierarchyStatistics statistics = HierarchyStatistics();
+        collectStatistics(shape->getBoundingBox(), 0, statistics);
+
+        printf("\t%-6s: %lu nodes, %lu leaves, depth %d, %lu triangles in leaves, built in %.2f ms\n", OOBB::getSplitMethodName(splitMethod),
+               statistics.nodes, statistics.leaves, statistics.depth, statistics.triangleReferences, buildSeconds * 1000.0);
+
+        Shape::setSplitMethod(mesh, splitMethod);
+        benchmarkPoses(mesh, false);
+    }
+
+    // the octree alone, on the calling thread and on the build pool
+    std::chrono::steady_clock::time_point buildStart = std::chrono::steady_clock::now();
+    OOBB serialTree = OOBB(mesh, OOBB::OCTREE, nullptr);
+    double serialSeconds = secondsSince(buildStart);
+
+    buildStart = std::chrono::steady_clock::now();
+    OOBB parallelTree = OOBB(mesh, OOBB::OCTREE, OOBB::getBuildPool());
+    double parallelSeconds = secondsSince(buildStart);
+
+    printf("\t%-6s: built in %.2f ms on one thread, %.2f ms on %u threads\n", "octree", serialSeconds * 1000.0, parallelSeconds * 1000.0,
+           OOBB::getBuildPool()->getNumberOfThreads());
+
+    // the shapes above wrote the cache file unless the cache is off
+    if (!OOBB::getCacheDirectory().empty()) {
+        buildStart = std::chrono::steady_clock::now();
+        OOBB cachedTree = OOBB(mesh, OOBB::OCTREE);
+        printf("\t%-6s: loaded from the cache in %.2f ms\n", "octree", secondsSince(buildStart) * 1000.0);
+    }
+
+    Shape *shape = Shape::get(mesh, OOBB::OCTREE);
+    const ConvexHull &hull = shape->getConvexHull();
+    printf("\t%-6s: %lu vertices, %lu faces, %s\n", "hull", hull.getVertices().size(), hull.getFaces().size(), shape->isConvex() ? "convex" : "not convex");
+    if (shape->isConvex()) {
+        benchmarkPoses(mesh, true);
+    }
+
+    // the bodies of the poses use this shape and its field
+    Shape::setSplitMethod(mesh, OOBB::OCTREE);
+    Shape::setDistanceFieldResolution(mesh, m_config.resolution);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const DistanceField &field = shape->getDistanceField();
+    double buildSeconds = secondsSince(start);
+    printf("\t%-6s: resolution %d, %.1f KiB, built in %.2f ms\n", "sdf", field.getResolution(), field.getMemorySize() / 1024.0, buildSeconds * 1000.0);
+    benchmarkPoses(mesh, false, true);
+}
+
+void Benchmark::benchmarkPoses(Mesh *mesh, bool convexContacts, bool distanceFields) {
+    RigidBody one;
+    one.setMesh(mesh);
+    RigidBody two;
+    two.setMesh(mesh);
+
+    // the second body at the same random poses for every variant
+    OOBB *root = one.getBoundingBox();
+    vec3 center = root->getOrigin() + 0.5f * root->getRadii();
+    float offset = 0.5f * length(root->getRadii());
+
+    std::mt19937 random(m_config.seed);
+    TraversalCounters counters = TraversalCounters();
+    size_t contacts = 0;
+    int posesInContact = 0;
+    double seconds = 0;
+
+    for (int pose = 0; pose < m_config.poses; ++pose) {
+        quat rotation;
+        vec3 translation;
+        randomPose(random, offset, rotation, translation);
+
+        // rotate around the center of the hierarchy
+        two.setOrientation(rotation);
+        two.setPosition(center + translation - rotation * center);
+
+        RigidBody::resetTraversalCounters();
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::vector<Contact> poseContacts = distanceFields ? one.intersectDistanceFields(two) : one.intersectWith(two, convexContacts);
+        seconds += secondsSince(start);
+
+        TraversalCounters poseCounters = RigidBody::getTraversalCounters();
+        counters.nodeVisits += poseCounters.nodeVisits;
+        counters.trianglePairs += poseCounters.trianglePairs;
+        contacts += poseContacts.size();
+        posesInContact += poseContacts.size() > 0 ? 1 : 0;
+    }
+
+    double poses = std::max(m_config.poses, 1);
+    printf("\t\t%10.1f node visits, %10.1f triangle pairs, %8.2f us per pose (%d of %d poses in contact, %lu contacts)\n",
+           counters.nodeVisits / poses, counters.trianglePairs / poses, seconds * 1e6 / poses, posesInContact, m_config.poses, contacts);
+}
@@ -0,0 +1,191 @@
+#include "ContactManifold.h"
+
+#include "RigidBody.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace glm;
+
+namespace {
+    const float matchDistance = 0.02f;      // [m] a new point this close to a point of the last step on both bodies continues it
+    const float minimumSpread = 0.0001f;    // [m] closer points count as the same
+
+    vec3 inPlane(const vec3 &v, const vec3 &normal) {
+        return v - dot(v, normal) * normal;
+    }
+
+    // twice the area of the triangle seen along the normal, positive if counter clockwise
+    float signedArea(const vec3 &a, const vec3 &b, const vec3 &c, const vec3 &normal) {
+        return dot(cross(b - a, c - a), normal);
+    }
+}
+
+ContactManifold::ContactManifold() {
+    m_normal = vec3(0, 1, 0);
+}
+
+void ContactManifold::update(const std::vector<Contact> &contacts, const RigidBody &one, const RigidBody &two) {
+    std::vector<Point> lastPoints = std::vector<Point>();
+    lastPoints.swap(m_points);
+
+    if (contacts.size() == 0) {
+        return;
+    }
+
+    // a triangle pair reports the normal of either triangle, so all are turned to the side of their sum first
+    vec3 reference = vec3(0, 0, 0);
+    for (size_t i = 0; i < contacts.size(); ++i) {
+        reference += contacts[i].n;
+    }
+    if (length(reference) == 0) {
+        reference = contacts[0].n;
+    }
+
+    vec3 normal = vec3(0, 0, 0);
+    for (size_t i = 0; i < contacts.size(); ++i) {
+        normal += dot(contacts[i].n, reference) < 0 ? -contacts[i].n : contacts[i].n;
+    }
+    m_normal = length(normal) > 0 ? normalize(normal) : contacts[0].n;
+
+    // the point farthest from the center, the point farthest from it, the point spanning the largest triangle with both
+    // and the point adding the most area outside of that triangle
+    vec3 center = vec3(0, 0, 0);
+    for (size_t i = 0; i < contacts.size(); ++i) {
+        center += contacts[i].p;
+    }
+    center *= 1.f / (float)contacts.size();
+
+    std::vector<size_t> chosen = std::vector<size_t>();
+
+    size_t first = 0;
+    float firstDistance = -1;
+    for (size_t i = 0; i < contacts.size(); ++i) {
+        float distance = length(inPlane(contacts[i].p - center, m_normal));
+        if (distance > firstDistance) {
+            first = i;
+            firstDistance = distance;
+        }
+    }
+    chosen.push_back(first);
+
+    size_t second = 0;
+    float secondDistance = minimumSpread;
+    for (size_t i = 0; i < contacts.size(); ++i) {
+        float distance = length(inPlane(contacts[i].p - contacts[first].p, m_normal));
+        if (distance > secondDistance) {
+            second = i;
+            secondDistance = distance;
+        }
+    }
+
+    if (secondDistance > minimumSpread) {
+        chosen.push_back(second);
+
+        size_t third = 0;
+        float thirdArea = 0;
+        for (size_t i = 0; i < contacts.size(); ++i) {
+            float area = signedArea(contacts[first].p, contacts[second].p, contacts[i].p, m_normal);
+            if (std::abs(area) > std::abs(thirdArea)) {
+                third = i;
+                thirdArea = area;
+            }
+        }
+
+        if (std::abs(thirdArea) > minimumSpread * secondDistance) {
+            // counter clockwise, so points outside of an edge give a negative area with it
+            chosen.push_back(third);
+            if (thirdArea < 0) {
+                std::swap(chosen[0], chosen[1]);
+            }
+
+            size_t fourth = 0;
+            float fourthArea = 0;
+            for (size_t i = 0; i < contacts.size(); ++i) {
+                for (int e = 0; e < 3; ++e) {
+                    const vec3 &a = contacts[chosen[e]].p;
+                    const vec3 &b = contacts[chosen[(e + 1) % 3]].p;
+                    float area = -signedArea(a, b, contacts[i].p, m_normal);
+                    if (area > fourthArea && area > minimumSpread * length(inPlane(b - a, m_normal))) {
+                        fourth = i;
+                        fourthArea = area;
+                    }
+                }
+            }
+
+            if (fourthArea > 0) {
+                chosen.push_back(fourth);
+            }
+        }
+    }
+
+    mat4 oneToLocal = inverse(one.model());
+    mat4 twoToLocal = inverse(two.model());
+    std::vector<bool> continued = std::vector<bool>(lastPoints.size(), false);
+
+    for (size_t i = 0; i < chosen.size(); ++i) {
+        Point point;
+        point.position = contacts[chosen[i]].p;
+        point.localOne = vec3(oneToLocal * vec4(point.position, 1.f));
+        point.localTwo = vec3(twoToLocal * vec4(point.position, 1.f));
+        point.normalImpulse = 0;
+        point.frictionImpulse = vec3(0, 0, 0);
+        point.age = 0;
+
+        // the closest point of the last step, if it has not moved away on either body
+        int closest = -1;
+        float closestDistance = matchDistance;
+        for (size_t j = 0; j < lastPoints.size(); ++j) {
+            float distance = max(length(point.localOne - lastPoints[j].localOne), length(point.localTwo - lastPoints[j].localTwo));
+            if (!continued[j] && distance < closestDistance) {
+                closest = (int)j;
+                closestDistance = distance;
+            }
+        }
+        if (closest >= 0) {
+            continued[closest] = true;
+            point.normalImpulse = lastPoints[closest].normalImpulse;
+            point.frictionImpulse = lastPoints[closest].frictionImpulse;
+            point.age = lastPoints[closest].age + 1;
+        }
+
+        m_points.push_back(point);
+    }
+}
+
+void ContactManifold::clear() {
+    m_points.clear();
+}
+
+const std::vector<ContactManifold::Point> &ContactManifold::getPoints() const {
+    return m_points;
+}
+
+vec3 ContactManifold::getNormal() const {
+    return m_normal;
+}
+
+std::vector<Contact> ContactManifold::getContacts() const {
+    std::vector<Contact> contacts = std::vector<Contact>();
+    for (size_t i = 0; i < m_points.size(); ++i) {
+        Contact contact;
+        contact.p = m_points[i].position;
+        contact.n = m_normal;
+        contacts.push_back(contact);
+    }
+    return contacts;
+}
+
+void ContactManifold::setNormalImpulse(float impulse) {
+    for (size_t i = 0; i < m_points.size(); ++i) {
+        m_points[i].normalImpulse = impulse / (float)m_points.size();
+        m_points[i].frictionImpulse = vec3(0, 0, 0);
+    }
+}
+
+void ContactManifold::setImpulses(size_t point, float normalImpulse, const vec3 &frictionImpulse) {
+    if (point < m_points.size()) {
+        m_points[point].normalImpulse = normalImpulse;
+        m_points[point].frictionImpulse = frictionImpulse;
+    }
+}
@@ -0,0 +1,324 @@
+#include "ContactSolver.h"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace glm;
+
+namespace {
+    const float restitutionVelocity = 0.5f;     // [m/s] slower approaches do not bounce, so resting contacts stay at rest
+    const float convergedImpulse = 1e-5f;       // [N*s] the iterations stop once no impulse changes more than this
+    const size_t pairsPerTask = 16;             // pairs of a batch solved by one task of the pool
+
+    // two unit vectors orthogonal to each other and to the normal
+    void tangentsOf(const vec3 &normal, vec3 tangents[2]) {
+        if (std::abs(normal.x) > 0.57735f) {
+            tangents[0] = normalize(vec3(normal.y, -normal.x, 0));
+        } else {
+            tangents[0] = normalize(vec3(0, normal.z, -normal.y));
+        }
+        tangents[1] = cross(normal, tangents[0]);
+    }
+}
+
+ContactSolver::ContactSolver() {
+    m_lastIterations = 0;
+    m_numberOfColours = 0;
+    m_pool = nullptr;
+}
+
+void ContactSolver::setPool(ThreadPool *pool) {
+    m_pool = pool;
+}
+
+size_t ContactSolver::solverBody(RigidBody &body) {
+    std::map<RigidBody *, size_t>::iterator found = m_bodyIndices.find(&body);
+    if (found != m_bodyIndices.end()) {
+        return found->second;
+    }
+
+    SolverBody solverBody;
+    solverBody.body = &body;
+    solverBody.isStatic = body.isStatic();
+    solverBody.inverseMass = body.getInverseMass();
+    solverBody.velocity = body.getLinearMomentum() * solverBody.inverseMass;
+    solverBody.angularVelocity = body.isStatic() ? vec3(0, 0, 0) : body.getAngularVelocity();
+    solverBody.inverseInertia = body.isStatic() ? mat3(0.f) : body.getInertiaTensorInv();
+
+    m_bodies.push_back(solverBody);
+    m_bodyIndices[&body] = m_bodies.size() - 1;
+    return m_bodies.size() - 1;
+}
+
+float ContactSolver::effectiveMass(const Constraint &constraint, const vec3 &direction) {
+    const SolverBody &a = m_bodies[constraint.a];
+    const SolverBody &b = m_bodies[constraint.b];
+    float k = a.inverseMass + b.inverseMass
+            + dot(direction, cross(a.inverseInertia * cross(constraint.ra, direction), constraint.ra))
+            + dot(direction, cross(b.inverseInertia * cross(constraint.rb, direction), constraint.rb));
+    return k > 0 ? 1.f / k : 0.f;
+}
+
+void ContactSolver::add(RigidBody &a, RigidBody &b, const std::vector<Contact> &contacts, ContactManifold *manifold, const Parameters &parameters) {
+    if (contacts.size() == 0) {
+        return;
+    }
+
+    size_t indexA = solverBody(a);
+    size_t indexB = solverBody(b);
+    const std::vector<ContactManifold::Point> *points = manifold != nullptr ? &manifold->getPoints() : nullptr;
+    size_t begin = m_constraints.size();
+
+    for (size_t i = 0; i < contacts.size(); ++i) {
+        Constraint constraint;
+        constraint.a = indexA;
+        constraint.b = indexB;
+        constraint.point = contacts[i].p;
+        constraint.normal = contacts[i].n;
+        tangentsOf(constraint.normal, constraint.tangents);
+        constraint.ra = constraint.point - a.getPosition();
+        constraint.rb = constraint.point - b.getPosition();
+
+        const SolverBody &bodyA = m_bodies[indexA];
+        const SolverBody &bodyB = m_bodies[indexB];
+        vec3 relativeVelocity = bodyA.velocity + cross(bodyA.angularVelocity, constraint.ra) - bodyB.velocity - cross(bodyB.angularVelocity, constraint.rb);
+        float normalVelocity = dot(relativeVelocity, constraint.normal);
+        if (normalVelocity > parameters.separatingVelocity) {
+            if (points != nullptr && i < points->size()) {
+                manifold->setImpulses(i, 0, vec3(0, 0, 0));
+            }
+            continue;
+        }
+        // only a new impact bounces, a point continued from the last step is resting, even if the gravity of a long
+        // step made it approach faster than restitutionVelocity
+        bool continued = points != nullptr && i < points->size() && (*points)[i].age > 0;
+        constraint.targetVelocity = !continued && normalVelocity < -restitutionVelocity ? -parameters.restitution * normalVelocity : 0.f;
+
+        constraint.normalMass = effectiveMass(constraint, constraint.normal);
+        constraint.tangentMasses[0] = effectiveMass(constraint, constraint.tangents[0]);
+        constraint.tangentMasses[1] = effectiveMass(constraint, constraint.tangents[1]);
+
+        constraint.normalImpulse = 0;
+        constraint.tangentImpulses[0] = 0;
+        constraint.tangentImpulses[1] = 0;
+        constraint.manifold = nullptr;
+        constraint.manifoldPoint = 0;
+        if (points != nullptr && i < points->size()) {
+            constraint.manifold = manifold;
+            constraint.manifoldPoint = i;
+            if (parameters.warmStarting != 0) {
+                // the friction of the last step in the tangent plane of this one
+                const ContactManifold::Point &point = (*points)[i];
+                constraint.normalImpulse = point.normalImpulse;
+                constraint.tangentImpulses[0] = dot(point.frictionImpulse, constraint.tangents[0]);
+                constraint.tangentImpulses[1] = dot(point.frictionImpulse, constraint.tangents[1]);
+            }
+        }
+
+        m_constraints.push_back(constraint);
+    }
+
+    if (m_constraints.size() > begin) {
+        Pair pair;
+        pair.a = indexA;
+        pair.b = indexB;
+        pair.begin = begin;
+        pair.end = m_constraints.size();
+        m_pairs.push_back(pair);
+    }
+}
+
+// static bodies are shared by the pairs of a batch, so they are never written
+void ContactSolver::applyImpulse(const Constraint &constraint, const vec3 &impulse) {
+    SolverBody &a = m_bodies[constraint.a];
+    SolverBody &b = m_bodies[constraint.b];
+    if (!a.isStatic) {
+        a.velocity += a.inverseMass * impulse;
+        a.angularVelocity += a.inverseInertia * cross(constraint.ra, impulse);
+    }
+    if (!b.isStatic) {
+        b.velocity -= b.inverseMass * impulse;
+        b.angularVelocity -= b.inverseInertia * cross(constraint.rb, impulse);
+    }
+}
+
+// Returns the largest change of an impulse
+float ContactSolver::solveConstraint(Constraint &c, const Parameters &parameters) {
+    const SolverBody &a = m_bodies[c.a];
+    const SolverBody &b = m_bodies[c.b];
+
+    // friction first, within the cone of the current normal impulse
+    vec3 relativeVelocity = a.velocity + cross(a.angularVelocity, c.ra) - b.velocity - cross(b.angularVelocity, c.rb);
+    float tangentImpulses[2];
+    for (int k = 0; k < 2; ++k) {
+        tangentImpulses[k] = c.tangentImpulses[k] - c.tangentMasses[k] * dot(relativeVelocity, c.tangents[k]);
+    }
+    float limit = parameters.frictionCoefficient * c.normalImpulse;
+    float magnitude = std::sqrt(tangentImpulses[0] * tangentImpulses[0] + tangentImpulses[1] * tangentImpulses[1]);
+    if (magnitude > limit) {
+        float scale = magnitude > 0 ? limit / magnitude : 0.f;
+        tangentImpulses[0] *= scale;
+        tangentImpulses[1] *= scale;
+    }
+    float changes[2] = {tangentImpulses[0] - c.tangentImpulses[0], tangentImpulses[1] - c.tangentImpulses[1]};
+    c.tangentImpulses[0] = tangentImpulses[0];
+    c.tangentImpulses[1] = tangentImpulses[1];
+    applyImpulse(c, changes[0] * c.tangents[0] + changes[1] * c.tangents[1]);
+    float largestChange = std::max(std::abs(changes[0]), std::abs(changes[1]));
+
+    // then the normal, which may only push
+    relativeVelocity = a.velocity + cross(a.angularVelocity, c.ra) - b.velocity - cross(b.angularVelocity, c.rb);
+    float normalImpulse = std::max(0.f, c.normalImpulse - c.normalMass * (dot(relativeVelocity, c.normal) - c.targetVelocity));
+    float change = normalImpulse - c.normalImpulse;
+    c.normalImpulse = normalImpulse;
+    applyImpulse(c, change * c.normal);
+    return std::max(largestChange, std::abs(change));
+}
+
+// Greedy colouring in the order of add: every pair gets the first batch in which neither of its dynamic bodies is
+// used yet. The batches are sorted by colour, so they only depend on the order of the pairs.
+void ContactSolver::colourPairs() {
+    std::vector<std::vector<bool> > used = std::vector<std::vector<bool> >(m_bodies.size());
+    std::vector<size_t> colours = std::vector<size_t>(m_pairs.size());
+    m_numberOfColours = 0;
+
+    for (size_t i = 0; i < m_pairs.size(); ++i) {
+        std::vector<bool> &usedA = used[m_pairs[i].a];
+        std::vector<bool> &usedB = used[m_pairs[i].b];
+        bool staticA = m_bodies[m_pairs[i].a].isStatic;
+        bool staticB = m_bodies[m_pairs[i].b].isStatic;
+
+        size_t colour = 0;
+        while ((!staticA && colour < usedA.size() && usedA[colour]) || (!staticB && colour < usedB.size() && usedB[colour])) {
+            ++colour;
+        }
+        if (!staticA) {
+            usedA.resize(std::max(usedA.size(), colour + 1), false);
+            usedA[colour] = true;
+        }
+        if (!staticB) {
+            usedB.resize(std::max(usedB.size(), colour + 1), false);
+            usedB[colour] = true;
+        }
+        colours[i] = colour;
+        m_numberOfColours = std::max(m_numberOfColours, colour + 1);
+    }
+
+    m_batchOffsets = std::vector<size_t>(m_numberOfColours + 1, 0);
+    for (size_t i = 0; i < m_pairs.size(); ++i) {
+        m_batchOffsets[colours[i] + 1]++;
+    }
+    for (size_t colour = 0; colour < m_numberOfColours; ++colour) {
+        m_batchOffsets[colour + 1] += m_batchOffsets[colour];
+    }
+    m_batchPairs = std::vector<size_t>(m_pairs.size());
+    std::vector<size_t> next = std::vector<size_t>(m_batchOffsets.begin(), m_batchOffsets.end() - 1);
+    for (size_t i = 0; i < m_pairs.size(); ++i) {
+        m_batchPairs[next[colours[i]]++] = i;
+    }
+}
+
+// One pass over the batches. The pairs of a batch share no dynamic body, so they can be solved at the same time and
+// the result does not depend on the number of threads or the order in which the tasks run.
+float ContactSolver::solveBatches(const Parameters &parameters) {
+    float largestChange = 0;
+    for (size_t colour = 0; colour < m_numberOfColours; ++colour) {
+        size_t begin = m_batchOffsets[colour];
+        size_t end = m_batchOffsets[colour + 1];
+        size_t numberOfTasks = (end - begin + pairsPerTask - 1) / pairsPerTask;
+
+        std::vector<float> taskChanges = std::vector<float>(numberOfTasks, 0.f);
+        auto solveTask = [&](size_t task) {
+            size_t last = std::min(end, begin + (task + 1) * pairsPerTask);
+            for (size_t i = begin + task * pairsPerTask; i < last; ++i) {
+                const Pair &pair = m_pairs[m_batchPairs[i]];
+                for (size_t j = pair.begin; j < pair.end; ++j) {
+                    taskChanges[task] = std::max(taskChanges[task], solveConstraint(m_constraints[j], parameters));
+                }
+            }
+        };
+        if (m_pool != nullptr && numberOfTasks > 1) {
+            m_pool->parallelFor(numberOfTasks, solveTask);
+        } else {
+            for (size_t task = 0; task < numberOfTasks; ++task) {
+                solveTask(task);
+            }
+        }
+
+        for (size_t task = 0; task < numberOfTasks; ++task) {
+            largestChange = std::max(largestChange, taskChanges[task]);
+        }
+    }
+    return largestChange;
+}
+
+void ContactSolver::solve(const Parameters &parameters) {
+    for (size_t i = 0; i < m_constraints.size(); ++i) {
+        const Constraint &c = m_constraints[i];
+        vec3 impulse = c.normalImpulse * c.normal + c.tangentImpulses[0] * c.tangents[0] + c.tangentImpulses[1] * c.tangents[1];
+        if (impulse != vec3(0, 0, 0)) {
+            applyImpulse(c, impulse);
+        }
+    }
+
+    m_numberOfColours = 0;
+    if (parameters.solverColouring != 0) {
+        colourPairs();
+    }
+
+    int iterations = std::max(1, parameters.solverIterations);
+    m_lastIterations = 0;
+    while (m_lastIterations < iterations && m_constraints.size() > 0) {
+        float largestChange = 0;
+
+        if (parameters.solverColouring != 0) {
+            largestChange = solveBatches(parameters);
+        } else {
+            for (size_t i = 0; i < m_constraints.size(); ++i) {
+                largestChange = std::max(largestChange, solveConstraint(m_constraints[i], parameters));
+            }
+        }
+
+        m_lastIterations++;
+        if (largestChange < convergedImpulse) {
+            break;
+        }
+    }
+
+    // the accumulated impulses replace the velocities, and are kept for the next step
+    for (size_t i = 0; i < m_constraints.size(); ++i) {
+        const Constraint &c = m_constraints[i];
+        vec3 friction = c.tangentImpulses[0] * c.tangents[0] + c.tangentImpulses[1] * c.tangents[1];
+        vec3 impulse = c.normalImpulse * c.normal + friction;
+        if (impulse != vec3(0, 0, 0)) {
+            m_bodies[c.a].body->addImpulse(impulse, c.point);
+            m_bodies[c.b].body->addImpulse(-impulse, c.point);
+        }
+        if (c.manifold != nullptr) {
+            c.manifold->setImpulses(c.manifoldPoint, c.normalImpulse, friction);
+        }
+    }
+
+    clear();
+}
+
+void ContactSolver::clear() {
+    m_bodies.clear();
+    m_bodyIndices.clear();
+    m_constraints.clear();
+    m_pairs.clear();
+}
+
+size_t ContactSolver::getNumberOfContacts() const {
+    return m_constraints.size();
+}
+
+int ContactSolver::getLastIterations() const {
+    return m_lastIterations;
+}
+
+size_t ContactSolver::getLastNumberOfColours() const {
+    return m_numberOfColours;
+}
@@ -0,0 +1,130 @@
+#include "ContinuousCollision.h"
+
+#include "GJK.h"
+#include "RigidBody.h"
+#include "Shape.h"
+
+#include <algorithm>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace glm;
+
+namespace {
+    const int maxIterations = 32;
+    const float tolerance = 0.001f;     // [m] closer hulls count as touching
+}
+
+namespace ContinuousCollision {
+    Motion::Motion(RigidBody &body) {
+        position = body.getPosition();
+        orientation = body.getOrientation();
+        scale = body.getScale();
+        linearVelocity = body.getLinearMomentum() / body.getMass();
+        angularVelocity = body.getAngularVelocity();
+        radius = 0;
+        hull = nullptr;
+
+        Shape *shape = body.getShape();
+        if (shape != nullptr && shape->getConvexHull().isValid()) {
+            hull = &shape->getConvexHull();
+            const std::vector<vec3> &vertices = hull->getVertices();
+            for (size_t i = 0; i < vertices.size(); ++i) {
+                radius = std::max(radius, length(scale * vertices[i]));
+            }
+        }
+    }
+
+    mat4 Motion::modelAt(float time) const {
+        // the same euler step as RigidBody::update
+        quat omega = quat(1.f, angularVelocity.x, angularVelocity.y, angularVelocity.z);
+        quat orientationAt = normalize(orientation + 0.5f * time * omega * orientation);
+
+        return translate(mat4(1.f), position + time * linearVelocity) * mat4_cast(orientationAt) * glm::scale(mat4(1.f), scale);
+    }
+
+    float timeToPenetration(const Motion &a, const Motion &b, float maxTime, float penetration) {
+        if (a.hull == nullptr || b.hull == nullptr) {
+            return maxTime;
+        }
+
+        // no point can approach faster: the relative velocity of the centers plus both rotations at the largest radius
+        float speed = length(a.linearVelocity - b.linearVelocity) + length(a.angularVelocity) * a.radius + length(b.angularVelocity) * b.radius;
+        if (speed <= 0) {
+            return maxTime;
+        }
+
+        float time = 0;
+        for (int iteration = 0; iteration < maxIterations; ++iteration) {
+            mat4 modelA = a.modelAt(time);
+            mat4 modelB = b.modelAt(time);
+
+            vec3 pointA;
+            vec3 pointB;
+            GJK::distance(*a.hull, inverse(modelB) * modelA, *b.hull, pointA, pointB);
+            float distance = length(vec3(modelB * vec4(pointA, 1.f)) - vec3(modelB * vec4(pointB, 1.f)));
+
+            if (distance <= tolerance) {
+                // touching at the beginning is left to the contacts of the step
+                if (iteration == 0) {
+                    return maxTime;
+                }
+                break;
+            }
+
+            time += distance / speed;
+            if (time >= maxTime) {
+                return maxTime;
+            }
+        }
+
+        return std::min(maxTime, time + penetration / speed);
+    }
+
+    float timeToGroundPenetration(const Motion &motion, const Ground &ground, float maxTime, float penetration) {
+        if (motion.hull == nullptr) {
+            return maxTime;
+        }
+
+        // the rotation moves a point up or down by at most the part of the angular velocity around a horizontal axis
+        float speed = std::max(0.f, -motion.linearVelocity.y) + length(cross(vec3(0, 1, 0), motion.angularVelocity)) * motion.radius;
+        if (!ground.isFlat()) {
+            speed = length(motion.linearVelocity) + length(motion.angularVelocity) * motion.radius;
+        }
+        if (speed <= 0) {
+            return maxTime;
+        }
+
+        float time = 0;
+        int lowest = 0;
+        for (int iteration = 0; iteration < maxIterations; ++iteration) {
+            mat4 model = motion.modelAt(time);
+
+            float distance;
+            if (ground.isFlat()) {
+                // the lowest vertex is the one farthest along the world down direction in model space
+                vec3 down = -vec3(model[0][1], model[1][1], model[2][1]);
+                lowest = motion.hull->supportIndex(down, lowest);
+                distance = (model * vec4(motion.hull->getVertices()[lowest], 1.f)).y;
+            } else {
+                vec3 normal;
+                lowest = ground.lowestVertex(*motion.hull, model, lowest, distance, normal);
+            }
+
+            if (distance <= tolerance) {
+                // touching at the beginning is left to the contacts of the step
+                if (iteration == 0) {
+                    return maxTime;
+                }
+                break;
+            }
+
+            time += distance / speed;
+            if (time >= maxTime) {
+                return maxTime;
+            }
+        }
+
+        return std::min(maxTime, time + penetration / speed);
+    }
+}
@@ -0,0 +1,349 @@
+#include "ConvexHull.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <utility>
+
+using namespace glm;
+
+namespace {
+    struct BuildFace {
+        int vertices[3];
+        vec3 normal;
+        float offset;
+        bool removed;
+    };
+
+    typedef std::map<std::pair<int, int>, int> EdgeMap;     // directed edge -> face
+
+    BuildFace makeFace(const std::vector<vec3> &points, int a, int b, int c) {
+        BuildFace face;
+        face.vertices[0] = a;
+        face.vertices[1] = b;
+        face.vertices[2] = c;
+
+        vec3 normal = cross(points[b] - points[a], points[c] - points[a]);
+        float area = length(normal);
+        face.normal = area > 0 ? normal / area : vec3(0, 0, 0);
+        face.offset = dot(face.normal, points[a]);
+        face.removed = false;
+        return face;
+    }
+
+    void addFace(std::vector<BuildFace> &faces, EdgeMap &edges, const std::vector<vec3> &points, int a, int b, int c) {
+        int index = (int)faces.size();
+        faces.push_back(makeFace(points, a, b, c));
+        edges[std::make_pair(a, b)] = index;
+        edges[std::make_pair(b, c)] = index;
+        edges[std::make_pair(c, a)] = index;
+    }
+
+    float distanceToLine(const vec3 &point, const vec3 &a, const vec3 &b) {
+        return length(cross(point - a, normalize(b - a)));
+    }
+}
+
+ConvexHull::ConvexHull() {
+}
+
+ConvexHull::ConvexHull(const std::vector<vec3> &points) {
+    if (points.size() < 4) {
+        return;
+    }
+
+    vec3 lower = points[0];
+    vec3 upper = points[0];
+    for (size_t i = 1; i < points.size(); ++i) {
+        lower = min(lower, points[i]);
+        upper = max(upper, points[i]);
+    }
+
+    // tolerance for points on a face, relative to the size of the cloud
+    float epsilon = 0.00001f * length(upper - lower);
+
+    // initial tetrahedron: the extreme points along the longest axis, the point farthest from their line and the
+    // point farthest from the plane of these three
+    vec3 extent = upper - lower;
+    int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+    int first = 0;
+    int second = 0;
+    for (int i = 1; i < (int)points.size(); ++i) {
+        if (points[i][axis] < points[first][axis]) {
+            first = i;
+        }
+        if (points[i][axis] > points[second][axis]) {
+            second = i;
+        }
+    }
+    if (length(points[second] - points[first]) <= epsilon) {
+        return;
+    }
+
+    int third = -1;
+    float thirdDistance = epsilon;
+    for (int i = 0; i < (int)points.size(); ++i) {
+        float distance = distanceToLine(points[i], points[first], points[second]);
+        if (distance > thirdDistance) {
+            third = i;
+            thirdDistance = distance;
+        }
+    }
+    if (third < 0) {
+        return;
+    }
+
+    BuildFace base = makeFace(points, first, second, third);
+    int fourth = -1;
+    float fourthDistance = epsilon;
+    for (int i = 0; i < (int)points.size(); ++i) {
+        float distance = std::abs(dot(base.normal, points[i]) - base.offset);
+        if (distance > fourthDistance) {
+            fourth = i;
+            fourthDistance = distance;
+        }
+    }
+    if (fourth < 0) {
+        return;
+    }
+
+    // the fourth point has to be behind the base
+    if (dot(base.normal, points[fourth]) - base.offset > 0) {
+        std::swap(second, third);
+    }
+
+    std::vector<BuildFace> faces = std::vector<BuildFace>();
+    EdgeMap edges = EdgeMap();
+    addFace(faces, edges, points, first, second, third);
+    addFace(faces, edges, points, first, fourth, second);
+    addFace(faces, edges, points, second, fourth, third);
+    addFace(faces, edges, points, third, fourth, first);
+
+    std::vector<char> visible = std::vector<char>();
+    std::vector<int> visibleFaces = std::vector<int>();
+    std::vector<std::pair<int, int> > horizon = std::vector<std::pair<int, int> >();
+    std::vector<int> horizonStarts = std::vector<int>();
+
+    // far points first, most of the others are then inside already and the visible regions stay simple
+    vec3 center = (points[first] + points[second] + points[third] + points[fourth]) * 0.25f;
+    std::vector<std::pair<float, int> > order = std::vector<std::pair<float, int> >();
+    for (int i = 0; i < (int)points.size(); ++i) {
+        if (i != first && i != second && i != third && i != fourth) {
+            order.push_back(std::make_pair(-length(points[i] - center), i));
+        }
+    }
+    std::sort(order.begin(), order.end());
+
+    for (size_t o = 0; o < order.size(); ++o) {
+        int i = order[o].second;
+
+        // the face seeing the point best, none if the point is inside
+        int start = -1;
+        float startDistance = epsilon;
+        for (size_t f = 0; f < faces.size(); ++f) {
+            if (!faces[f].removed) {
+                float distance = dot(faces[f].normal, points[i]) - faces[f].offset;
+                if (distance > startDistance) {
+                    start = (int)f;
+                    startDistance = distance;
+                }
+            }
+        }
+        if (start < 0) {
+            continue;
+        }
+
+        // the visible faces are connected, grow them from the start face
+        visible.assign(faces.size(), 0);
+        visibleFaces.clear();
+        visibleFaces.push_back(start);
+        visible[start] = 1;
+        for (size_t v = 0; v < visibleFaces.size(); ++v) {
+            const BuildFace &face = faces[visibleFaces[v]];
+            for (int e = 0; e < 3; ++e) {
+                int neighbour = edges[std::make_pair(face.vertices[(e + 1) % 3], face.vertices[e])];
+                if (!visible[neighbour] && dot(faces[neighbour].normal, points[i]) - faces[neighbour].offset > epsilon) {
+                    visible[neighbour] = 1;
+                    visibleFaces.push_back(neighbour);
+                }
+            }
+        }
+
+        // edges between visible and hidden faces, in the orientation of the visible face
+        horizon.clear();
+        for (size_t v = 0; v < visibleFaces.size(); ++v) {
+            const BuildFace &face = faces[visibleFaces[v]];
+            for (int e = 0; e < 3; ++e) {
+                int a = face.vertices[e];
+                int b = face.vertices[(e + 1) % 3];
+                if (!visible[edges[std::make_pair(b, a)]]) {
+                    horizon.push_back(std::make_pair(a, b));
+                }
+            }
+        }
+
+        // rounding can pinch the visible region, then the horizon is no simple loop and the point is left out
+        horizonStarts.clear();
+        for (size_t h = 0; h < horizon.size(); ++h) {
+            horizonStarts.push_back(horizon[h].first);
+        }
+        std::sort(horizonStarts.begin(), horizonStarts.end());
+        if (std::adjacent_find(horizonStarts.begin(), horizonStarts.end()) != horizonStarts.end()) {
+            continue;
+        }
+
+        for (size_t v = 0; v < visibleFaces.size(); ++v) {
+            BuildFace &face = faces[visibleFaces[v]];
+            face.removed = true;
+            for (int e = 0; e < 3; ++e) {
+                edges.erase(std::make_pair(face.vertices[e], face.vertices[(e + 1) % 3]));
+            }
+        }
+
+        for (size_t h = 0; h < horizon.size(); ++h) {
+            addFace(faces, edges, points, horizon[h].first, horizon[h].second, i);
+        }
+    }
+
+    // keep only the vertices of the remaining faces
+    std::vector<int> indices = std::vector<int>(points.size(), -1);
+    for (size_t f = 0; f < faces.size(); ++f) {
+        if (faces[f].removed) {
+            continue;
+        }
+
+        Face face;
+        int *vertices[3] = { &face.vertex1, &face.vertex2, &face.vertex3 };
+        for (int v = 0; v < 3; ++v) {
+            int point = faces[f].vertices[v];
+            if (indices[point] < 0) {
+                indices[point] = (int)m_vertices.size();
+                m_vertices.push_back(points[point]);
+                m_pointIndices.push_back(point);
+            }
+            *vertices[v] = indices[point];
+        }
+        face.normal = faces[f].normal;
+        face.offset = faces[f].offset;
+        m_faces.push_back(face);
+    }
+
+    // every edge belongs to two faces, so each face adds its edges in one direction
+    m_neighbours = std::vector<std::vector<int> >(m_vertices.size());
+    for (size_t f = 0; f < m_faces.size(); ++f) {
+        m_neighbours[m_faces[f].vertex1].push_back(m_faces[f].vertex2);
+        m_neighbours[m_faces[f].vertex2].push_back(m_faces[f].vertex3);
+        m_neighbours[m_faces[f].vertex3].push_back(m_faces[f].vertex1);
+    }
+
+    m_surfacePoints = std::vector<std::vector<int> >(m_vertices.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (indices[i] >= 0) {
+            continue;
+        }
+        for (size_t f = 0; f < m_faces.size(); ++f) {
+            const Face &face = m_faces[f];
+            if (dot(face.normal, points[i]) - face.offset < -epsilon) {
+                continue;
+            }
+            int faceVertices[3] = { face.vertex1, face.vertex2, face.vertex3 };
+            for (int v = 0; v < 3; ++v) {
+                std::vector<int> &surfacePoints = m_surfacePoints[faceVertices[v]];
+                if (surfacePoints.empty() || surfacePoints.back() != (int)i) {
+                    surfacePoints.push_back((int)i);
+                }
+            }
+        }
+    }
+}
+
+bool ConvexHull::isValid() const {
+    return m_faces.size() > 0;
+}
+
+const std::vector<vec3> &ConvexHull::getVertices() const {
+    return m_vertices;
+}
+
+const std::vector<ConvexHull::Face> &ConvexHull::getFaces() const {
+    return m_faces;
+}
+
+float ConvexHull::getVolume() const {
+    float volume = 0;
+    for (size_t i = 0; i < m_faces.size(); ++i) {
+        volume += dot(m_vertices[m_faces[i].vertex1], cross(m_vertices[m_faces[i].vertex2], m_vertices[m_faces[i].vertex3]));
+    }
+    return volume / 6.f;
+}
+
+vec3 ConvexHull::support(const vec3 &direction) const {
+    size_t best = 0;
+    float bestDistance = -std::numeric_limits<float>::max();
+    for (size_t i = 0; i < m_vertices.size(); ++i) {
+        float distance = dot(m_vertices[i], direction);
+        if (distance > bestDistance) {
+            best = i;
+            bestDistance = distance;
+        }
+    }
+    return m_vertices.size() > 0 ? m_vertices[best] : vec3(0, 0, 0);
+}
+
+int ConvexHull::supportIndex(const vec3 &direction, int start) const {
+    if (m_vertices.size() == 0) {
+        return -1;
+    }
+
+    int current = start >= 0 && start < (int)m_vertices.size() ? start : 0;
+    float currentDistance = dot(m_vertices[current], direction);
+
+    // On a convex hull a vertex without a farther neighbour is the farthest of all. Coplanar vertices can form a
+    // plateau of equally far neighbours though, which is searched for a way up before giving up.
+    std::vector<int> plateau = std::vector<int>();
+    while (true) {
+        plateau.clear();
+        plateau.push_back(current);
+
+        bool improved = false;
+        for (size_t p = 0; p < plateau.size() && !improved; ++p) {
+            const std::vector<int> &neighbours = m_neighbours[plateau[p]];
+            for (size_t i = 0; i < neighbours.size(); ++i) {
+                float distance = dot(m_vertices[neighbours[i]], direction);
+                if (distance > currentDistance) {
+                    current = neighbours[i];
+                    currentDistance = distance;
+                    improved = true;
+                } else if (!improved && distance == currentDistance && std::find(plateau.begin(), plateau.end(), neighbours[i]) == plateau.end()) {
+                    plateau.push_back(neighbours[i]);
+                }
+            }
+        }
+
+        if (!improved) {
+            return current;
+        }
+    }
+}
+
+const std::vector<int> &ConvexHull::getNeighbours(int vertex) const {
+    return m_neighbours[vertex];
+}
+
+int ConvexHull::getPointIndex(int vertex) const {
+    return m_pointIndices[vertex];
+}
+
+const std::vector<int> &ConvexHull::getSurfacePoints(int vertex) const {
+    return m_surfacePoints[vertex];
+}
+
+float ConvexHull::depthOf(const vec3 &point) const {
+    float depth = std::numeric_limits<float>::max();
+    for (size_t i = 0; i < m_faces.size(); ++i) {
+        depth = std::min(depth, m_faces[i].offset - dot(m_faces[i].normal, point));
+    }
+    return depth;
+}
@@ -0,0 +1,265 @@
+#include "DistanceField.h"
+
+#include "IntersectionTest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace glm;
+
+namespace {
+    const int blockSize = 8;            // samples per block along each axis
+    const int outsideBlock = -1;
+    const int insideBlock = -2;
+    const float bandCells = 2.f;        // width of the band on each side of the surface, in cells
+
+    struct MeshTriangle {
+        vec3 vertex1, vertex2, vertex3;
+    };
+
+    float distanceToBox(const vec3 &p, const vec3 &lower, const vec3 &upper) {
+        return length(max(max(lower - p, p - upper), vec3(0, 0, 0)));
+    }
+
+    struct Closest {
+        float distance;
+        vec3 point;
+        const Triangle *triangle;
+        bool onFace;
+    };
+
+    // closest triangle in the hierarchy, skipping nodes which are farther away than the closest one found so far
+    void findClosest(OOBB *node, const vec3 &p, Closest &closest) {
+        std::vector<OOBB> *children = node->getChildren();
+
+        if (children->size() == 0) {
+            const std::vector<Triangle> &triangles = node->getIncludedTriangles();
+            for (size_t i = 0; i < triangles.size(); ++i) {
+                bool onFace;
+                vec3 point = IntersectionTest::closestPointTriangle(p, triangles[i].vertex1, triangles[i].vertex2, triangles[i].vertex3, onFace);
+                float distance = length(p - point);
+                if (distance < closest.distance) {
+                    closest.distance = distance;
+                    closest.point = point;
+                    closest.triangle = &triangles[i];
+                    closest.onFace = onFace;
+                }
+            }
+            return;
+        }
+
+        // nearer children first, they make the bound tighter for the others
+        std::pair<float, size_t> order[8];
+        size_t numberOfChildren = std::min(children->size(), (size_t)8);
+        for (size_t i = 0; i < numberOfChildren; ++i) {
+            OOBB &child = children->at(i);
+            order[i] = std::make_pair(distanceToBox(p, child.getOrigin(), child.getOrigin() + child.getRadii()), i);
+        }
+        std::sort(order, order + numberOfChildren);
+
+        for (size_t i = 0; i < numberOfChildren; ++i) {
+            if (order[i].first < closest.distance) {
+                findClosest(&children->at(order[i].second), p, closest);
+            }
+        }
+    }
+
+    // sum of the solid angles of all triangles seen from p (van Oosterom and Strackee): +-1 inside a closed mesh, 0 outside
+    float windingNumber(const std::vector<MeshTriangle> &triangles, const vec3 &p) {
+        float sum = 0;
+        for (size_t i = 0; i < triangles.size(); ++i) {
+            vec3 a = triangles[i].vertex1 - p;
+            vec3 b = triangles[i].vertex2 - p;
+            vec3 c = triangles[i].vertex3 - p;
+            float la = length(a);
+            float lb = length(b);
+            float lc = length(c);
+
+            float numerator = dot(a, cross(b, c));
+            float denominator = la * lb * lc + dot(a, b) * lc + dot(b, c) * la + dot(c, a) * lb;
+            sum += 2.f * std::atan2(numerator, denominator);
+        }
+        return sum / (4.f * 3.14159265f);
+    }
+}
+
+DistanceField::DistanceField() {
+    m_resolution = 0;
+    m_lower = vec3(0, 0, 0);
+    m_cellSize = 0;
+    m_bandWidth = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+        m_numberOfSamples[axis] = 0;
+        m_numberOfBlocks[axis] = 0;
+    }
+}
+
+DistanceField::DistanceField(Mesh *mesh, OOBB *root, int resolution) : DistanceField() {
+    std::vector<MeshTriangle> triangles = std::vector<MeshTriangle>();
+    GLfloat *vertices = mesh->getVertices();
+    for (GLuint i = 0; i + 8 < mesh->getNumVertices(); i += 9) {
+        MeshTriangle triangle;
+        triangle.vertex1 = vec3(vertices[i+0], vertices[i+1], vertices[i+2]);
+        triangle.vertex2 = vec3(vertices[i+3], vertices[i+4], vertices[i+5]);
+        triangle.vertex3 = vec3(vertices[i+6], vertices[i+7], vertices[i+8]);
+        triangles.push_back(triangle);
+    }
+    if (triangles.size() == 0) {
+        return;
+    }
+
+    vec3 lower = triangles[0].vertex1;
+    vec3 upper = triangles[0].vertex1;
+    float volume = 0;
+    for (size_t i = 0; i < triangles.size(); ++i) {
+        lower = min(lower, min(triangles[i].vertex1, min(triangles[i].vertex2, triangles[i].vertex3)));
+        upper = max(upper, max(triangles[i].vertex1, max(triangles[i].vertex2, triangles[i].vertex3)));
+        volume += dot(triangles[i].vertex1, cross(triangles[i].vertex2, triangles[i].vertex3));
+    }
+
+    // the face normals point outwards if the mesh has a positive volume
+    float orientation = volume < 0 ? -1.f : 1.f;
+
+    vec3 extent = upper - lower;
+    float longest = std::max(extent.x, std::max(extent.y, extent.z));
+    if (longest <= 0) {
+        return;
+    }
+
+    m_resolution = std::max(resolution, 1);
+    m_cellSize = longest / m_resolution;
+    m_bandWidth = bandCells * m_cellSize;
+
+    // the band around the whole mesh lies in the grid
+    float margin = m_bandWidth + m_cellSize;
+    m_lower = lower - vec3(margin, margin, margin);
+    for (int axis = 0; axis < 3; ++axis) {
+        m_numberOfSamples[axis] = (int)std::ceil((extent[axis] + 2.f * margin) / m_cellSize) + 1;
+        m_numberOfBlocks[axis] = (m_numberOfSamples[axis] + blockSize - 1) / blockSize;
+    }
+
+    float blockRadius = std::sqrt(3.f) * 0.5f * (blockSize - 1) * m_cellSize;
+
+    m_blocks.assign(m_numberOfBlocks[0] * m_numberOfBlocks[1] * m_numberOfBlocks[2], outsideBlock);
+
+    for (int bz = 0; bz < m_numberOfBlocks[2]; ++bz) {
+        for (int by = 0; by < m_numberOfBlocks[1]; ++by) {
+            for (int bx = 0; bx < m_numberOfBlocks[0]; ++bx) {
+                int block = bx + m_numberOfBlocks[0] * (by + m_numberOfBlocks[1] * bz);
+
+                vec3 center = m_lower + m_cellSize * (vec3((float)(bx * blockSize), (float)(by * blockSize), (float)(bz * blockSize)) + vec3(0.5f * (blockSize - 1)));
+                Closest closest;
+                closest.distance = std::numeric_limits<float>::max();
+                closest.triangle = nullptr;
+                findClosest(root, center, closest);
+
+                // no sample of the block is in the band
+                if (closest.distance > m_bandWidth + blockRadius) {
+                    m_blocks[block] = std::abs(windingNumber(triangles, center)) > 0.5f ? insideBlock : outsideBlock;
+                    continue;
+                }
+
+                m_blocks[block] = (int)m_samples.size();
+                for (int z = 0; z < blockSize; ++z) {
+                    for (int y = 0; y < blockSize; ++y) {
+                        for (int x = 0; x < blockSize; ++x) {
+                            vec3 point = m_lower + m_cellSize * vec3((float)(bx * blockSize + x), (float)(by * blockSize + y), (float)(bz * blockSize + z));
+                            closest.distance = std::numeric_limits<float>::max();
+                            closest.triangle = nullptr;
+                            findClosest(root, point, closest);
+
+                            // the face decides the side if the point is closest to its inside, else edges and
+                            // vertices are ambiguous and the winding number decides
+                            bool isInside;
+                            if (closest.triangle != nullptr && closest.onFace) {
+                                vec3 normal = cross(closest.triangle->vertex2 - closest.triangle->vertex1, closest.triangle->vertex3 - closest.triangle->vertex1);
+                                isInside = orientation * dot(point - closest.point, normal) < 0;
+                            } else {
+                                isInside = std::abs(windingNumber(triangles, point)) > 0.5f;
+                            }
+
+                            float distance = std::min(closest.distance, m_bandWidth);
+                            m_samples.push_back(isInside ? -distance : distance);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+bool DistanceField::isValid() const {
+    return m_cellSize > 0;
+}
+
+int DistanceField::getResolution() const {
+    return m_resolution;
+}
+
+float DistanceField::getCellSize() const {
+    return m_cellSize;
+}
+
+size_t DistanceField::getMemorySize() const {
+    return m_blocks.size() * sizeof(int) + m_samples.size() * sizeof(float);
+}
+
+float DistanceField::sampleAt(int x, int y, int z) const {
+    int block = m_blocks[x / blockSize + m_numberOfBlocks[0] * (y / blockSize + m_numberOfBlocks[1] * (z / blockSize))];
+    if (block == outsideBlock) {
+        return m_bandWidth;
+    }
+    if (block == insideBlock) {
+        return -m_bandWidth;
+    }
+    return m_samples[block + x % blockSize + blockSize * (y % blockSize + blockSize * (z % blockSize))];
+}
+
+float DistanceField::distanceAt(const vec3 &point) const {
+    if (!isValid()) {
+        return std::numeric_limits<float>::max();
+    }
+
+    vec3 upper = m_lower + m_cellSize * vec3((float)(m_numberOfSamples[0] - 1), (float)(m_numberOfSamples[1] - 1), (float)(m_numberOfSamples[2] - 1));
+    if (!contains(point)) {
+        return m_bandWidth + distanceToBox(point, m_lower, upper);
+    }
+
+    vec3 grid = (point - m_lower) / m_cellSize;
+    int cell[3];
+    float fraction[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        cell[axis] = std::min(std::max((int)std::floor(grid[axis]), 0), m_numberOfSamples[axis] - 2);
+        fraction[axis] = grid[axis] - cell[axis];
+    }
+
+    float value = 0;
+    for (int corner = 0; corner < 8; ++corner) {
+        int dx = corner & 1;
+        int dy = (corner >> 1) & 1;
+        int dz = (corner >> 2) & 1;
+        float weight = (dx ? fraction[0] : 1.f - fraction[0]) * (dy ? fraction[1] : 1.f - fraction[1]) * (dz ? fraction[2] : 1.f - fraction[2]);
+        value += weight * sampleAt(cell[0] + dx, cell[1] + dy, cell[2] + dz);
+    }
+    return value;
+}
+
+vec3 DistanceField::gradientAt(const vec3 &point) const {
+    float step = 0.5f * m_cellSize;
+    vec3 gradient = vec3(distanceAt(point + vec3(step, 0, 0)) - distanceAt(point - vec3(step, 0, 0)),
+                         distanceAt(point + vec3(0, step, 0)) - distanceAt(point - vec3(0, step, 0)),
+                         distanceAt(point + vec3(0, 0, step)) - distanceAt(point - vec3(0, 0, step)));
+    float magnitude = length(gradient);
+    return magnitude > 0 ? gradient / magnitude : vec3(0, 0, 0);
+}
+
+bool DistanceField::contains(const vec3 &point) const {
+    for (int axis = 0; axis < 3; ++axis) {
+        float coordinate = (point[axis] - m_lower[axis]) / m_cellSize;
+        if (!(coordinate >= 0 && coordinate <= m_numberOfSamples[axis] - 1)) {
+            return false;
+        }
+    }
+    return isValid();
+}
@@ -0,0 +1,236 @@
+#include "Ensemble.h"
+
+#include "Simulation.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+#ifndef M_PI
+    #define M_PI 3.14159265358979323846
+#endif
+
+using namespace glm;
+
+Ensemble::Ensemble(const EnsembleConfig &config) {
+    m_config = config;
+    m_seconds = 0;
+}
+
+bool Ensemble::parseArguments(int argc, char *argv[], EnsembleConfig &config) {
+    for (int i = 0; i < argc; ++i) {
+        const char *separator = strchr(argv[i], '=');
+        if (separator == nullptr) {
+            printf("ERROR: Argument '%s' is not of the form key=value.\n", argv[i]);
+            return false;
+        }
+
+        if (!parseArgument(std::string(argv[i], separator - argv[i]), separator + 1, config)) {
+            return false;
+        }
+    }
+
+    return loadHeightfield(config);
+}
+
+bool Ensemble::parseArgument(const std::string &key, const std::string &value, EnsembleConfig &config) {
+    if (key == "type") {
+        config.type = atoi(value.c_str());
+    } else if (key == "rotating") {
+        config.rotating = atoi(value.c_str()) != 0;
+    } else if (key == "upsidedown") {
+        config.upsidedown = atoi(value.c_str()) != 0;
+    } else if (key == "runs") {
+        config.runs = atoi(value.c_str());
+    } else if (key == "steps") {
+        config.steps = atoi(value.c_str());
+    } else if (key == "dt") {
+        config.timeStep = (float)atof(value.c_str());
+    } else if (key == "jitter") {
+        config.positionJitter = (float)atof(value.c_str());
+    } else if (key == "tilt") {
+        config.tiltJitter = (float)atof(value.c_str());
+    } else if (key == "spin") {
+        config.spinJitter = (float)atof(value.c_str());
+    } else if (key == "topple") {
+        config.toppleAngle = (float)atof(value.c_str());
+    } else if (key == "spinThreshold") {
+        config.spinThreshold = (float)atof(value.c_str());
+    } else if (key == "seed") {
+        config.seed = (unsigned int)atoi(value.c_str());
+    } else if (key == "threads") {
+        config.threads = (unsigned int)atoi(value.c_str());
+    } else if (key == "deterministic") {
+        config.deterministic = atoi(value.c_str()) != 0;
+    } else if (key == "out") {
+        config.output = value;
+    } else if (key == "hashes") {
+        config.hashes = value;
+    } else if (key == "heightfield") {
+        config.heightfield = value;
+    } else if (key == "heightfieldSize") {
+        config.heightfieldSize.x = config.heightfieldSize.z = (float)atof(value.c_str());
+    } else if (key == "heightfieldHeight") {
+        config.heightfieldSize.y = (float)atof(value.c_str());
+    } else if (!config.parameters.set(key, (float)atof(value.c_str()))) {
+        printf("ERROR: Unknown argument '%s'.\n", key.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool Ensemble::loadHeightfield(EnsembleConfig &config) {
+    if (config.heightfield.empty()) {
+        return true;
+    }
+
+    config.heightfieldData = std::make_shared<const Heightfield>(config.heightfield, config.heightfieldSize);
+    return config.heightfieldData->isValid();
+}
+
+EnsembleResult Ensemble::simulate(const EnsembleConfig &config, int run) {
+    // every run has its own random sequence, so the results do not depend on the scheduling
+    std::mt19937 random(config.seed * 1000003u + (unsigned int)run);
+    std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+
+    Simulation simulation;
+    simulation.setMaxNumberOfStates(2);
+    simulation.setParameters(config.parameters);
+    simulation.setHeightfield(config.heightfieldData.get());
+    simulation.setDeterministic(config.deterministic);
+    simulation.setRecordStateHashes(true);
+    simulation.addRigidBody(config.type, config.rotating, config.upsidedown, config.positionJitter * uniform(random), config.positionJitter * uniform(random));
+
+    RigidBody *rb = &simulation.getCurrentState()->back();
+
+    float tiltDirection = (float)M_PI * uniform(random);
+    float tilt = config.tiltJitter * uniform(random);
+    rb->setOrientation(angleAxis(tilt, vec3(cos(tiltDirection), 0, sin(tiltDirection))) * rb->getOrientation());
+
+    if (config.rotating) {
+        // same axis as the spin forces of RigidBodyFactory, which add up to a torque of (0, -1000, 0)
+        rb->addTorque(vec3(0, -1000.f * config.spinJitter * uniform(random), 0));
+    }
+
+    vec3 initialAxis = rb->getOrientation() * vec3(0, 1, 0);
+
+    EnsembleResult result;
+    result.run = run;
+    result.timeToTopple = -1;
+    result.spinLifetime = 0;
+    result.finalTilt = 0;
+
+    float time = 0;
+    for (int step = 0; step < config.steps; ++step) {
+        simulation.forwardStep(config.timeStep);
+        time += config.timeStep;
+
+        // the state vector is replaced in every step
+        rb = &simulation.getCurrentState()->back();
+
+        vec3 axis = rb->getOrientation() * vec3(0, 1, 0);
+        float currentTilt = acos(clamp(dot(axis, initialAxis), -1.f, 1.f));
+
+        if (result.timeToTopple < 0 && currentTilt > config.toppleAngle) {
+            result.timeToTopple = time;
+        }
+
+        if (std::abs(dot(rb->getAngularVelocity(), axis)) >= config.spinThreshold) {
+            result.spinLifetime = time;
+        }
+
+        result.finalTilt = currentTilt;
+    }
+
+    result.finalPosition = rb->getPosition();
+    result.finalOrientation = rb->getOrientation();
+    result.finalHash = simulation.getStateHashes().empty() ? 0 : simulation.getStateHashes().back();
+
+    if (!config.hashes.empty()) {
+        simulation.writeStateHashes(config.hashes + std::to_string(run) + ".txt");
+    }
+
+    return result;
+}
+
+void Ensemble::run() {
+    m_results = std::vector<EnsembleResult>(std::max(0, m_config.runs));
+
+    // Meshes and textures need the GL context of this thread. Load them (and the shared shape) before starting the workers.
+    Simulation warmup;
+    warmup.addRigidBody(m_config.type, m_config.rotating, m_config.upsidedown, 0, 0);
+
+    ThreadPool pool(m_config.threads);
+    printf("Info: Running %d scenes on %u threads.\n", m_config.runs, pool.getNumberOfThreads());
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    pool.parallelFor(m_results.size(), [this](size_t i) {
+        m_results[i] = simulate(m_config, (int)i);
+    });
+
+    m_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (!m_config.output.empty()) {
+        writeResults(m_config.output);
+    }
+}
+
+const std::vector<EnsembleResult> &Ensemble::getResults() const {
+    return m_results;
+}
+
+double Ensemble::getScenesPerHour() const {
+    if (m_seconds <= 0) {
+        return 0;
+    }
+    return m_results.size() / m_seconds * 3600.0;
+}
+
+void Ensemble::printSummary() const {
+    int toppled = 0;
+    double timeToTopple = 0;
+    double spinLifetime = 0;
+    double finalTilt = 0;
+
+    for (size_t i = 0; i < m_results.size(); ++i) {
+        if (m_results[i].timeToTopple >= 0) {
+            toppled++;
+            timeToTopple += m_results[i].timeToTopple;
+        }
+        spinLifetime += m_results[i].spinLifetime;
+        finalTilt += m_results[i].finalTilt;
+    }
+
+    size_t runs = std::max((size_t)1, m_results.size());
+
+    printf("Ensemble: %lu runs of %d steps in %.2f s (%.0f scenes/hour)\n", m_results.size(), m_config.steps, m_seconds, getScenesPerHour());
+    printf("\ttoppled: %d mean time to topple: %f s\n", toppled, toppled > 0 ? timeToTopple / toppled : 0.0);
+    printf("\tmean spin lifetime: %f s mean final tilt: %f rad\n", spinLifetime / runs, finalTilt / runs);
+}
+
+bool Ensemble::writeResults(const std::string &filename) const {
+    FILE *file = fopen(filename.c_str(), "w");
+    if (file == nullptr) {
+        printf("ERROR: Could not write ensemble results to %s.\n", filename.c_str());
+        return false;
+    }
+
+    fprintf(file, "run,timeToTopple,spinLifetime,x,y,z,qw,qx,qy,qz,finalTilt,hash\n");
+    for (size_t i = 0; i < m_results.size(); ++i) {
+        const EnsembleResult &r = m_results[i];
+        fprintf(file, "%d,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f,%016" PRIx64 "\n", r.run, r.timeToTopple, r.spinLifetime,
+                r.finalPosition.x, r.finalPosition.y, r.finalPosition.z,
+                r.finalOrientation.w, r.finalOrientation.x, r.finalOrientation.y, r.finalOrientation.z, r.finalTilt, r.finalHash);
+    }
+
+    fclose(file);
+    return true;
+}
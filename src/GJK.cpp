@@ -0,0 +1,446 @@
+#include "GJK.h"
+
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+
+using namespace glm;
+
+namespace {
+    const int maxIterations = 64;
+    const int maxPolytopeIterations = 256;  // round hulls need many vertices before the depth is accurate
+    const float smallDistance = 0.000001f;
+    const float convergence = 0.00001f;     // relative progress below which GJK stops
+    const float epaTolerance = 0.0001f;     // absolute error of the penetration depth
+
+    // Point of the Minkowski difference a - b with the points of a and b it comes from
+    struct SupportPoint {
+        vec3 w;
+        vec3 a;
+        vec3 b;
+    };
+
+    class MinkowskiDifference {
+    public:
+        MinkowskiDifference(const ConvexHull &a, const mat4 &aToB, const ConvexHull &b) : m_a(a), m_aToB(aToB), m_b(b) {
+            m_bToADirection = transpose(mat3(aToB));
+        }
+
+        SupportPoint support(const vec3 &direction) const {
+            SupportPoint point;
+            point.a = vec3(m_aToB * vec4(m_a.support(m_bToADirection * direction), 1.f));
+            point.b = m_b.support(-direction);
+            point.w = point.a - point.b;
+            return point;
+        }
+
+    private:
+        const ConvexHull &m_a;
+        const mat4 &m_aToB;
+        mat3 m_bToADirection;
+        const ConvexHull &m_b;
+    };
+
+    // The closest point of the simplex to the origin is sum(weights[i] * points[i].w)
+    struct Simplex {
+        SupportPoint points[4];
+        float weights[4];
+        int size;
+
+        void set(int count, const SupportPoint *newPoints, const float *newWeights) {
+            SupportPoint copy[4] = { newPoints[0], newPoints[count > 1 ? 1 : 0], newPoints[count > 2 ? 2 : 0], newPoints[count > 3 ? 3 : 0] };
+            for (int i = 0; i < count; ++i) {
+                points[i] = copy[i];
+                weights[i] = newWeights[i];
+            }
+            size = count;
+        }
+
+        vec3 closest() const {
+            vec3 point = vec3(0, 0, 0);
+            for (int i = 0; i < size; ++i) {
+                point += weights[i] * points[i].w;
+            }
+            return point;
+        }
+    };
+
+    void closestOnSegment(const SupportPoint &a, const SupportPoint &b, Simplex &simplex) {
+        vec3 ab = b.w - a.w;
+        float t = dot(-a.w, ab) / std::max(dot(ab, ab), smallDistance * smallDistance);
+
+        SupportPoint points[2] = { a, b };
+        if (t <= 0) {
+            float weights[1] = { 1 };
+            simplex.set(1, &points[0], weights);
+        } else if (t >= 1) {
+            float weights[1] = { 1 };
+            simplex.set(1, &points[1], weights);
+        } else {
+            float weights[2] = { 1 - t, t };
+            simplex.set(2, points, weights);
+        }
+    }
+
+    // Real-Time Collision Detection (Ericson), 5.1.5 with the origin as the query point
+    void closestOnTriangle(const SupportPoint &a, const SupportPoint &b, const SupportPoint &c, Simplex &simplex) {
+        vec3 ab = b.w - a.w;
+        vec3 ac = c.w - a.w;
+
+        float d1 = dot(ab, -a.w);
+        float d2 = dot(ac, -a.w);
+        if (d1 <= 0 && d2 <= 0) {
+            float weights[1] = { 1 };
+            simplex.set(1, &a, weights);
+            return;
+        }
+
+        float d3 = dot(ab, -b.w);
+        float d4 = dot(ac, -b.w);
+        if (d3 >= 0 && d4 <= d3) {
+            float weights[1] = { 1 };
+            simplex.set(1, &b, weights);
+            return;
+        }
+
+        float vc = d1 * d4 - d3 * d2;
+        if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+            closestOnSegment(a, b, simplex);
+            return;
+        }
+
+        float d5 = dot(ab, -c.w);
+        float d6 = dot(ac, -c.w);
+        if (d6 >= 0 && d5 <= d6) {
+            float weights[1] = { 1 };
+            simplex.set(1, &c, weights);
+            return;
+        }
+
+        float vb = d5 * d2 - d1 * d6;
+        if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+            closestOnSegment(a, c, simplex);
+            return;
+        }
+
+        float va = d3 * d6 - d5 * d4;
+        if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) {
+            closestOnSegment(b, c, simplex);
+            return;
+        }
+
+        float denominator = va + vb + vc;
+        if (std::abs(denominator) < smallDistance * smallDistance) {
+            // degenerate triangle
+            closestOnSegment(a, b, simplex);
+            return;
+        }
+
+        SupportPoint points[3] = { a, b, c };
+        float weights[3] = { va / denominator, vb / denominator, vc / denominator };
+        simplex.set(3, points, weights);
+    }
+
+    // true if the origin and d are on different sides of the plane through a, b and c
+    bool originOutsideOfPlane(const vec3 &a, const vec3 &b, const vec3 &c, const vec3 &d) {
+        vec3 normal = cross(b - a, c - a);
+        return dot(-a, normal) * dot(d - a, normal) < 0;
+    }
+
+    // Returns true if the tetrahedron contains the origin, otherwise reduces the simplex to the closest face
+    bool closestOnTetrahedron(const SupportPoint &a, const SupportPoint &b, const SupportPoint &c, const SupportPoint &d, Simplex &simplex) {
+        const SupportPoint *faces[4][4] = {
+            { &a, &b, &c, &d },
+            { &a, &c, &d, &b },
+            { &a, &d, &b, &c },
+            { &b, &d, &c, &a }
+        };
+
+        // a flat tetrahedron (e.g. touching faces) contains nothing, its faces are all candidates
+        float volume = dot(d.w - a.w, cross(b.w - a.w, c.w - a.w));
+        float scale = length(b.w - a.w) * length(c.w - a.w) * length(d.w - a.w);
+        bool flat = std::abs(volume) <= convergence * scale;
+
+        float bestDistance = std::numeric_limits<float>::max();
+        bool outside = false;
+        Simplex best = simplex;
+
+        for (int i = 0; i < 4; ++i) {
+            if (flat || originOutsideOfPlane(faces[i][0]->w, faces[i][1]->w, faces[i][2]->w, faces[i][3]->w)) {
+                outside = true;
+
+                Simplex candidate = simplex;
+                closestOnTriangle(*faces[i][0], *faces[i][1], *faces[i][2], candidate);
+                vec3 closest = candidate.closest();
+                if (dot(closest, closest) < bestDistance) {
+                    bestDistance = dot(closest, closest);
+                    best = candidate;
+                }
+            }
+        }
+
+        if (!outside) {
+            SupportPoint points[4] = { a, b, c, d };
+            float weights[4] = { 0.25f, 0.25f, 0.25f, 0.25f };
+            simplex.set(4, points, weights);
+            return true;
+        }
+
+        simplex = best;
+        return false;
+    }
+
+    // Returns true if the origin lies in the Minkowski difference, otherwise the simplex holds the closest feature
+    bool runGJK(const MinkowskiDifference &difference, Simplex &simplex) {
+        float weights[1] = { 1 };
+        SupportPoint first = difference.support(vec3(1, 0, 0));
+        simplex.set(1, &first, weights);
+
+        for (int iteration = 0; iteration < maxIterations; ++iteration) {
+            vec3 v = simplex.closest();
+            float squaredDistance = dot(v, v);
+            if (squaredDistance < smallDistance * smallDistance) {
+                return true;
+            }
+
+            SupportPoint w = difference.support(-v);
+            if (squaredDistance - dot(v, w.w) <= convergence * squaredDistance) {
+                return false;
+            }
+
+            bool contained;
+            if (simplex.size == 1) {
+                closestOnSegment(simplex.points[0], w, simplex);
+                contained = false;
+            } else if (simplex.size == 2) {
+                closestOnTriangle(simplex.points[0], simplex.points[1], w, simplex);
+                contained = false;
+            } else {
+                SupportPoint a = simplex.points[0];
+                SupportPoint b = simplex.points[1];
+                SupportPoint c = simplex.points[2];
+                contained = closestOnTetrahedron(a, b, c, w, simplex);
+            }
+
+            if (contained) {
+                return true;
+            }
+
+            // no progress any more because of rounding
+            vec3 next = simplex.closest();
+            if (dot(next, next) >= squaredDistance) {
+                return false;
+            }
+        }
+
+        return false;
+    }
+
+    // Adds support points until the simplex is a tetrahedron with volume, false if the difference is flat
+    bool completeTetrahedron(const MinkowskiDifference &difference, Simplex &simplex) {
+        const vec3 axes[6] = { vec3(1, 0, 0), vec3(-1, 0, 0), vec3(0, 1, 0), vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1) };
+
+        if (simplex.size == 1) {
+            for (int i = 0; i < 6 && simplex.size == 1; ++i) {
+                SupportPoint point = difference.support(axes[i]);
+                if (length(point.w - simplex.points[0].w) > smallDistance) {
+                    simplex.points[simplex.size++] = point;
+                }
+            }
+        }
+
+        if (simplex.size == 2) {
+            vec3 direction = simplex.points[1].w - simplex.points[0].w;
+            for (int i = 0; i < 6 && simplex.size == 2; ++i) {
+                vec3 perpendicular = cross(direction, axes[i]);
+                if (length(perpendicular) < smallDistance) {
+                    continue;
+                }
+                SupportPoint point = difference.support(perpendicular);
+                if (length(cross(point.w - simplex.points[0].w, normalize(direction))) > smallDistance) {
+                    simplex.points[simplex.size++] = point;
+                }
+            }
+        }
+
+        if (simplex.size == 3) {
+            vec3 normal = cross(simplex.points[1].w - simplex.points[0].w, simplex.points[2].w - simplex.points[0].w);
+            if (length(normal) < smallDistance * smallDistance) {
+                return false;
+            }
+            normal = normalize(normal);
+
+            for (int side = 0; side < 2 && simplex.size == 3; ++side) {
+                SupportPoint point = difference.support(side == 0 ? normal : -normal);
+                if (std::abs(dot(point.w - simplex.points[0].w, normal)) > smallDistance) {
+                    simplex.points[simplex.size++] = point;
+                }
+            }
+        }
+
+        return simplex.size == 4;
+    }
+
+    struct PolytopeFace {
+        int a, b, c;
+        vec3 normal;        // pointing outwards
+        float distance;     // of the plane to the origin
+        bool removed;
+    };
+
+    bool makePolytopeFace(const std::vector<SupportPoint> &vertices, int a, int b, int c, PolytopeFace &face) {
+        vec3 normal = cross(vertices[b].w - vertices[a].w, vertices[c].w - vertices[a].w);
+        if (length(normal) < smallDistance * smallDistance) {
+            return false;
+        }
+
+        face.a = a;
+        face.b = b;
+        face.c = c;
+        face.normal = normalize(normal);
+        face.distance = dot(face.normal, vertices[a].w);
+        face.removed = false;
+        return true;
+    }
+}
+
+float GJK::distance(const ConvexHull &a, const mat4 &aToB, const ConvexHull &b, vec3 &pointA, vec3 &pointB) {
+    MinkowskiDifference difference = MinkowskiDifference(a, aToB, b);
+    Simplex simplex;
+
+    bool overlapping = runGJK(difference, simplex);
+
+    pointA = vec3(0, 0, 0);
+    pointB = vec3(0, 0, 0);
+    for (int i = 0; i < simplex.size; ++i) {
+        pointA += simplex.weights[i] * simplex.points[i].a;
+        pointB += simplex.weights[i] * simplex.points[i].b;
+    }
+
+    return overlapping ? 0.f : length(simplex.closest());
+}
+
+bool GJK::penetration(const ConvexHull &a, const mat4 &aToB, const ConvexHull &b, vec3 &point, vec3 &normal, float &depth) {
+    MinkowskiDifference difference = MinkowskiDifference(a, aToB, b);
+    Simplex simplex;
+
+    if (!runGJK(difference, simplex) || !completeTetrahedron(difference, simplex)) {
+        return false;
+    }
+
+    // expanding polytope: push the face closest to the origin outwards until it is on the surface of the difference
+    std::vector<SupportPoint> vertices = std::vector<SupportPoint>(simplex.points, simplex.points + 4);
+    std::vector<PolytopeFace> faces = std::vector<PolytopeFace>();
+
+    const int tetrahedron[4][4] = { { 0, 1, 2, 3 }, { 0, 3, 1, 2 }, { 0, 2, 3, 1 }, { 1, 3, 2, 0 } };
+    for (int i = 0; i < 4; ++i) {
+        PolytopeFace tetrahedronFace;
+        if (!makePolytopeFace(vertices, tetrahedron[i][0], tetrahedron[i][1], tetrahedron[i][2], tetrahedronFace)) {
+            return false;
+        }
+        if (dot(tetrahedronFace.normal, vertices[tetrahedron[i][3]].w - vertices[tetrahedronFace.a].w) > 0) {
+            makePolytopeFace(vertices, tetrahedron[i][0], tetrahedron[i][2], tetrahedron[i][1], tetrahedronFace);
+        }
+        faces.push_back(tetrahedronFace);
+    }
+
+    std::vector<std::pair<int, int> > horizon = std::vector<std::pair<int, int> >();
+    PolytopeFace face = faces[0];
+    bool first = true;
+
+    for (int iteration = 0; iteration < maxPolytopeIterations; ++iteration) {
+        int closest = -1;
+        for (size_t i = 0; i < faces.size(); ++i) {
+            if (!faces[i].removed && (closest < 0 || faces[i].distance < faces[closest].distance)) {
+                closest = (int)i;
+            }
+        }
+        if (closest < 0) {
+            return false;
+        }
+
+        // the distance only grows, otherwise rounding has bent the polytope and the last face is as good as it gets
+        if (!first && faces[closest].distance < face.distance - epaTolerance) {
+            break;
+        }
+        face = faces[closest];
+        first = false;
+
+        SupportPoint next = difference.support(face.normal);
+        if (dot(next.w, face.normal) - face.distance < epaTolerance) {
+            break;
+        }
+
+        bool known = false;
+        for (size_t i = 0; i < vertices.size() && !known; ++i) {
+            known = length(vertices[i].w - next.w) < smallDistance;
+        }
+        if (known) {
+            break;
+        }
+
+        int index = (int)vertices.size();
+        vertices.push_back(next);
+
+        // remove the faces seeing the new vertex, edges used by only one of them form the horizon
+        horizon.clear();
+        for (size_t i = 0; i < faces.size(); ++i) {
+            if (faces[i].removed || dot(faces[i].normal, next.w - vertices[faces[i].a].w) <= 0) {
+                continue;
+            }
+            faces[i].removed = true;
+
+            int edges[3][2] = { { faces[i].a, faces[i].b }, { faces[i].b, faces[i].c }, { faces[i].c, faces[i].a } };
+            for (int e = 0; e < 3; ++e) {
+                bool shared = false;
+                for (size_t h = 0; h < horizon.size(); ++h) {
+                    if (horizon[h].first == edges[e][1] && horizon[h].second == edges[e][0]) {
+                        horizon.erase(horizon.begin() + h);
+                        shared = true;
+                        break;
+                    }
+                }
+                if (!shared) {
+                    horizon.push_back(std::make_pair(edges[e][0], edges[e][1]));
+                }
+            }
+        }
+
+        for (size_t h = 0; h < horizon.size(); ++h) {
+            PolytopeFace newFace;
+            if (makePolytopeFace(vertices, horizon[h].first, horizon[h].second, index, newFace)) {
+                faces.push_back(newFace);
+            }
+        }
+    }
+
+    normal = face.normal;
+    depth = std::max(face.distance, 0.f);
+
+    // barycentric coordinates of the origin projected onto the face
+    vec3 projection = face.normal * face.distance;
+    vec3 v0 = vertices[face.b].w - vertices[face.a].w;
+    vec3 v1 = vertices[face.c].w - vertices[face.a].w;
+    vec3 v2 = projection - vertices[face.a].w;
+    float d00 = dot(v0, v0);
+    float d01 = dot(v0, v1);
+    float d11 = dot(v1, v1);
+    float d20 = dot(v2, v0);
+    float d21 = dot(v2, v1);
+    float denominator = d00 * d11 - d01 * d01;
+
+    float v = 1.f / 3.f;
+    float w = 1.f / 3.f;
+    if (std::abs(denominator) > smallDistance * smallDistance) {
+        v = (d11 * d20 - d01 * d21) / denominator;
+        w = (d00 * d21 - d01 * d20) / denominator;
+    }
+    float u = 1.f - v - w;
+
+    vec3 pointA = u * vertices[face.a].a + v * vertices[face.b].a + w * vertices[face.c].a;
+    vec3 pointB = u * vertices[face.a].b + v * vertices[face.b].b + w * vertices[face.c].b;
+    point = 0.5f * (pointA + pointB);
+
+    return true;
+}
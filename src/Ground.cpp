@@ -0,0 +1,238 @@
+#include "Ground.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace glm;
+
+namespace {
+    // unit direction away from the y axis, any for points on it
+    vec3 radialDirection(const vec3 &point, float &r) {
+        r = std::sqrt(point.x * point.x + point.z * point.z);
+        return r > 0 ? vec3(point.x / r, 0, point.z / r) : vec3(1, 0, 0);
+    }
+
+    // The closest point of y = a * r^2 in the plane through the axis solves 2 a^2 r'^3 + (1 - 2 a y) r' - r = 0
+    // (the derivative of the squared distance), a depressed cubic solved with Cardano's formula, or with the
+    // trigonometric form if it has three real roots (points below the focus can see three normals of the parabola).
+    float closestOnParabola(float a, float r, float y) {
+        double p = (1.0 - 2.0 * a * y) / (2.0 * a * a);
+        double q = -r / (2.0 * a * a);
+        double discriminant = q * q / 4.0 + p * p * p / 27.0;
+
+        if (discriminant >= 0) {
+            double root = std::sqrt(discriminant);
+            return (float)(std::cbrt(-q / 2.0 + root) + std::cbrt(-q / 2.0 - root));
+        }
+
+        double magnitude = 2.0 * std::sqrt(-p / 3.0);
+        double angle = std::acos(std::min(1.0, std::max(-1.0, 3.0 * q / (2.0 * p) * std::sqrt(-3.0 / p)))) / 3.0;
+        float closest = 0;
+        float closestDistance = -1;
+        for (int k = 0; k < 3; ++k) {
+            float candidate = (float)(magnitude * std::cos(angle - 2.0 * 3.14159265358979 * k / 3.0));
+            float dr = candidate - r;
+            float dy = a * candidate * candidate - y;
+            float distance = dr * dr + dy * dy;
+            if (closestDistance < 0 || distance < closestDistance) {
+                closest = candidate;
+                closestDistance = distance;
+            }
+        }
+        return closest;
+    }
+}
+
+Ground::Ground() {
+    m_type = PLANE;
+    m_radius = 0;
+    m_curvature = 0;
+    m_slope = 0;
+    m_heightfield = nullptr;
+}
+
+Ground::Ground(const Parameters &parameters, const Heightfield *heightfield) : Ground() {
+    switch (parameters.groundShape) {
+        case BOWL:
+            *this = bowl(parameters.groundRadius);
+            break;
+        case PARABOLOID:
+            *this = paraboloid(parameters.groundCurvature);
+            break;
+        case CONE:
+            *this = cone(parameters.groundSlope);
+            break;
+        case HEIGHTFIELD:
+            *this = Ground::heightfield(heightfield);
+            break;
+        default:
+            break;
+    }
+}
+
+Ground Ground::plane() {
+    return Ground();
+}
+
+// degenerate sizes give the plane
+Ground Ground::bowl(float radius) {
+    Ground ground;
+    if (radius > 0) {
+        ground.m_type = BOWL;
+        ground.m_radius = radius;
+    }
+    return ground;
+}
+
+Ground Ground::paraboloid(float curvature) {
+    Ground ground;
+    if (curvature > 0) {
+        ground.m_type = PARABOLOID;
+        ground.m_curvature = curvature;
+    }
+    return ground;
+}
+
+Ground Ground::cone(float slope) {
+    Ground ground;
+    if (slope > 0) {
+        ground.m_type = CONE;
+        ground.m_slope = slope;
+    }
+    return ground;
+}
+
+Ground Ground::heightfield(const Heightfield *heightfield) {
+    Ground ground;
+    if (heightfield != nullptr && heightfield->isValid()) {
+        ground.m_type = HEIGHTFIELD;
+        ground.m_heightfield = heightfield;
+    }
+    return ground;
+}
+
+Ground::Type Ground::getType() const {
+    return m_type;
+}
+
+bool Ground::isFlat() const {
+    return m_type == PLANE;
+}
+
+float Ground::distanceAt(const vec3 &point, vec3 &normal) const {
+    float r;
+    vec3 outwards = radialDirection(point, r);
+
+    switch (m_type) {
+        case BOWL: {
+            // inside of the sphere around (0, radius, 0) is free
+            vec3 center = vec3(0, m_radius, 0);
+            if (point.y <= m_radius) {
+                vec3 toCenter = center - point;
+                float distance = length(toCenter);
+                normal = distance > 0 ? toCenter / distance : vec3(0, 1, 0);
+                return m_radius - distance;
+            }
+            normal = r > 0 ? -outwards : vec3(0, 1, 0);
+            return m_radius - r;
+        }
+        case PARABOLOID: {
+            float closest = closestOnParabola(m_curvature, r, point.y);
+            float dr = closest - r;
+            float dy = m_curvature * closest * closest - point.y;
+            normal = normalize(vec3(0, 1, 0) - 2.f * m_curvature * closest * outwards);
+            float distance = std::sqrt(dr * dr + dy * dy);
+            return point.y >= m_curvature * r * r ? distance : -distance;
+        }
+        case CONE: {
+            // the line y = slope * r through the apex in the plane of the axis and the point
+            float norm = std::sqrt(1.f + m_slope * m_slope);
+            if (r + m_slope * point.y >= 0) {
+                normal = (vec3(0, 1, 0) - m_slope * outwards) / norm;
+                return (point.y - m_slope * r) / norm;
+            }
+            // below the apex, which is the closest point
+            float distance = length(point);
+            normal = -point / distance;
+            return -distance;
+        }
+        case HEIGHTFIELD:
+            return m_heightfield->distanceAt(point, normal);
+        default:
+            normal = vec3(0, 1, 0);
+            return point.y;
+    }
+}
+
+bool Ground::isAbove(const vec3 &lower, const vec3 &upper) const {
+    // the analytic surfaces rise away from the axis, the highest point under the box is at its farthest corner
+    float farthest = length(vec2(std::max(std::abs(lower.x), std::abs(upper.x)), std::max(std::abs(lower.z), std::abs(upper.z))));
+
+    switch (m_type) {
+        case BOWL:
+            return farthest < m_radius && lower.y > m_radius - std::sqrt(m_radius * m_radius - farthest * farthest);
+        case PARABOLOID:
+            return lower.y > m_curvature * farthest * farthest;
+        case CONE:
+            return lower.y > m_slope * farthest;
+        case HEIGHTFIELD: {
+            float lowest, highest;
+            m_heightfield->heightRangeIn(lower.x, lower.z, upper.x, upper.z, lowest, highest);
+            return lower.y > highest;
+        }
+        default:
+            return lower.y > 0;
+    }
+}
+
+int Ground::lowestVertex(const ConvexHull &hull, const mat4 &model, int start, float &distance, vec3 &normal) const {
+    const std::vector<vec3> &vertices = hull.getVertices();
+
+    // The distance over the hull can have several local minima, e.g. on both sides of the apex of the cone. The walk
+    // starts at the last result, at the vertex farthest into the ground below the body as for a plane with the
+    // normal there, and at the lowest vertex.
+    vec3 centerNormal;
+    distanceAt(vec3(model[3]), centerNormal);
+    int starts[3];
+    starts[0] = start;
+    starts[1] = hull.supportIndex(-(transpose(mat3(model)) * centerNormal), start);
+    starts[2] = hull.supportIndex(-vec3(model[0][1], model[1][1], model[2][1]), start);
+
+    int lowest = start;
+    distance = std::numeric_limits<float>::max();
+    for (int i = 0; i < 3; ++i) {
+        if (i > 0 && (starts[i] == starts[0] || starts[i] == starts[i-1])) {
+            continue;
+        }
+
+        int vertex = starts[i];
+        vec3 vertexNormal;
+        float vertexDistance = distanceAt(vec3(model * vec4(vertices[vertex], 1.f)), vertexNormal);
+
+        // walk to neighbours closer to the surface
+        bool improved = true;
+        while (improved) {
+            improved = false;
+            const std::vector<int> &neighbours = hull.getNeighbours(vertex);
+            for (size_t j = 0; j < neighbours.size(); ++j) {
+                vec3 neighbourNormal;
+                float neighbourDistance = distanceAt(vec3(model * vec4(vertices[neighbours[j]], 1.f)), neighbourNormal);
+                if (neighbourDistance < vertexDistance) {
+                    vertex = neighbours[j];
+                    vertexDistance = neighbourDistance;
+                    vertexNormal = neighbourNormal;
+                    improved = true;
+                }
+            }
+        }
+
+        if (vertexDistance < distance) {
+            lowest = vertex;
+            distance = vertexDistance;
+            normal = vertexNormal;
+        }
+    }
+
+    return lowest;
+}
@@ -0,0 +1,197 @@
+#include "Heightfield.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include <stb_image.h>
+
+using namespace glm;
+
+Heightfield::Heightfield() {
+    m_width = 0;
+    m_depth = 0;
+    m_size = vec3(0, 0, 0);
+    m_cellSize = vec2(0, 0);
+}
+
+Heightfield::Heightfield(const std::string &filename, const vec3 &size) : Heightfield() {
+    int width, depth, channels;
+    uint8_t *image = stbi_load(filename.c_str(), &width, &depth, &channels, 1);
+    if (image == nullptr) {
+        printf("ERROR: Could not load the heightfield '%s'.\n", filename.c_str());
+        return;
+    }
+
+    std::vector<float> heights = std::vector<float>(width * depth);
+    for (int i = 0; i < width * depth; ++i) {
+        heights[i] = image[i] / 255.f * size.y;
+    }
+    stbi_image_free(image);
+
+    *this = Heightfield(heights, width, depth, size);
+}
+
+Heightfield::Heightfield(const std::vector<float> &heights, int width, int depth, const vec3 &size) : Heightfield() {
+    if (width < 2 || depth < 2 || (int)heights.size() < width * depth) {
+        return;
+    }
+
+    m_width = width;
+    m_depth = depth;
+    m_size = size;
+    m_cellSize = vec2(size.x / (width - 1), size.z / (depth - 1));
+    m_heights = std::vector<float>(heights.begin(), heights.begin() + width * depth);
+
+    buildPyramid();
+}
+
+void Heightfield::buildPyramid() {
+    int levelWidth = m_width - 1;
+    int levelDepth = m_depth - 1;
+
+    std::vector<float> lowest = std::vector<float>(levelWidth * levelDepth);
+    std::vector<float> highest = std::vector<float>(levelWidth * levelDepth);
+    for (int z = 0; z < levelDepth; ++z) {
+        for (int x = 0; x < levelWidth; ++x) {
+            float h00 = sampleAt(x, z);
+            float h10 = sampleAt(x + 1, z);
+            float h01 = sampleAt(x, z + 1);
+            float h11 = sampleAt(x + 1, z + 1);
+            // the bilinear patch lies between its corners
+            lowest[x + levelWidth * z] = std::min(std::min(h00, h10), std::min(h01, h11));
+            highest[x + levelWidth * z] = std::max(std::max(h00, h10), std::max(h01, h11));
+        }
+    }
+
+    while (true) {
+        m_lowest.push_back(lowest);
+        m_highest.push_back(highest);
+        m_levelWidths.push_back(levelWidth);
+
+        if (levelWidth == 1 && levelDepth == 1) {
+            break;
+        }
+
+        int parentWidth = (levelWidth + 1) / 2;
+        int parentDepth = (levelDepth + 1) / 2;
+        std::vector<float> parentLowest = std::vector<float>(parentWidth * parentDepth);
+        std::vector<float> parentHighest = std::vector<float>(parentWidth * parentDepth);
+        for (int z = 0; z < parentDepth; ++z) {
+            for (int x = 0; x < parentWidth; ++x) {
+                float low = lowest[2 * x + levelWidth * 2 * z];
+                float high = highest[2 * x + levelWidth * 2 * z];
+                for (int child = 1; child < 4; ++child) {
+                    int childX = std::min(2 * x + (child & 1), levelWidth - 1);
+                    int childZ = std::min(2 * z + (child >> 1), levelDepth - 1);
+                    low = std::min(low, lowest[childX + levelWidth * childZ]);
+                    high = std::max(high, highest[childX + levelWidth * childZ]);
+                }
+                parentLowest[x + parentWidth * z] = low;
+                parentHighest[x + parentWidth * z] = high;
+            }
+        }
+
+        lowest = parentLowest;
+        highest = parentHighest;
+        levelWidth = parentWidth;
+        levelDepth = parentDepth;
+    }
+}
+
+bool Heightfield::isValid() const {
+    return m_width >= 2 && m_depth >= 2;
+}
+
+int Heightfield::getWidth() const {
+    return m_width;
+}
+
+int Heightfield::getDepth() const {
+    return m_depth;
+}
+
+vec3 Heightfield::getSize() const {
+    return m_size;
+}
+
+float Heightfield::sampleAt(int x, int z) const {
+    return m_heights[x + m_width * z];
+}
+
+// cell of a coordinate along x (axis 0) or z (axis 1), clamped to the grid
+int Heightfield::cellIndex(float coordinate, int axis) const {
+    int cells = axis == 0 ? m_width - 1 : m_depth - 1;
+    float grid = (coordinate + 0.5f * (axis == 0 ? m_size.x : m_size.z)) / m_cellSize[axis];
+    return std::min(std::max((int)std::floor(grid), 0), cells - 1);
+}
+
+float Heightfield::heightAt(float x, float z, vec3 &normal) const {
+    normal = vec3(0, 1, 0);
+    if (!isValid()) {
+        return 0;
+    }
+
+    float gridX = (x + 0.5f * m_size.x) / m_cellSize.x;
+    float gridZ = (z + 0.5f * m_size.z) / m_cellSize.y;
+    int cellX = cellIndex(x, 0);
+    int cellZ = cellIndex(z, 1);
+
+    // outside of the grid the border continues, flat across it
+    float fractionX = std::min(std::max(gridX - cellX, 0.f), 1.f);
+    float fractionZ = std::min(std::max(gridZ - cellZ, 0.f), 1.f);
+    bool insideX = fractionX == gridX - cellX;
+    bool insideZ = fractionZ == gridZ - cellZ;
+
+    float h00 = sampleAt(cellX, cellZ);
+    float h10 = sampleAt(cellX + 1, cellZ);
+    float h01 = sampleAt(cellX, cellZ + 1);
+    float h11 = sampleAt(cellX + 1, cellZ + 1);
+
+    float height = (h00 * (1.f - fractionX) + h10 * fractionX) * (1.f - fractionZ) + (h01 * (1.f - fractionX) + h11 * fractionX) * fractionZ;
+
+    // derivatives of the bilinear patch
+    float slopeX = insideX ? ((h10 - h00) * (1.f - fractionZ) + (h11 - h01) * fractionZ) / m_cellSize.x : 0.f;
+    float slopeZ = insideZ ? ((h01 - h00) * (1.f - fractionX) + (h11 - h10) * fractionX) / m_cellSize.y : 0.f;
+    normal = normalize(vec3(-slopeX, 1, -slopeZ));
+
+    return height;
+}
+
+float Heightfield::distanceAt(const vec3 &point, vec3 &normal) const {
+    float height = heightAt(point.x, point.z, normal);
+    // the distance to the tangent plane, exact for flat cells
+    return (point.y - height) * normal.y;
+}
+
+void Heightfield::heightRangeIn(float lowerX, float lowerZ, float upperX, float upperZ, float &lowest, float &highest) const {
+    lowest = 0;
+    highest = 0;
+    if (!isValid()) {
+        return;
+    }
+
+    int x0 = cellIndex(lowerX, 0);
+    int z0 = cellIndex(lowerZ, 1);
+    int x1 = cellIndex(upperX, 0);
+    int z1 = cellIndex(upperZ, 1);
+
+    // the lowest level on which the rectangle touches at most 2x2 nodes
+    size_t level = 0;
+    while (level + 1 < m_lowest.size() && ((x1 >> level) - (x0 >> level) > 1 || (z1 >> level) - (z0 >> level) > 1)) {
+        ++level;
+    }
+
+    const std::vector<float> &levelLowest = m_lowest[level];
+    const std::vector<float> &levelHighest = m_highest[level];
+    int levelWidth = m_levelWidths[level];
+
+    lowest = levelLowest[(x0 >> level) + levelWidth * (z0 >> level)];
+    highest = levelHighest[(x0 >> level) + levelWidth * (z0 >> level)];
+    for (int z = z0 >> level; z <= (z1 >> level); ++z) {
+        for (int x = x0 >> level; x <= (x1 >> level); ++x) {
+            lowest = std::min(lowest, levelLowest[x + levelWidth * z]);
+            highest = std::max(highest, levelHighest[x + levelWidth * z]);
+        }
+    }
+}
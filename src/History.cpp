@@ -0,0 +1,142 @@
+#include "History.h"
+
+#include <algorithm>
+
+const size_t DEFAULT_MAX_NUMBER_OF_STEPS = 30000;   // 5 minutes with 100 steps per second
+const size_t DEFAULT_KEYFRAME_INTERVAL = 100;
+
+History::History() {
+    m_maxNumberOfSteps = DEFAULT_MAX_NUMBER_OF_STEPS;
+    m_keyframeInterval = DEFAULT_KEYFRAME_INTERVAL;
+    clear();
+}
+
+void History::clear() {
+    m_keyframes.clear();
+    m_steps.clear();
+    m_firstStep = 0;
+    m_firstKeyframe = 0;
+}
+
+void History::setMaxNumberOfSteps(size_t maxNumberOfSteps) {
+    m_maxNumberOfSteps = std::max((size_t)1, maxNumberOfSteps);
+}
+
+void History::setKeyframeInterval(size_t keyframeInterval) {
+    m_keyframeInterval = std::max((size_t)1, keyframeInterval);
+}
+
+bool History::record(const std::vector<RigidBody> &state, double time, bool forceKeyframe) {
+    size_t step = m_firstStep + m_steps.size();
+
+    bool keyframe = forceKeyframe || m_keyframes.empty() ||
+                    step - m_keyframes.back().step >= m_keyframeInterval ||
+                    state.size() != m_keyframes.back().state.size();
+
+    if (keyframe) {
+        Keyframe k;
+        k.step = step;
+        k.state = state;
+        m_keyframes.push_back(k);
+    }
+
+    Step s;
+    s.keyframe = m_firstKeyframe + m_keyframes.size() - 1;
+    s.time = time;
+    s.states.reserve(state.size());
+    for (size_t i = 0; i < state.size(); ++i) {
+        s.states.push_back(state[i].getState());
+    }
+    m_steps.push_back(s);
+
+    while (m_steps.size() > m_maxNumberOfSteps) {
+        m_steps.pop_front();
+        m_firstStep++;
+    }
+
+    // keyframes which no remaining step refers to
+    while (m_firstKeyframe < m_steps.front().keyframe) {
+        m_keyframes.pop_front();
+        m_firstKeyframe++;
+    }
+
+    return keyframe;
+}
+
+void History::erase(size_t step) {
+    if (step < m_firstStep) {
+        clear();
+        return;
+    }
+
+    while (!m_steps.empty() && m_firstStep + m_steps.size() > step) {
+        m_steps.pop_back();
+    }
+
+    while (!m_keyframes.empty() && m_keyframes.back().step >= step) {
+        m_keyframes.pop_back();
+    }
+
+    if (m_steps.empty()) {
+        clear();
+        m_firstStep = step;
+    }
+}
+
+bool History::isEmpty() const {
+    return m_steps.empty();
+}
+
+size_t History::getNumberOfSteps() const {
+    return m_steps.size();
+}
+
+size_t History::getFirstStep() const {
+    return m_firstStep;
+}
+
+size_t History::getLastStep() const {
+    return m_steps.empty() ? m_firstStep : m_firstStep + m_steps.size() - 1;
+}
+
+double History::getTime(size_t step) const {
+    if (m_steps.empty()) {
+        return 0;
+    }
+    step = std::min(std::max(step, m_firstStep), getLastStep());
+    return m_steps[step - m_firstStep].time;
+}
+
+size_t History::findStep(double time) const {
+    // the times are increasing
+    std::deque<Step>::const_iterator it = std::upper_bound(m_steps.begin(), m_steps.end(), time,
+        [](double t, const Step &s) { return t < s.time; });
+
+    if (it == m_steps.begin()) {
+        return m_firstStep;
+    }
+    return m_firstStep + (it - m_steps.begin()) - 1;
+}
+
+size_t History::getKeyframeStep(size_t step) const {
+    if (m_steps.empty()) {
+        return m_firstStep;
+    }
+    step = std::min(std::max(step, m_firstStep), getLastStep());
+    return m_keyframes[m_steps[step - m_firstStep].keyframe - m_firstKeyframe].step;
+}
+
+bool History::restore(size_t step, std::vector<RigidBody> &state) const {
+    if (m_steps.empty() || step < m_firstStep || step > getLastStep()) {
+        return false;
+    }
+
+    const Step &s = m_steps[step - m_firstStep];
+    state = m_keyframes[s.keyframe - m_firstKeyframe].state;
+
+    for (size_t i = 0; i < state.size(); ++i) {
+        state[i].setState(s.states[i]);
+    }
+
+    return true;
+}
@@ -1,7 +1,13 @@
 #include "Assets.h"
+#include "Benchmark.h"
 #include "Camera.h"
+#include "Ensemble.h"
 #include "PointLight.h"
+#include "Regression.h"
+#include "Shape.h"
 #include "Simulation.h"
+#include "StateHash.h"
+#include "Sweep.h"
 
 #include <GL/gl3w.h>
 #include <GLFW/glfw3.h>
@@ -33,7 +39,7 @@ char keyOnce[GLFW_KEY_LAST + 1];
 void glfwWindowResizeCallback(GLFWwindow *window, int width, int height);
 void glfwFrameBufferSizeCallback(GLFWwindow *window, int width, int height);
 
-void setupContext();
+bool setupContext(bool visible = true);
 void destroyContext();
 
 void render(vector<RigidBody> * state);
@@ -52,6 +58,11 @@ bool slowMotion;
 // to pause the simulation
 bool pause;
 
+// time on the timeline while scrubbing through the history
+bool scrubbing;
+double scrubTime;
+float playbackSpeed = 1.f;
+
 // render debug information (CoM only currently)
 bool debug;
 
@@ -64,6 +75,9 @@ bool wireframe;
 // For reducing CPU usage when idle
 time_t lastMovement;
 
+// left mouse button held since the last pick
+bool picking;
+
 GLFWwindow *window;
 
 Camera camera;
@@ -86,6 +100,32 @@ void resetCamera() {
     camera.setAspectRatio((float)width/height);
 }
 
+// activates the spinning top under the cursor
+void pickRigidBody() {
+    double x, y;
+    int windowWidth, windowHeight;
+    glfwGetCursorPos(window, &x, &y);
+    glfwGetWindowSize(window, &windowWidth, &windowHeight);
+    if (windowWidth <= 0 || windowHeight <= 0) {
+        return;
+    }
+    
+    // the cursor on the near and far plane
+    vec2 device = vec2(2.f * x / windowWidth - 1.f, 1.f - 2.f * y / windowHeight);
+    mat4 inverseCamera = inverse(camera.matrix());
+    vec4 nearPoint = inverseCamera * vec4(device.x, device.y, -1.f, 1.f);
+    vec4 farPoint = inverseCamera * vec4(device.x, device.y, 1.f, 1.f);
+    
+    Ray ray;
+    ray.origin = vec3(nearPoint) / nearPoint.w;
+    ray.direction = normalize(vec3(farPoint) / farPoint.w - ray.origin);
+    
+    RayHit hit;
+    if (simulation.raycast(ray, hit) && !hit.isStatic) {
+        simulation.setActiveRigidBody(hit.body);
+    }
+}
+
 void addTorque(RigidBody *rb, vec3 force) {
     vec3 F1 = force;
     vec3 F2 = -1.f * force;
@@ -125,11 +165,102 @@ void interpolateStates(vector<RigidBody> *fromState, vector<RigidBody> *toState,
     }
 }
 
-int main() {
+// Simulates many perturbed copies of a scene without rendering, e.g. --ensemble type=3 runs=1000 out=results.csv
+int runEnsemble(int argc, char *argv[]) {
+    EnsembleConfig config;
+    if (!Ensemble::parseArguments(argc, argv, config)) {
+        return 1;
+    }
+    
+    Ensemble ensemble = Ensemble(config);
+    ensemble.run();
+    ensemble.printSummary();
+    return 0;
+}
+
+// Simulates a scene for many contact parameters without rendering, e.g. --sweep restitution=0.1:0.5:5 samples=0
+int runSweep(int argc, char *argv[]) {
+    SweepConfig config;
+    config.scene.runs = 1;
+    if (!Sweep::parseArguments(argc, argv, config)) {
+        return 1;
+    }
+    
+    Sweep sweep = Sweep(config);
+    sweep.run();
+    return 0;
+}
+
+// Compares a catalogue of scenes against golden trajectories and reference timing budgets, e.g. --regression dir=regression record=1
+int runRegression(int argc, char *argv[]) {
+    RegressionConfig config;
+    if (!Regression::parseArguments(argc, argv, config)) {
+        return 1;
+    }
+    
+    Regression regression = Regression(config);
+    bool passed = regression.run();
+    regression.printReport();
+    return passed ? 0 : 1;
+}
+
+// Measures the collision detection of the spinning tops and compares the hierarchies of the models, e.g. --benchmark type=3 poses=100
+int runBenchmark(int argc, char *argv[]) {
+    BenchmarkConfig config;
+    if (!Benchmark::parseArguments(argc, argv, config)) {
+        return 1;
+    }
+    
+    Benchmark benchmark = Benchmark(config);
+    benchmark.run();
+    return 0;
+}
+
+// Finds the first step in which two runs diverge, e.g. --compare-hashes hashes1/run0.txt hashes8/run0.txt
+int runCompareHashes(int argc, char *argv[]) {
+    if (argc != 2) {
+        printf("ERROR: Expected two state hash files.\n");
+        return 1;
+    }
+    
+    std::vector<uint64_t> a, b;
+    if (!StateHash::read(argv[0], a) || !StateHash::read(argv[1], b)) {
+        return 1;
+    }
+    
+    long step = StateHash::firstDivergence(a, b);
+    if (step < 0) {
+        printf("Info: All %lu states are identical.\n", a.size());
+        return 0;
+    }
+    
+    printf("Info: First divergence after step %ld (%lu and %lu steps).\n", step + 1, a.size(), b.size());
+    return 2;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && string(argv[1]) == "--ensemble") {
+        return runEnsemble(argc - 2, argv + 2);
+    }
+    if (argc > 1 && string(argv[1]) == "--sweep") {
+        return runSweep(argc - 2, argv + 2);
+    }
+    if (argc > 1 && string(argv[1]) == "--regression") {
+        return runRegression(argc - 2, argv + 2);
+    }
+    if (argc > 1 && string(argv[1]) == "--benchmark") {
+        return runBenchmark(argc - 2, argv + 2);
+    }
+    if (argc > 1 && string(argv[1]) == "--compare-hashes") {
+        return runCompareHashes(argc - 2, argv + 2);
+    }
+    
     time_t begin = time(0);
     lastMovement = time(0);
     
-    setupContext();
+    if (!setupContext()) {
+        return 1;
+    }
     
     if (timeStepMethod == 2) { // turn off vsync or so..
         glfwSwapInterval(0);
@@ -232,7 +363,7 @@ int main() {
                 
                 double alpha = accumulator / timeStep;
                 
-                if (simulation.getNumberOfStates() > 1) {
+                if (simulation.getLastState() != nullptr) {
                     vector<RigidBody> interpolatedState = vector<RigidBody>();
                     
                     interpolateStates(simulation.getLastState(), simulation.getCurrentState(), &interpolatedState, alpha);
@@ -324,6 +455,11 @@ void render(vector<RigidBody> *state) {
     
     table.render();
     
+    vector<RigidBody> *staticBodies = simulation.getStaticBodies();
+    for (size_t i = 0; i < staticBodies->size(); ++i) {
+        staticBodies->at(i).render();
+    }
+    
     Assets::getPhongShader()->use();
     
     light.setUniforms();
@@ -380,6 +516,26 @@ void input(float dt) {
         simulation.toggleActiveRigidBody();
     }
     
+    if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS) {
+        if (!picking) {
+            pickRigidBody();
+        }
+        picking = true;
+    } else {
+        picking = false;
+    }
+    
+    // a small table standing on the ground next to the drop position as obstacle
+    if (glfwGetKeyOnce(window, GLFW_KEY_L)) {
+        if (simulation.getStaticBodies()->size() == 0) {
+            // the table has degenerate triangles, which only the SAH hierarchy can split
+            Shape::setSplitMethod(Assets::getTable(), OOBB::SAH);
+            simulation.addStaticBody(Assets::getTable(), glm::vec3(0, 1.533f, -5), glm::quat(), glm::vec3(1, 1, 1));
+        } else {
+            simulation.removeAllStaticBodies();
+        }
+    }
+    
     if (glfwGetKeyOnce(window, GLFW_KEY_F)) {
         wireframe = !wireframe;
     }
@@ -560,18 +716,50 @@ void input(float dt) {
         }
     }
     
+    // Timeline
+    
+    if (glfwGetKeyOnce(window, GLFW_KEY_MINUS)) {
+        playbackSpeed /= 2;
+        printf("Info: Playback speed %gx.\n", playbackSpeed);
+    }
+    
+    if (glfwGetKeyOnce(window, GLFW_KEY_EQUAL)) {
+        playbackSpeed *= 2;
+        printf("Info: Playback speed %gx.\n", playbackSpeed);
+    }
+    
+    int scrubDirection = (glfwGetKey(window, GLFW_KEY_RIGHT_BRACKET) ? 1 : 0) - (glfwGetKey(window, GLFW_KEY_LEFT_BRACKET) ? 1 : 0);
+    if (scrubDirection != 0) {
+        if (!scrubbing) {
+            scrubbing = true;
+            scrubTime = simulation.getTime();
+            if (!pause) {
+                pause = true;
+                printf("Info: Simulation paused.\n");
+            }
+        }
+        
+        // accumulate, since a frame is usually shorter than a step
+        scrubTime = glm::clamp(scrubTime + scrubDirection * playbackSpeed * dt, simulation.getFirstTime(), simulation.getLastTime());
+        simulation.seek(scrubTime);
+    } else {
+        scrubbing = false;
+    }
+    
     // Window closing
     if (GLFW_PRESS == glfwGetKey(window, GLFW_KEY_ESCAPE)) {
         glfwSetWindowShouldClose(window, 1);
     }
 }
 
-void setupContext() {
+bool setupContext(bool visible) {
     // start GL context
     if (!glfwInit()) {
         fprintf(stderr, "ERROR: could not start GLFW3\n");
+        return false;
     }
     
+    glfwWindowHint(GLFW_VISIBLE, visible ? GL_TRUE : GL_FALSE);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
@@ -584,6 +772,7 @@ void setupContext() {
     if (!window) {
         fprintf(stderr, "ERROR: could not open window with GLFW3\n");
         glfwTerminate();
+        return false;
     }
 
     //glfwSetWindowPos(window, 0, 0);
@@ -594,13 +783,19 @@ void setupContext() {
     glfwSetFramebufferSizeCallback(window, glfwFrameBufferSizeCallback);
 
     // start gl3w extension handler
-    gl3wInit();
+    if (gl3wInit() != 0) {
+        fprintf(stderr, "ERROR: could not load the OpenGL functions\n");
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return false;
+    }
 
     // get version info
     const GLubyte *renderer = glGetString(GL_RENDERER); // get renderer string
     const GLubyte *version = glGetString(GL_VERSION);   // get version string
     std::cout << "Renderer: " << renderer << std::endl;
     std::cout << "OpenGL version: " << version << std::endl;
+    return true;
 }
 
 void destroyContext() {
@@ -1,14 +1,51 @@
 #include "Mesh.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
 #include <vector>
 
 #include <tiny_obj_loader.h>
 
 #define BUFFER_OFFSET(i) ((char *)NULL + (i))
 
+namespace {
+    std::atomic<float> weldDistance(0.f);
+    
+    const GLuint endOfChain = ~0u;
+    
+    // Cell of a point in a grid of twice the weld distance, and per axis the neighbouring cell (-1 or 1) on the side
+    // of the half the point is in, or the exact bits of the point without a distance
+    void cellOf(const glm::vec3 &vertex, float distance, int32_t cell[3], int32_t side[3]) {
+        for (int i = 0; i < 3; ++i) {
+            if (distance > 0) {
+                float grid = vertex[i] / (2.f * distance);
+                float lower = std::floor(grid);
+                cell[i] = (int32_t)lower;
+                side[i] = grid - lower < 0.5f ? -1 : 1;
+            } else {
+                // -0 and 0 are equal
+                float value = vertex[i] + 0.f;
+                memcpy(&cell[i], &value, sizeof(value));
+                side[i] = 0;
+            }
+        }
+    }
+    
+    uint64_t hashCell(const int32_t cell[3]) {
+        uint64_t hash = (uint64_t)(uint32_t)cell[0] * 73856093ull;
+        hash ^= (uint64_t)(uint32_t)cell[1] * 19349663ull;
+        hash ^= (uint64_t)(uint32_t)cell[2] * 83492791ull;
+        return hash ^ (hash >> 29);
+    }
+}
+
+// the buffers are only created by the first render, so meshes load without a GL context (e.g. headless runs)
 Mesh::Mesh(const std::string &filename) {
-    glGenVertexArrays(1, &m_vao);       // Generate a VAO
-    glGenBuffers(1, &m_vbo);            // Generate a VBO
+    m_vao = m_vbo = 0;
     m_vertices = m_distinctVertices = m_normals = m_uvs = m_colors = NULL;
     m_numVertices = m_numDistinctVertices = m_numNormals = m_numUVs = m_numColors = 0;
 
@@ -16,9 +53,8 @@ Mesh::Mesh(const std::string &filename) {
 }
 
 Mesh::Mesh(GLfloat *vertices, int numVertices) {
+    m_vao = m_vbo = 0;
     if (vertices != nullptr) {
-        glGenVertexArrays(1, &m_vao);       // Generate a VAO
-        glGenBuffers(1, &m_vbo);            // Generate a VBO
         m_vertices = m_distinctVertices = m_normals = m_uvs = m_colors = NULL;
         m_numVertices = m_numDistinctVertices = m_numNormals = m_numUVs = m_numColors = 0;
         
@@ -27,24 +63,77 @@ Mesh::Mesh(GLfloat *vertices, int numVertices) {
 }
 
 void Mesh::destroy() {
+    if (m_vao == 0) {
+        return;
+    }
     glDisableVertexAttribArray(m_vPosition);
     glDisableVertexAttribArray(m_vNormal);
     glDisableVertexAttribArray(m_vTexCoord);
     glDisableVertexAttribArray(m_vColor);
     glDeleteBuffers(1, &m_vbo);
     glDeleteVertexArrays(1, &m_vao);
+    m_vao = m_vbo = 0;
 }
 
 void Mesh::setGeometry(GLfloat *vertices, int numVertices) {
     this->m_vertices = vertices;
     this->m_numVertices = numVertices;
     
+    weldVertices();
+}
+
+void Mesh::weldVertices() {
+    float distance = weldDistance;
+    GLuint numberOfVertices = m_numVertices / 3;
+    
+    // distinct vertices in the order they first appear, chained per hashed cell
     std::vector<glm::vec3> distinctVertices = std::vector<glm::vec3>();
-    for (int i = 0; i < numVertices; i += 3) {
-        glm::vec3 vertex = glm::vec3(vertices[i], vertices[i+1], vertices[i+2]);
-        if (std::find(distinctVertices.begin(), distinctVertices.end(), vertex) == distinctVertices.end()) {
+    std::vector<GLuint> nextInCell = std::vector<GLuint>();
+    std::unordered_map<uint64_t, GLuint> firstInCell = std::unordered_map<uint64_t, GLuint>();
+    firstInCell.reserve(numberOfVertices);
+    
+    m_indices = std::vector<GLuint>(numberOfVertices);
+    
+    for (GLuint i = 0; i < numberOfVertices; ++i) {
+        glm::vec3 vertex = glm::vec3(m_vertices[3*i], m_vertices[3*i+1], m_vertices[3*i+2]);
+        int32_t cell[3];
+        int32_t side[3];
+        cellOf(vertex, distance, cell, side);
+        
+        // the earliest distinct vertex within the distance, in the 2x2x2 cells the ball around the vertex can touch
+        GLuint welded = endOfChain;
+        int numberOfCells = distance > 0 ? 8 : 1;
+        for (int c = 0; c < numberOfCells; ++c) {
+            int32_t neighbourCell[3] = {cell[0] + (c & 1) * side[0], cell[1] + ((c >> 1) & 1) * side[1], cell[2] + (c >> 2) * side[2]};
+            std::unordered_map<uint64_t, GLuint>::const_iterator first = firstInCell.find(hashCell(neighbourCell));
+            if (first == firstInCell.end()) {
+                continue;
+            }
+            for (GLuint j = first->second; j != endOfChain; j = nextInCell[j]) {
+                glm::vec3 offset = distinctVertices[j] - vertex;
+                if (j < welded && glm::dot(offset, offset) <= distance * distance) {
+                    welded = j;
+                }
+            }
+        }
+        
+        if (welded == endOfChain) {
+            welded = (GLuint)distinctVertices.size();
             distinctVertices.push_back(vertex);
+            
+            // the newest vertex of a cell heads its chain
+            uint64_t key = hashCell(cell);
+            std::unordered_map<uint64_t, GLuint>::iterator first = firstInCell.find(key);
+            if (first == firstInCell.end()) {
+                nextInCell.push_back(endOfChain);
+                firstInCell[key] = welded;
+            } else {
+                nextInCell.push_back(first->second);
+                first->second = welded;
+            }
         }
+        
+        m_indices[i] = welded;
     }
     
     m_numDistinctVertices = (GLuint)distinctVertices.size() * 3;
@@ -55,6 +144,50 @@ void Mesh::setGeometry(GLfloat *vertices, int numVertices) {
         m_distinctVertices[i+1] = distinctVertices[i/3].y;
         m_distinctVertices[i+2] = distinctVertices[i/3].z;
     }
+    
+    // edges of the triangles in both directions, counted first to place them
+    GLuint numberOfDistinctVertices = (GLuint)distinctVertices.size();
+    m_neighbourOffsets = std::vector<GLuint>(numberOfDistinctVertices + 1, 0);
+    for (GLuint i = 0; i + 2 < numberOfVertices; i += 3) {
+        for (int j = 0; j < 3; ++j) {
+            GLuint from = m_indices[i + j];
+            GLuint to = m_indices[i + (j + 1) % 3];
+            if (from != to) {
+                m_neighbourOffsets[from + 1]++;
+                m_neighbourOffsets[to + 1]++;
+            }
+        }
+    }
+    for (GLuint i = 0; i < numberOfDistinctVertices; ++i) {
+        m_neighbourOffsets[i + 1] += m_neighbourOffsets[i];
+    }
+    
+    m_neighbours = std::vector<GLuint>(m_neighbourOffsets[numberOfDistinctVertices]);
+    std::vector<GLuint> filled = std::vector<GLuint>(m_neighbourOffsets.begin(), m_neighbourOffsets.end() - 1);
+    for (GLuint i = 0; i + 2 < numberOfVertices; i += 3) {
+        for (int j = 0; j < 3; ++j) {
+            GLuint from = m_indices[i + j];
+            GLuint to = m_indices[i + (j + 1) % 3];
+            if (from != to) {
+                m_neighbours[filled[from]++] = to;
+                m_neighbours[filled[to]++] = from;
+            }
+        }
+    }
+    
+    // every inner edge is in two triangles, keep each neighbour once
+    GLuint end = 0;
+    for (GLuint i = 0; i < numberOfDistinctVertices; ++i) {
+        std::vector<GLuint>::iterator first = m_neighbours.begin() + m_neighbourOffsets[i];
+        std::vector<GLuint>::iterator last = m_neighbours.begin() + m_neighbourOffsets[i + 1];
+        std::sort(first, last);
+        last = std::unique(first, last);
+        
+        m_neighbourOffsets[i] = end;
+        end = (GLuint)(std::copy(first, last, m_neighbours.begin() + end) - m_neighbours.begin());
+    }
+    m_neighbourOffsets[numberOfDistinctVertices] = end;
+    m_neighbours.resize(end);
 }
 
 void Mesh::setNormals(GLfloat *normals, int numNormals) {
@@ -92,7 +225,32 @@ GLfloat *Mesh::getNormals(){
     return m_normals;
 }
 
+const std::vector<GLuint> &Mesh::getIndices() const {
+    return m_indices;
+}
+
+GLuint Mesh::getNumNeighbours(GLuint distinctVertex) const {
+    return m_neighbourOffsets[distinctVertex + 1] - m_neighbourOffsets[distinctVertex];
+}
+
+const GLuint *Mesh::getNeighbours(GLuint distinctVertex) const {
+    return m_neighbours.data() + m_neighbourOffsets[distinctVertex];
+}
+
+void Mesh::setWeldDistance(float distance) {
+    weldDistance = std::max(distance, 0.f);
+}
+
+float Mesh::getWeldDistance() {
+    return weldDistance;
+}
+
 void Mesh::loadVBO() {
+    if (m_vao == 0) {
+        glGenVertexArrays(1, &m_vao);       // Generate a VAO
+        glGenBuffers(1, &m_vbo);            // Generate a VBO
+    }
+    
     // Bind the vao
     glBindVertexArray(m_vao);
 
@@ -134,6 +292,9 @@ void Mesh::loadVBO() {
 }
 
 void Mesh::render() {
+    if (m_vao == 0) {
+        loadVBO();
+    }
     glBindVertexArray(m_vao);
 
     if (m_vertices) {
@@ -222,6 +383,4 @@ void Mesh::loadFromFile(const std::string &filename) {
     if (uvCount > 0) {
         setTextureCoordinates(uvArray, 2*3*faceCount);
     }
-
-    loadVBO();
 }
\ No newline at end of file
@@ -1,14 +1,230 @@
 #include "OOBB.h"
 
+#include "ThreadPool.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #undef min
 #undef max
 
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <mutex>
 #include <queue>
 
 unsigned int maxNumberOfTriangles = 4;
 int maxDepth = 30;
 float minRadii = 0.000001;
 
+namespace {
+    // SAH hierarchy
+    const int numberOfBins = 12;                        // candidate planes per axis are the borders between bins of the centroids
+    const float traversalCost = 8.f;                    // a box test (12 triangle-box tests) against a triangle test of the batch
+    const unsigned int maxNumberOfLeafTriangles = 8;    // larger leaves are split even if the heuristic disagrees (one AVX batch)
+    const float boundsMargin = 0.00001f;                // flat nodes still have a volume
+    
+    // parallel octree
+    const size_t parallelTriangles = 2048;              // smaller nodes are built by a single task
+    const size_t trianglesPerTask = 512;                // sorting the triangles of a node into its octants
+    
+    struct Bounds {
+        glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+        glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+        
+        void grow(const glm::vec3 &point) {
+            min = glm::min(min, point);
+            max = glm::max(max, point);
+        }
+        
+        void grow(const Bounds &bounds) {
+            min = glm::min(min, bounds.min);
+            max = glm::max(max, bounds.max);
+        }
+        
+        void grow(const Triangle &triangle) {
+            grow(triangle.vertex1);
+            grow(triangle.vertex2);
+            grow(triangle.vertex3);
+        }
+        
+        float area() const {
+            if (min.x > max.x) {
+                return 0;
+            }
+            glm::vec3 extent = max - min;
+            return 2.f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+        }
+    };
+    
+    glm::vec3 centroidOf(const Triangle &triangle) {
+        return (triangle.vertex1 + triangle.vertex2 + triangle.vertex3) / 3.f;
+    }
+    
+    // Distance along a ray at which it enters a box (0 if it starts inside), false if it misses the box or enters it
+    // at or behind maxT. Slab test with the precomputed inverse of the direction.
+    bool rayEntersBox(const glm::vec3 &origin, const glm::vec3 &inverseDirection, const glm::vec3 &lower, const glm::vec3 &upper, float maxT, float &entry) {
+        glm::vec3 t1 = (lower - origin) * inverseDirection;
+        glm::vec3 t2 = (upper - origin) * inverseDirection;
+        glm::vec3 slabEntry = glm::min(t1, t2);
+        glm::vec3 slabExit = glm::max(t1, t2);
+        entry = std::max(std::max(slabEntry.x, slabEntry.y), std::max(slabEntry.z, 0.f));
+        float exit = std::min(std::min(slabExit.x, slabExit.y), slabExit.z);
+        return entry <= exit && entry < maxT;
+    }
+    
+    // hierarchy cache, the version changes with the builders or the file format
+    const uint32_t cacheVersion = 4;
+    const char cacheMagic[4] = {'O', 'O', 'B', 'B'};
+    const uint32_t maxCachedChildren = 8;
+    
+    std::string cacheDirectory = "cache";
+    std::mutex cacheDirectoryMutex;
+    
+    struct CacheHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t key;
+        uint64_t payloadSize;
+        uint64_t payloadHash;
+    };
+    
+    struct CachedNode {
+        float origin[3];
+        float radii[3];
+        uint32_t numberOfChildren;
+        uint32_t numberOfTriangles;     // followed by the triangles and their indices in the mesh
+    };
+    
+    // the triangles of a leaf are copied as a whole
+    static_assert(sizeof(Triangle) == 12 * sizeof(float), "Triangle has to be four packed vec3");
+    
+    const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+    const uint64_t FNV_PRIME = 1099511628211ull;
+    
+    // FNV-1a over 32 bit words instead of bytes, the data are floats anyway
+    void hashWords(uint64_t &hash, const void *data, size_t size) {
+        const char *bytes = (const char *)data;
+        for (size_t i = 0; i + 4 <= size; i += 4) {
+            uint32_t word;
+            memcpy(&word, bytes + i, sizeof(word));
+            hash ^= word;
+            hash *= FNV_PRIME;
+        }
+    }
+    
+    void hashWord(uint64_t &hash, uint32_t word) {
+        hashWords(hash, &word, sizeof(word));
+    }
+    
+    void hashFloat(uint64_t &hash, float value) {
+        hashWords(hash, &value, sizeof(value));
+    }
+    
+    // Read-only mapping of a whole file, data is nullptr if it could not be mapped
+    struct MappedFile {
+        const char *data = nullptr;
+        size_t size = 0;
+#ifdef _WIN32
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = nullptr;
+        
+        MappedFile(const std::string &filename) {
+            file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            LARGE_INTEGER fileSize;
+            if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+                return;
+            }
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping != nullptr) {
+                data = (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                size = data != nullptr ? (size_t)fileSize.QuadPart : 0;
+            }
+        }
+        
+        ~MappedFile() {
+            if (data != nullptr) {
+                UnmapViewOfFile(data);
+            }
+            if (mapping != nullptr) {
+                CloseHandle(mapping);
+            }
+            if (file != INVALID_HANDLE_VALUE) {
+                CloseHandle(file);
+            }
+        }
+#else
+        MappedFile(const std::string &filename) {
+            int file = open(filename.c_str(), O_RDONLY);
+            if (file < 0) {
+                return;
+            }
+            struct stat status;
+            if (fstat(file, &status) == 0 && status.st_size > 0) {
+                void *mapped = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+                if (mapped != MAP_FAILED) {
+                    data = (const char *)mapped;
+                    size = (size_t)status.st_size;
+                }
+            }
+            // the mapping stays valid without the descriptor
+            close(file);
+        }
+        
+        ~MappedFile() {
+            if (data != nullptr) {
+                munmap((void *)data, size);
+            }
+        }
+#endif
+        
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+    };
+    
+    void makeDirectory(const std::string &directory) {
+        // fails harmlessly if it exists
+#ifdef _WIN32
+        _mkdir(directory.c_str());
+#else
+        mkdir(directory.c_str(), 0755);
+#endif
+    }
+    
+    // Everything the hierarchy depends on: the geometry, the split method and the parameters of both builders
+    uint64_t hierarchyKey(Mesh *mesh, OOBB::SplitMethod splitMethod) {
+        uint64_t hash = FNV_OFFSET_BASIS;
+        
+        hashWord(hash, cacheVersion);
+        hashWord(hash, (uint32_t)splitMethod);
+        hashWord(hash, maxNumberOfTriangles);
+        hashWord(hash, (uint32_t)maxDepth);
+        hashFloat(hash, minRadii);
+        hashWord(hash, (uint32_t)numberOfBins);
+        hashFloat(hash, traversalCost);
+        hashWord(hash, maxNumberOfLeafTriangles);
+        hashFloat(hash, boundsMargin);
+        
+        GLuint numberOfValues = mesh->getNumVertices();
+        hashWord(hash, numberOfValues);
+        hashWords(hash, mesh->getVertices(), numberOfValues * sizeof(GLfloat));
+        hashWords(hash, mesh->getNormals(), numberOfValues * sizeof(GLfloat));
+        
+        return hash;
+    }
+}
+
 OOBB::OOBB() {
     setDefaults();
 }
@@ -24,9 +240,40 @@ OOBB::OOBB(std::vector<Triangle> includedTriangles, glm::vec3 origin, glm::vec3
     setBoundingVertices();
 }
 
-OOBB::OOBB(Mesh *mesh) {
+OOBB::OOBB(Mesh *mesh, SplitMethod splitMethod) {
     setDefaults();
     
+    std::string directory = getCacheDirectory();
+    if (directory.empty()) {
+        build(mesh, splitMethod, getBuildPool());
+        return;
+    }
+    
+    uint64_t key = hierarchyKey(mesh, splitMethod);
+    char name[64];
+    snprintf(name, sizeof(name), "/%s-%016" PRIx64 ".oobb", getSplitMethodName(splitMethod), key);
+    std::string filename = directory + name;
+    
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (readCache(filename, key)) {
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        printf("Info: Loaded the %s of %lu triangles from %s in %.2f ms.\n", getSplitMethodName(splitMethod), m_includedTriangles.size(), filename.c_str(), milliseconds);
+        return;
+    }
+    
+    // a failed read leaves the defaults
+    if (build(mesh, splitMethod, getBuildPool())) {
+        makeDirectory(directory);
+        writeCache(filename, key);
+    }
+}
+
+OOBB::OOBB(Mesh *mesh, SplitMethod splitMethod, ThreadPool *pool) {
+    setDefaults();
+    build(mesh, splitMethod, pool);
+}
+
+bool OOBB::build(Mesh *mesh, SplitMethod splitMethod, ThreadPool *pool) {
     std::vector<Triangle> includedTriangles = std::vector<Triangle>();
     
     bool equalVerticesInSameTriangle = false;
@@ -54,15 +301,79 @@ OOBB::OOBB(Mesh *mesh) {
     }
     
     m_includedTriangles = includedTriangles;
-    calculateBoundingBox();
+    m_triangleIndices = std::vector<unsigned int>(m_includedTriangles.size());
+    for (size_t i = 0; i < m_triangleIndices.size(); ++i) {
+        m_triangleIndices[i] = (unsigned int)i;
+    }
     
-    if (!equalVerticesInSameTriangle) {
-        split(0);
+    if (splitMethod == SAH) {
+        Bounds bounds = Bounds();
+        for (size_t i = 0; i < m_includedTriangles.size(); ++i) {
+            bounds.grow(m_includedTriangles[i]);
+        }
+        m_origin = bounds.min - glm::vec3(boundsMargin);
+        m_radii = bounds.max - bounds.min + glm::vec3(2.f * boundsMargin);
+        setBoundingVertices();
+        
+        // only compares centroids, so degenerate triangles do not matter
+        splitSAH(0);
         setDepths(0);
         print(false);
     } else {
-        printf("ERROR: Could not create Octree, because there are equal vertices in the same triangles.\n");
+        calculateBoundingBox();
+        
+        if (!equalVerticesInSameTriangle) {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            
+            splitOctree(m_includedTriangles, m_triangleIndices, 0, pool);
+            setDepths(0);
+            
+            double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            printf("Info: Built the octree of %lu triangles in %.2f ms on %u threads.\n", m_includedTriangles.size(), milliseconds, pool != nullptr ? pool->getNumberOfThreads() : 1);
+            print(false);
+        } else {
+            printf("ERROR: Could not create Octree, because there are equal vertices in the same triangles.\n");
+            buildTriangleBatches();
+            return false;
+        }
     }
+    
+    buildTriangleBatches();
+    return true;
+}
+
+ThreadPool *OOBB::getBuildPool() {
+    static std::once_flag created;
+    static ThreadPool *pool = nullptr;
+    std::call_once(created, []() {
+        pool = new ThreadPool();
+    });
+    return pool;
+}
+
+void OOBB::setCacheDirectory(const std::string &directory) {
+    std::lock_guard<std::mutex> lock(cacheDirectoryMutex);
+    cacheDirectory = directory;
+}
+
+std::string OOBB::getCacheDirectory() {
+    std::lock_guard<std::mutex> lock(cacheDirectoryMutex);
+    return cacheDirectory;
+}
+
+const char *OOBB::getSplitMethodName(SplitMethod splitMethod) {
+    return splitMethod == SAH ? "sah" : "octree";
+}
+
+bool OOBB::parseSplitMethod(const std::string &name, SplitMethod &splitMethod) {
+    if (name == "octree") {
+        splitMethod = OCTREE;
+    } else if (name == "sah") {
+        splitMethod = SAH;
+    } else {
+        return false;
+    }
+    return true;
 }
 
 glm::vec3 OOBB::getOrigin() {
@@ -86,10 +397,67 @@ int OOBB::getDepth() {
     return m_depth;
 }
 
-std::vector<Triangle> OOBB::getIncludedTriangles() {
+const std::vector<Triangle> &OOBB::getIncludedTriangles() const {
     return m_includedTriangles;
 }
 
+const TriangleBatch &OOBB::getTriangleBatch() const {
+    return m_triangleBatch;
+}
+
+const std::vector<unsigned int> &OOBB::getTriangleIndices() const {
+    return m_triangleIndices;
+}
+
+bool OOBB::intersectRay(const glm::vec3 &origin, const glm::vec3 &direction, float &t, int &triangle, glm::vec3 &normal) const {
+    glm::vec3 inverseDirection = 1.f / direction;
+    float entry;
+    if (!rayEntersBox(origin, inverseDirection, m_origin, m_origin + m_radii, t, entry)) {
+        return false;
+    }
+    return intersectRay(origin, direction, inverseDirection, t, triangle, normal);
+}
+
+bool OOBB::intersectRay(const glm::vec3 &origin, const glm::vec3 &direction, const glm::vec3 &inverseDirection, float &t, int &triangle, glm::vec3 &normal) const {
+    if (m_children.empty()) {
+        size_t index;
+        if (!m_triangleBatch.intersectRay(origin, direction, t, index)) {
+            return false;
+        }
+        
+        // the face normal, on the side of the normal of the mesh
+        const Triangle &hit = m_includedTriangles[index];
+        normal = glm::normalize(glm::cross(hit.vertex2 - hit.vertex1, hit.vertex3 - hit.vertex1));
+        if (glm::dot(normal, hit.normal) < 0) {
+            normal = -normal;
+        }
+        triangle = index < m_triangleIndices.size() ? (int)m_triangleIndices[index] : -1;
+        return true;
+    }
+    
+    // front to back, so farther children are skipped once a nearer hit is found
+    std::pair<float, const OOBB *> entered[8];
+    size_t numberOfEntered = 0;
+    for (size_t i = 0; i < m_children.size() && numberOfEntered < 8; ++i) {
+        const OOBB &child = m_children[i];
+        float entry;
+        if (rayEntersBox(origin, inverseDirection, child.m_origin, child.m_origin + child.m_radii, t, entry)) {
+            entered[numberOfEntered++] = std::make_pair(entry, &child);
+        }
+    }
+    std::sort(entered, entered + numberOfEntered, [](const std::pair<float, const OOBB *> &a, const std::pair<float, const OOBB *> &b) {
+        return a.first < b.first;
+    });
+    
+    bool found = false;
+    for (size_t i = 0; i < numberOfEntered && entered[i].first < t; ++i) {
+        if (entered[i].second->intersectRay(origin, direction, inverseDirection, t, triangle, normal)) {
+            found = true;
+        }
+    }
+    return found;
+}
+
 std::vector<OOBB> *OOBB::getChildren() {
     return &m_children;
 }
@@ -142,6 +510,8 @@ void OOBB::split(int depth) {
         triangles.push_back(child7Triangles);
         triangles.push_back(child8Triangles);
         
+        std::vector<std::vector<unsigned int> > indices = std::vector<std::vector<unsigned int> >(origins.size());
+        
         for (size_t i = 0; i < m_includedTriangles.size(); ++i) {
             glm::vec3 point1 = m_includedTriangles[i].vertex1;
             glm::vec3 point2 = m_includedTriangles[i].vertex2;
@@ -150,6 +520,9 @@ void OOBB::split(int depth) {
             for (size_t j = 0; j < origins.size(); ++j) {
                 if (IntersectionTest::intersectionTriangleBox(point1, point2, point3, origins[j], childRadii)) {
                     triangles[j].push_back(m_includedTriangles[i]);
+                    if (!m_triangleIndices.empty()) {
+                        indices[j].push_back(m_triangleIndices[i]);
+                    }
                 }
             }
         }
@@ -157,6 +530,7 @@ void OOBB::split(int depth) {
         for (size_t i = 0; i < triangles.size(); ++i) {
             if (triangles[i].size() > 0) {
                 OOBB child = OOBB(triangles[i], origins[i], childRadii);
+                child.m_triangleIndices = indices[i];
                 child.split(depth + 1);
                 if (child.getChildren()->size() == 1) {
                     m_children.push_back(child.getChildren()->at(0));
@@ -168,6 +542,221 @@ void OOBB::split(int depth) {
     }
 }
 
+void OOBB::splitOctree(const std::vector<Triangle> &triangles, const std::vector<unsigned int> &indices, int depth, ThreadPool *pool) {
+    // the same conditions as split, the triangles of the root are already there
+    if (!(m_children.size() == 0 &&
+          indices.size()/3 > maxNumberOfTriangles &&
+          depth < maxDepth &&
+          m_radii.x > 2.f * minRadii &&
+          m_radii.y > 2.f * minRadii &&
+          m_radii.z > 2.f * minRadii)) {
+        if (depth > 0) {
+            m_includedTriangles = std::vector<Triangle>(indices.size());
+            for (size_t i = 0; i < indices.size(); ++i) {
+                m_includedTriangles[i] = triangles[indices[i]];
+            }
+            m_triangleIndices = indices;
+        }
+        return;
+    }
+    
+    glm::vec3 childRadii = m_radii * 0.5f;
+    
+    // in the order of split
+    glm::vec3 origins[8] = {
+        m_origin,
+        m_origin + glm::vec3(childRadii.x, 0, 0),
+        m_origin + glm::vec3(0, childRadii.y, 0),
+        m_origin + glm::vec3(0, 0, childRadii.z),
+        m_origin + glm::vec3(childRadii.x, childRadii.y, 0),
+        m_origin + glm::vec3(childRadii.x, 0, childRadii.z),
+        m_origin + glm::vec3(0, childRadii.y, childRadii.z),
+        m_origin + glm::vec3(childRadii.x, childRadii.y, childRadii.z)
+    };
+    
+    bool parallel = pool != nullptr && indices.size() >= parallelTriangles;
+    
+    // every task sorts a range of the triangles, the ranges are joined in order, so the leaves keep the order of split
+    size_t numberOfTasks = parallel ? (indices.size() + trianglesPerTask - 1) / trianglesPerTask : 1;
+    std::vector<std::vector<unsigned int> > taskIndices = std::vector<std::vector<unsigned int> >(8 * numberOfTasks);
+    auto sortIntoOctants = [&](size_t task) {
+        size_t begin = parallel ? task * trianglesPerTask : 0;
+        size_t end = parallel ? std::min(indices.size(), begin + trianglesPerTask) : indices.size();
+        for (size_t i = begin; i < end; ++i) {
+            const Triangle &triangle = triangles[indices[i]];
+            for (int j = 0; j < 8; ++j) {
+                if (IntersectionTest::intersectionTriangleBox(triangle.vertex1, triangle.vertex2, triangle.vertex3, origins[j], childRadii)) {
+                    taskIndices[8 * task + j].push_back(indices[i]);
+                }
+            }
+        }
+    };
+    if (parallel) {
+        pool->parallelFor(numberOfTasks, sortIntoOctants);
+    } else {
+        sortIntoOctants(0);
+    }
+    
+    std::vector<unsigned int> childIndices[8];
+    std::vector<int> octants = std::vector<int>();
+    for (int j = 0; j < 8; ++j) {
+        for (size_t task = 0; task < numberOfTasks; ++task) {
+            childIndices[j].insert(childIndices[j].end(), taskIndices[8 * task + j].begin(), taskIndices[8 * task + j].end());
+        }
+        if (childIndices[j].size() > 0) {
+            octants.push_back(j);
+        }
+    }
+    
+    // the children do not move anymore once they are built
+    m_children = std::vector<OOBB>(octants.size());
+    for (size_t i = 0; i < octants.size(); ++i) {
+        m_children[i].m_origin = origins[octants[i]];
+        m_children[i].m_radii = childRadii;
+        m_children[i].setBoundingVertices();
+    }
+    
+    auto buildChild = [&](size_t i) {
+        m_children[i].splitOctree(triangles, childIndices[octants[i]], depth + 1, pool);
+    };
+    if (parallel) {
+        pool->parallelFor(m_children.size(), buildChild);
+    } else {
+        for (size_t i = 0; i < m_children.size(); ++i) {
+            buildChild(i);
+        }
+    }
+    
+    // a child with a single child is replaced by it, as in split
+    for (size_t i = 0; i < m_children.size(); ++i) {
+        if (m_children[i].m_children.size() == 1) {
+            OOBB grandchild = std::move(m_children[i].m_children[0]);
+            m_children[i] = std::move(grandchild);
+        }
+    }
+}
+
+void OOBB::splitSAH(int depth) {
+    size_t numberOfTriangles = m_includedTriangles.size();
+    if (m_children.size() > 0 || numberOfTriangles < 2 || depth >= maxDepth) {
+        return;
+    }
+    
+    Bounds centroidBounds = Bounds();
+    for (size_t i = 0; i < numberOfTriangles; ++i) {
+        centroidBounds.grow(centroidOf(m_includedTriangles[i]));
+    }
+    
+    // bin index of every triangle along every axis
+    std::vector<int> bins = std::vector<int>(3 * numberOfTriangles);
+    
+    float bestCost = std::numeric_limits<float>::max();
+    int bestAxis = -1;
+    int bestSplit = 0;
+    
+    for (int axis = 0; axis < 3; ++axis) {
+        float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+        if (extent <= 0) {
+            // all centroids in one plane, they cannot be separated along this axis
+            continue;
+        }
+        
+        std::vector<Bounds> binBounds = std::vector<Bounds>(numberOfBins);
+        std::vector<size_t> binCounts = std::vector<size_t>(numberOfBins, 0);
+        
+        for (size_t i = 0; i < numberOfTriangles; ++i) {
+            int bin = int(numberOfBins * (centroidOf(m_includedTriangles[i])[axis] - centroidBounds.min[axis]) / extent);
+            bin = std::min(std::max(bin, 0), numberOfBins - 1);
+            bins[3 * i + axis] = bin;
+            binBounds[bin].grow(m_includedTriangles[i]);
+            binCounts[bin]++;
+        }
+        
+        // areas and counts right of each plane, then sweep from the left
+        std::vector<float> rightAreas = std::vector<float>(numberOfBins, 0);
+        std::vector<size_t> rightCounts = std::vector<size_t>(numberOfBins, 0);
+        Bounds right = Bounds();
+        size_t rightCount = 0;
+        for (int bin = numberOfBins - 1; bin > 0; --bin) {
+            right.grow(binBounds[bin]);
+            rightCount += binCounts[bin];
+            rightAreas[bin] = right.area();
+            rightCounts[bin] = rightCount;
+        }
+        
+        Bounds left = Bounds();
+        size_t leftCount = 0;
+        for (int bin = 1; bin < numberOfBins; ++bin) {
+            left.grow(binBounds[bin - 1]);
+            leftCount += binCounts[bin - 1];
+            if (leftCount == 0 || rightCounts[bin] == 0) {
+                continue;
+            }
+            
+            float cost = left.area() * leftCount + rightAreas[bin] * rightCounts[bin];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = bin;
+            }
+        }
+    }
+    
+    if (bestAxis < 0) {
+        return;
+    }
+    
+    // expected triangle tests of a leaf against testing both children after this box
+    float area = 2.f * (m_radii.x * m_radii.y + m_radii.y * m_radii.z + m_radii.z * m_radii.x);
+    float splitCost = traversalCost + (area > 0 ? bestCost / area : 0);
+    if (splitCost >= numberOfTriangles && numberOfTriangles <= maxNumberOfLeafTriangles) {
+        return;
+    }
+    
+    std::vector<Triangle> leftTriangles = std::vector<Triangle>();
+    std::vector<Triangle> rightTriangles = std::vector<Triangle>();
+    std::vector<unsigned int> leftIndices = std::vector<unsigned int>();
+    std::vector<unsigned int> rightIndices = std::vector<unsigned int>();
+    Bounds leftBounds = Bounds();
+    Bounds rightBounds = Bounds();
+    
+    for (size_t i = 0; i < numberOfTriangles; ++i) {
+        if (bins[3 * i + bestAxis] < bestSplit) {
+            leftTriangles.push_back(m_includedTriangles[i]);
+            leftBounds.grow(m_includedTriangles[i]);
+            if (!m_triangleIndices.empty()) {
+                leftIndices.push_back(m_triangleIndices[i]);
+            }
+        } else {
+            rightTriangles.push_back(m_includedTriangles[i]);
+            rightBounds.grow(m_includedTriangles[i]);
+            if (!m_triangleIndices.empty()) {
+                rightIndices.push_back(m_triangleIndices[i]);
+            }
+        }
+    }
+    
+    // the children do not move anymore once they are built
+    Bounds childBounds[2] = {leftBounds, rightBounds};
+    m_children = std::vector<OOBB>(2);
+    m_children[0].m_includedTriangles = std::move(leftTriangles);
+    m_children[0].m_triangleIndices = std::move(leftIndices);
+    m_children[1].m_includedTriangles = std::move(rightTriangles);
+    m_children[1].m_triangleIndices = std::move(rightIndices);
+    for (size_t i = 0; i < m_children.size(); ++i) {
+        m_children[i].m_origin = childBounds[i].min - glm::vec3(boundsMargin);
+        m_children[i].m_radii = childBounds[i].max - childBounds[i].min + glm::vec3(2.f * boundsMargin);
+        m_children[i].setBoundingVertices();
+        m_children[i].splitSAH(depth + 1);
+    }
+    
+    // only the leaves keep their triangles, and the root all of them (see getIncludedTriangles)
+    if (depth > 0) {
+        m_includedTriangles = std::vector<Triangle>();
+        m_triangleIndices = std::vector<unsigned int>();
+    }
+}
+
 void OOBB::realPrint(int depth) {
     for (int i = 0; i < depth; ++i) {
         printf("\t");
@@ -181,6 +770,141 @@ void OOBB::realPrint(int depth) {
     }
 }
 
+bool OOBB::readCache(const std::string &filename, uint64_t key) {
+    MappedFile file(filename);
+    if (file.data == nullptr) {
+        return false;
+    }
+    
+    CacheHeader header;
+    if (file.size < sizeof(header)) {
+        printf("Warning: Ignoring the invalid hierarchy cache %s.\n", filename.c_str());
+        return false;
+    }
+    memcpy(&header, file.data, sizeof(header));
+    
+    const char *data = file.data + sizeof(header);
+    const char *end = file.data + file.size;
+    
+    uint64_t payloadHash = FNV_OFFSET_BASIS;
+    bool valid = memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) == 0 &&
+                 header.version == cacheVersion &&
+                 header.key == key &&
+                 header.payloadSize == file.size - sizeof(header);
+    if (valid) {
+        // a file cut short or written by two processes at once
+        hashWords(payloadHash, data, header.payloadSize);
+        valid = payloadHash == header.payloadHash && readNodes(data, end, 0) && data == end;
+    }
+    
+    if (!valid) {
+        printf("Warning: Ignoring the invalid hierarchy cache %s.\n", filename.c_str());
+        setDefaults();
+        m_includedTriangles = std::vector<Triangle>();
+        m_triangleIndices = std::vector<unsigned int>();
+        return false;
+    }
+    
+    setDepths(0);
+    buildTriangleBatches();
+    return true;
+}
+
+void OOBB::writeCache(const std::string &filename, uint64_t key) {
+    std::vector<char> payload = std::vector<char>();
+    writeNodes(payload);
+    
+    CacheHeader header;
+    memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+    header.version = cacheVersion;
+    header.key = key;
+    header.payloadSize = payload.size();
+    header.payloadHash = FNV_OFFSET_BASIS;
+    hashWords(header.payloadHash, payload.data(), payload.size());
+    
+    // readers never see a partial file
+    std::string temporary = filename + ".tmp";
+    FILE *file = fopen(temporary.c_str(), "wb");
+    if (file == nullptr) {
+        printf("Warning: Could not write the hierarchy cache %s.\n", filename.c_str());
+        return;
+    }
+    
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   (payload.empty() || fwrite(payload.data(), payload.size(), 1, file) == 1);
+    written = fclose(file) == 0 && written;
+    
+    remove(filename.c_str());
+    if (!written || rename(temporary.c_str(), filename.c_str()) != 0) {
+        printf("Warning: Could not write the hierarchy cache %s.\n", filename.c_str());
+        remove(temporary.c_str());
+    }
+}
+
+void OOBB::writeNodes(std::vector<char> &data) {
+    CachedNode node;
+    for (int i = 0; i < 3; ++i) {
+        node.origin[i] = m_origin[i];
+        node.radii[i] = m_radii[i];
+    }
+    node.numberOfChildren = (uint32_t)m_children.size();
+    node.numberOfTriangles = (uint32_t)m_includedTriangles.size();
+    
+    const char *nodeBytes = (const char *)&node;
+    const char *triangleBytes = (const char *)m_includedTriangles.data();
+    data.insert(data.end(), nodeBytes, nodeBytes + sizeof(node));
+    data.insert(data.end(), triangleBytes, triangleBytes + m_includedTriangles.size() * sizeof(Triangle));
+    
+    // nodes built without indices store them as 0
+    std::vector<uint32_t> indices = std::vector<uint32_t>(m_includedTriangles.size(), 0);
+    for (size_t i = 0; i < m_triangleIndices.size() && i < indices.size(); ++i) {
+        indices[i] = m_triangleIndices[i];
+    }
+    const char *indexBytes = (const char *)indices.data();
+    data.insert(data.end(), indexBytes, indexBytes + indices.size() * sizeof(uint32_t));
+    
+    for (size_t i = 0; i < m_children.size(); ++i) {
+        m_children[i].writeNodes(data);
+    }
+}
+
+bool OOBB::readNodes(const char *&data, const char *end, int depth) {
+    CachedNode node;
+    if (depth > maxDepth || (size_t)(end - data) < sizeof(node)) {
+        return false;
+    }
+    memcpy(&node, data, sizeof(node));
+    data += sizeof(node);
+    
+    if (node.numberOfChildren > maxCachedChildren || (size_t)(end - data) / (sizeof(Triangle) + sizeof(uint32_t)) < node.numberOfTriangles) {
+        return false;
+    }
+    
+    m_origin = glm::vec3(node.origin[0], node.origin[1], node.origin[2]);
+    m_radii = glm::vec3(node.radii[0], node.radii[1], node.radii[2]);
+    setBoundingVertices();
+    
+    m_includedTriangles = std::vector<Triangle>(node.numberOfTriangles);
+    m_triangleIndices = std::vector<unsigned int>(node.numberOfTriangles);
+    if (node.numberOfTriangles > 0) {
+        memcpy(m_includedTriangles.data(), data, node.numberOfTriangles * sizeof(Triangle));
+        data += node.numberOfTriangles * sizeof(Triangle);
+        
+        std::vector<uint32_t> indices = std::vector<uint32_t>(node.numberOfTriangles);
+        memcpy(indices.data(), data, node.numberOfTriangles * sizeof(uint32_t));
+        data += node.numberOfTriangles * sizeof(uint32_t);
+        m_triangleIndices.assign(indices.begin(), indices.end());
+    }
+    
+    m_children = std::vector<OOBB>(node.numberOfChildren);
+    for (size_t i = 0; i < m_children.size(); ++i) {
+        if (!m_children[i].readNodes(data, end, depth + 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void OOBB::setDepths(int depth) {
     m_depth = depth;
     for (size_t i = 0; i < m_children.size(); ++i) {
@@ -188,6 +912,16 @@ void OOBB::setDepths(int depth) {
     }
 }
 
+void OOBB::buildTriangleBatches() {
+    // only leaves are tested triangle by triangle
+    if (m_children.size() == 0) {
+        m_triangleBatch = TriangleBatch(m_includedTriangles);
+    }
+    for (size_t i = 0; i < m_children.size(); ++i) {
+        m_children[i].buildTriangleBatches();
+    }
+}
+
 
 void OOBB::print(bool recursive) {
     if (recursive) {
@@ -196,22 +930,22 @@ void OOBB::print(bool recursive) {
         int totalTrianglesOnLowestLevel = 0;
         int totalNodeCount = 0;
         int totalDepth = 0;
-        std::queue<OOBB> toVisit = std::queue<OOBB>();
-        toVisit.push(*this);
+        std::queue<OOBB *> toVisit = std::queue<OOBB *>();
+        toVisit.push(this);
         
         while (!toVisit.empty()) {
             totalNodeCount++;
             
-            OOBB next = toVisit.front();
+            OOBB *next = toVisit.front();
             toVisit.pop();
             
-            for (size_t i = 0; i < next.getChildren()->size(); ++i) {
-                toVisit.push(next.getChildren()->at(i));
+            for (size_t i = 0; i < next->getChildren()->size(); ++i) {
+                toVisit.push(&next->getChildren()->at(i));
             }
             
-            if (next.getChildren()->size() == 0) {
-                totalTrianglesOnLowestLevel += next.getIncludedTriangles().size()/3;
-                totalDepth = std::max(totalDepth, next.getDepth());
+            if (next->getChildren()->size() == 0) {
+                totalTrianglesOnLowestLevel += next->getIncludedTriangles().size()/3;
+                totalDepth = std::max(totalDepth, next->getDepth());
             }
         }
         
@@ -0,0 +1,105 @@
+#include "Parameters.h"
+
+namespace {
+    struct NamedParameter {
+        const char *name;
+        float Parameters::*member;
+    };
+
+    struct NamedIntParameter {
+        const char *name;
+        int Parameters::*member;
+    };
+
+    const NamedIntParameter namedIntParameters[] = {
+        {"frictionMethod", &Parameters::frictionMethod},
+        {"ground", &Parameters::ground},
+        {"groundShape", &Parameters::groundShape},
+        {"primitiveColliders", &Parameters::primitiveColliders},
+        {"convexContacts", &Parameters::convexContacts},
+        {"contactManifold", &Parameters::contactManifold},
+        {"distanceFieldContacts", &Parameters::distanceFieldContacts},
+        {"continuousCollisions", &Parameters::continuousCollisions},
+        {"contactSolver", &Parameters::contactSolver},
+        {"solverIterations", &Parameters::solverIterations},
+        {"warmStarting", &Parameters::warmStarting},
+        {"solverColouring", &Parameters::solverColouring},
+    };
+
+    const NamedParameter namedParameters[] = {
+        {"restitution", &Parameters::restitution},
+        {"separatingVelocity", &Parameters::separatingVelocity},
+        {"frictionCoefficient", &Parameters::frictionCoefficient},
+        {"frictionScale", &Parameters::frictionScale},
+        {"coulombFrictionTorque", &Parameters::coulombFrictionTorque},
+        {"breakawayFrictionTorque", &Parameters::breakawayFrictionTorque},
+        {"torqueVelocityThreshold", &Parameters::torqueVelocityThreshold},
+        {"viscousFrictionTorque", &Parameters::viscousFrictionTorque},
+        {"torqueCoefficient", &Parameters::torqueCoefficient},
+        {"coulombFrictionForce", &Parameters::coulombFrictionForce},
+        {"breakawayFrictionForce", &Parameters::breakawayFrictionForce},
+        {"forceVelocityThreshold", &Parameters::forceVelocityThreshold},
+        {"viscousFrictionForce", &Parameters::viscousFrictionForce},
+        {"groundViscousFrictionForce", &Parameters::groundViscousFrictionForce},
+        {"forceCoefficient", &Parameters::forceCoefficient},
+        {"groundRadius", &Parameters::groundRadius},
+        {"groundCurvature", &Parameters::groundCurvature},
+        {"groundSlope", &Parameters::groundSlope},
+        {"maxPenetration", &Parameters::maxPenetration},
+        {"coherenceMargin", &Parameters::coherenceMargin},
+        {"sleepVelocity", &Parameters::sleepVelocity},
+        {"sleepDamping", &Parameters::sleepDamping},
+    };
+
+    const size_t numberOfNamedIntParameters = sizeof(namedIntParameters) / sizeof(namedIntParameters[0]);
+    const size_t numberOfNamedParameters = sizeof(namedParameters) / sizeof(namedParameters[0]);
+}
+
+bool Parameters::set(const std::string &name, float value) {
+    for (size_t i = 0; i < numberOfNamedIntParameters; ++i) {
+        if (name == namedIntParameters[i].name) {
+            this->*namedIntParameters[i].member = (int)value;
+            return true;
+        }
+    }
+
+    for (size_t i = 0; i < numberOfNamedParameters; ++i) {
+        if (name == namedParameters[i].name) {
+            this->*namedParameters[i].member = value;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Parameters::get(const std::string &name, float &value) const {
+    for (size_t i = 0; i < numberOfNamedIntParameters; ++i) {
+        if (name == namedIntParameters[i].name) {
+            value = (float)(this->*namedIntParameters[i].member);
+            return true;
+        }
+    }
+
+    for (size_t i = 0; i < numberOfNamedParameters; ++i) {
+        if (name == namedParameters[i].name) {
+            value = this->*namedParameters[i].member;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+std::vector<std::string> Parameters::getNames() {
+    std::vector<std::string> names = std::vector<std::string>();
+    for (size_t i = 0; i < numberOfNamedIntParameters; ++i) {
+        names.push_back(namedIntParameters[i].name);
+    }
+
+    for (size_t i = 0; i < numberOfNamedParameters; ++i) {
+        names.push_back(namedParameters[i].name);
+    }
+
+    return names;
+}
@@ -0,0 +1,487 @@
+#include "Primitive.h"
+
+#include "IntersectionTest.h"
+#include "OOBB.h"
+#include "RigidBody.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/quaternion.hpp>
+
+using namespace glm;
+
+Primitive Primitive::sphere(float radius) {
+    Primitive primitive;
+    primitive.type = SPHERE;
+    primitive.radius = radius;
+    return primitive;
+}
+
+Primitive Primitive::box(const vec3 &halfExtents) {
+    Primitive primitive;
+    primitive.type = BOX;
+    primitive.halfExtents = halfExtents;
+    return primitive;
+}
+
+Primitive Primitive::capsule(float radius, float halfHeight) {
+    Primitive primitive;
+    primitive.type = CAPSULE;
+    primitive.radius = radius;
+    primitive.halfHeight = halfHeight;
+    return primitive;
+}
+
+namespace {
+    const float parallelTolerance = 1e-6f;
+    const float nearlyParallel = 0.01f;     // sine of the angle below which capsules lie along each other
+    const float insideTolerance = 1e-4f;    // relative to the half extents, vertices this close to a box count as inside
+    const float edgePreference = 0.95f;     // an edge axis has to overlap this much less than the best face axis
+    const int closestPointIterations = 8;
+
+    // A primitive in world space
+    struct Placed {
+        RigidBody *body;
+        Primitive::Type type;
+        vec3 center;
+        mat3 axes;                      // columns: the unit axes of the body
+        vec3 halfExtents;               // box
+        float radius;                   // sphere and capsule
+        vec3 halfAxis;                  // capsule: from the center to one end of the segment
+    };
+
+    Placed place(RigidBody &body) {
+        const Primitive &primitive = body.getPrimitive();
+        vec3 scale = body.getScale();
+
+        Placed placed;
+        placed.body = &body;
+        placed.type = primitive.type;
+        placed.center = vec3(body.model() * vec4(primitive.center, 1.f));
+        placed.axes = mat3_cast(body.getOrientation());
+        placed.halfExtents = primitive.halfExtents * scale;
+        // round shapes stay round, with the largest scale
+        placed.radius = primitive.radius * std::max(scale.x, std::max(scale.y, scale.z));
+        placed.halfAxis = placed.axes[1] * (primitive.halfHeight * scale.y);
+        return placed;
+    }
+
+    vec3 closestOnSegment(const vec3 &p, const vec3 &a, const vec3 &b) {
+        vec3 ab = b - a;
+        float lengthSquared = dot(ab, ab);
+        if (lengthSquared <= 0) {
+            return a;
+        }
+        return a + clamp(dot(p - a, ab) / lengthSquared, 0.f, 1.f) * ab;
+    }
+
+    // closest points of two segments (Ericson, Real-Time Collision Detection 5.1.9)
+    void closestSegmentSegment(const vec3 &p1, const vec3 &q1, const vec3 &p2, const vec3 &q2, vec3 &c1, vec3 &c2) {
+        vec3 d1 = q1 - p1;
+        vec3 d2 = q2 - p2;
+        vec3 r = p1 - p2;
+        float a = dot(d1, d1);
+        float e = dot(d2, d2);
+        float f = dot(d2, r);
+
+        float s = 0;
+        float t = 0;
+        if (a <= parallelTolerance && e <= parallelTolerance) {
+            c1 = p1;
+            c2 = p2;
+            return;
+        }
+        if (a <= parallelTolerance) {
+            t = clamp(f / e, 0.f, 1.f);
+        } else {
+            float c = dot(d1, r);
+            if (e <= parallelTolerance) {
+                s = clamp(-c / a, 0.f, 1.f);
+            } else {
+                float b = dot(d1, d2);
+                float denominator = a * e - b * b;
+                s = denominator != 0 ? clamp((b * f - c * e) / denominator, 0.f, 1.f) : 0.f;
+                t = (b * s + f) / e;
+                if (t < 0) {
+                    t = 0;
+                    s = clamp(-c / a, 0.f, 1.f);
+                } else if (t > 1) {
+                    t = 1;
+                    s = clamp((b - c) / a, 0.f, 1.f);
+                }
+            }
+        }
+        c1 = p1 + d1 * s;
+        c2 = p2 + d2 * t;
+    }
+
+    vec3 closestOnBox(const vec3 &p, const Placed &box) {
+        vec3 local = transpose(box.axes) * (p - box.center);
+        return box.center + box.axes * clamp(local, -box.halfExtents, box.halfExtents);
+    }
+
+    // two spheres, the contact halfway through the overlap
+    void spheres(const vec3 &centerA, float radiusA, const vec3 &centerB, float radiusB, std::vector<Contact> &contacts) {
+        vec3 d = centerB - centerA;
+        float distance = length(d);
+        if (distance >= radiusA + radiusB) {
+            return;
+        }
+
+        Contact contact;
+        contact.n = distance > 0 ? d / distance : vec3(0, 1, 0);
+        contact.p = centerA + contact.n * (radiusA - 0.5f * (radiusA + radiusB - distance));
+        contacts.push_back(contact);
+    }
+
+    // a sphere against a box, the contact on the surface of the box
+    void sphereAtBox(const vec3 &center, float radius, const Placed &box, std::vector<Contact> &contacts) {
+        vec3 local = transpose(box.axes) * (center - box.center);
+        vec3 closest = clamp(local, -box.halfExtents, box.halfExtents);
+
+        Contact contact;
+        if (closest != local) {
+            vec3 d = closest - local;
+            float distance = length(d);
+            if (distance >= radius) {
+                return;
+            }
+            contact.n = box.axes * (d / distance);
+        } else {
+            // the center is inside: out through the nearest face
+            int axis = 0;
+            float depth = box.halfExtents[0] - std::abs(local[0]);
+            for (int k = 1; k < 3; ++k) {
+                if (box.halfExtents[k] - std::abs(local[k]) < depth) {
+                    axis = k;
+                    depth = box.halfExtents[k] - std::abs(local[k]);
+                }
+            }
+            float side = local[axis] < 0 ? -1.f : 1.f;
+            closest[axis] = side * box.halfExtents[axis];
+            contact.n = -side * box.axes[axis];
+        }
+        contact.p = box.center + box.axes * closest;
+        contacts.push_back(contact);
+    }
+
+    typedef void (*PairTest)(const Placed &a, const Placed &b, std::vector<Contact> &contacts);
+
+    void sphereSphere(const Placed &a, const Placed &b, std::vector<Contact> &contacts) {
+        spheres(a.center, a.radius, b.center, b.radius, contacts);
+    }
+
+    void sphereBox(const Placed &a, const Placed &b, std::vector<Contact> &contacts) {
+        sphereAtBox(a.center, a.radius, b, contacts);
+    }
+
+    void sphereCapsule(const Placed &a, const Placed &b, std::vector<Contact> &contacts) {
+        spheres(a.center, a.radius, closestOnSegment(a.center, b.center - b.halfAxis, b.center + b.halfAxis), b.radius, contacts);
+    }
+
+    // Closest points of the sphere on the mesh triangles in the nodes of the hierarchy that the sphere reaches
+    void sphereNode(OOBB *node, const vec3 &center, float radius, const mat4 &model, const mat3 &normalMatrix, const vec3 &worldCenter, float worldRadius, std::vector<Contact> &contacts) {
+        vec3 lower = node->getOrigin();
+        vec3 upper = node->getOrigin() + node->getRadii();
+        if (length(max(max(lower - center, center - upper), vec3(0, 0, 0))) > radius) {
+            return;
+        }
+
+        std::vector<OOBB> *children = node->getChildren();
+        for (size_t i = 0; i < children->size(); ++i) {
+            sphereNode(&children->at(i), center, radius, model, normalMatrix, worldCenter, worldRadius, contacts);
+        }
+        if (children->size() > 0) {
+            return;
+        }
+
+        const std::vector<Triangle> &triangles = node->getIncludedTriangles();
+        for (size_t i = 0; i < triangles.size(); ++i) {
+            bool onFace;
+            vec3 closest = IntersectionTest::closestPointTriangle(center, triangles[i].vertex1, triangles[i].vertex2, triangles[i].vertex3, onFace);
+            vec3 point = vec3(model * vec4(closest, 1.f));
+            vec3 d = point - worldCenter;
+            float distance = length(d);
+            if (distance >= worldRadius) {
+                continue;
+            }
+
+            vec3 faceNormal = normalize(normalMatrix * cross(triangles[i].vertex2 - triangles[i].vertex1, triangles[i].vertex3 - triangles[i].vertex1));
+
+            // a center behind the face is pushed out along the face normal
+            Contact contact;
+            contact.p = point;
+            contact.n = distance > 0 && dot(d, faceNormal) < 0 ? d / distance : -faceNormal;
+            contacts.push_back(contact);
+        }
+    }
+
+    void sphereMesh(const Placed &a, const Placed &b, std::vector<Contact> &contacts) {
+        OOBB *root = b.body->getBoundingBox();
+        if (root == nullptr) {
+            return;
+        }
+
+        mat4 model = b.body->model();
+        vec3 scale = b.body->getScale();
+        vec3 center = vec3(inverse(model) * vec4(a.center, 1.f));
+
+        // the nodes are in model space, where the radius is largest along the least scaled axis
+        float radius = a.radius / std::min(scale.x, std::min(scale.y, scale.z));
+        sphereNode(root, center, radius, model, transpose(inverse(mat3(model))), a.center, a.radius, contacts);
+    }
+
+    void capsuleCapsule(const Placed &a, const Placed &b, std::vector<Contact> &contacts) {
+        vec3 a1 = a.center - a.halfAxis;
+        vec3 a2 = a.center + a.halfAxis;
+        vec3 b1 = b.center - b.halfAxis;
+        vec3 b2 = b.center + b.halfAxis;
+
+        vec3 closestA;
+        vec3 closestB;
+        closestSegmentSegment(a1, a2, b1, b2, closestA, closestB);
+
+        // parallel capsules touch along a line, its ends come from the ends of the segments
+        size_t first = contacts.size();
+        spheres(closestA, a.radius, closestB, b.radius, contacts);
+        if (contacts.size() > first && length(cross(a.halfAxis, b.halfAxis)) <= nearlyParallel * length(a.halfAxis) * length(b.halfAxis)) {
+            contacts.resize(first);
+            spheres(a1, a.radius, closestOnSegment(a1, b1, b2), b.radius, contacts);
+            spheres(a2, a.radius, closestOnSegment(a2, b1, b2), b.radius, contacts);
+
+            // ends of two which lie between the ends of one
+            float separate = nearlyParallel * length(a.halfAxis);
+            vec3 onA1 = closestOnSegment(b1, a1, a2);
+            if (length(onA1 - a1) > separate && length(onA1 - a2) > separate) {
+                spheres(onA1, a.radius, b1, b.radius, contacts);
+            }
+            vec3 onA2 = closestOnSegment(b2, a1, a2);
+            if (length(onA2 - a1) > separate && length(onA2 - a2) > separate) {
+                spheres(onA2, a.radius, b2, b.radius, contacts);
+            }
+        }
+    }
+
+    void boxCapsule(const Placed &a, const Placed &b, std::vector<Contact> &contacts) {
+        vec3 b1 = b.center - b.halfAxis;
+        vec3 b2 = b.center + b.halfAxis;
+
+        // alternating projections between two convex sets approach their closest points
+        vec3 onSegment = b.center;
+        for (int i = 0; i < closestPointIterations; ++i) {
+            onSegment = closestOnSegment(closestOnBox(onSegment, a), b1, b2);
+        }
+
+        std::vector<Contact> capsuleContacts = std::vector<Contact>();
+        sphereAtBox(onSegment, b.radius, a, capsuleContacts);
+        if (capsuleContacts.size() > 0) {
+            // a capsule lying on a face also touches with its ends
+            sphereAtBox(b1, b.radius, a, capsuleContacts);
+            sphereAtBox(b2, b.radius, a, capsuleContacts);
+        }
+
+        // the sphere tests give the normal from the capsule toward the box
+        for (size_t i = 0; i < capsuleContacts.size(); ++i) {
+            capsuleContacts[i].n = -capsuleContacts[i].n;
+            contacts.push_back(capsuleContacts[i]);
+        }
+    }
+
+    vec3 boxCorner(const Placed &box, int corner) {
+        vec3 signs = vec3((corner & 1) ? 1.f : -1.f, (corner & 2) ? 1.f : -1.f, (corner & 4) ? 1.f : -1.f);
+        return box.center + box.axes * (signs * box.halfExtents);
+    }
+
+    bool insideBox(const vec3 &p, const Placed &box) {
+        vec3 local = transpose(box.axes) * (p - box.center);
+        for (int k = 0; k < 3; ++k) {
+            if (std::abs(local[k]) > box.halfExtents[k] * (1.f + insideTolerance)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // corner of the box farthest in the direction
+    vec3 boxSupport(const Placed &box, const vec3 &direction) {
+        vec3 local = transpose(box.axes) * direction;
+        vec3 signs = vec3(local.x < 0 ? -1.f : 1.f, local.y < 0 ? -1.f : 1.f, local.z < 0 ? -1.f : 1.f);
+        return box.center + box.axes * (signs * box.halfExtents);
+    }
+
+    // separating axis test over the 3 + 3 face normals and the 9 edge directions
+    void boxBox(const Placed &a, const Placed &b, std::vector<Contact> &contacts) {
+        vec3 t = b.center - a.center;
+
+        float bestOverlap = 0;
+        vec3 bestAxis = vec3(0, 1, 0);
+        int bestEdgeA = -1;
+        int bestEdgeB = -1;
+        bool found = false;
+
+        for (int axis = 0; axis < 15; ++axis) {
+            vec3 l;
+            int edgeA = -1;
+            int edgeB = -1;
+            if (axis < 3) {
+                l = a.axes[axis];
+            } else if (axis < 6) {
+                l = b.axes[axis - 3];
+            } else {
+                edgeA = (axis - 6) / 3;
+                edgeB = (axis - 6) % 3;
+                l = cross(a.axes[edgeA], b.axes[edgeB]);
+                float magnitude = length(l);
+                if (magnitude <= parallelTolerance) {
+                    continue;
+                }
+                l /= magnitude;
+            }
+
+            float radiusA = 0;
+            float radiusB = 0;
+            for (int k = 0; k < 3; ++k) {
+                radiusA += a.halfExtents[k] * std::abs(dot(a.axes[k], l));
+                radiusB += b.halfExtents[k] * std::abs(dot(b.axes[k], l));
+            }
+            float overlap = radiusA + radiusB - std::abs(dot(t, l));
+            if (overlap < 0) {
+                return;
+            }
+
+            // faces give the better contacts, so edges only win clearly
+            if (!found || (edgeA < 0 ? overlap < bestOverlap : overlap < edgePreference * bestOverlap)) {
+                found = true;
+                bestOverlap = overlap;
+                bestAxis = dot(t, l) < 0 ? -l : l;
+                bestEdgeA = edgeA;
+                bestEdgeB = edgeB;
+            }
+        }
+
+        if (bestEdgeA >= 0) {
+            // the edges of both boxes along the axes of the cross product, at the supports along the normal
+            vec3 pointA = boxSupport(a, bestAxis);
+            vec3 pointB = boxSupport(b, -bestAxis);
+            vec3 edgeA = a.axes[bestEdgeA] * a.halfExtents[bestEdgeA];
+            vec3 edgeB = b.axes[bestEdgeB] * b.halfExtents[bestEdgeB];
+            vec3 centerA = pointA - a.axes[bestEdgeA] * dot(pointA - a.center, a.axes[bestEdgeA]);
+            vec3 centerB = pointB - b.axes[bestEdgeB] * dot(pointB - b.center, b.axes[bestEdgeB]);
+
+            vec3 closestA;
+            vec3 closestB;
+            closestSegmentSegment(centerA - edgeA, centerA + edgeA, centerB - edgeB, centerB + edgeB, closestA, closestB);
+
+            Contact contact;
+            contact.p = 0.5f * (closestA + closestB);
+            contact.n = bestAxis;
+            contacts.push_back(contact);
+            return;
+        }
+
+        // corners of each box inside of the other
+        size_t first = contacts.size();
+        for (int corner = 0; corner < 8; ++corner) {
+            Contact contact;
+            contact.n = bestAxis;
+
+            contact.p = boxCorner(b, corner);
+            if (insideBox(contact.p, a)) {
+                contacts.push_back(contact);
+            }
+            contact.p = boxCorner(a, corner);
+            if (insideBox(contact.p, b)) {
+                contacts.push_back(contact);
+            }
+        }
+
+        // edges crossing a face without a corner inside
+        if (contacts.size() == first) {
+            Contact contact;
+            contact.p = 0.5f * (boxSupport(a, bestAxis) + boxSupport(b, -bestAxis));
+            contact.n = bestAxis;
+            contacts.push_back(contact);
+        }
+    }
+
+    // Rows test the first primitive against the second, missing entries are tried the other way round
+    const PairTest pairTests[Primitive::NUMBER_OF_TYPES][Primitive::NUMBER_OF_TYPES] = {
+        //               MESH         SPHERE         BOX        CAPSULE
+        /* MESH */     { nullptr,     nullptr,       nullptr,   nullptr },
+        /* SPHERE */   { sphereMesh,  sphereSphere,  sphereBox, sphereCapsule },
+        /* BOX */      { nullptr,     nullptr,       boxBox,    boxCapsule },
+        /* CAPSULE */  { nullptr,     nullptr,       nullptr,   capsuleCapsule },
+    };
+}
+
+namespace PrimitiveCollision {
+    bool intersect(RigidBody &one, RigidBody &two, std::vector<Contact> &contacts) {
+        Primitive::Type typeOne = one.getPrimitive().type;
+        Primitive::Type typeTwo = two.getPrimitive().type;
+
+        if (pairTests[typeOne][typeTwo] != nullptr) {
+            pairTests[typeOne][typeTwo](place(one), place(two), contacts);
+            return true;
+        }
+
+        if (pairTests[typeTwo][typeOne] != nullptr) {
+            size_t first = contacts.size();
+            pairTests[typeTwo][typeOne](place(two), place(one), contacts);
+            for (size_t i = first; i < contacts.size(); ++i) {
+                contacts[i].n = -contacts[i].n;
+            }
+            return true;
+        }
+
+        return false;
+    }
+
+    bool lowestPoints(RigidBody &body, float &distance, std::vector<vec3> &points) {
+        // candidates in a fixed order, the lowest of them and all at the same height are kept
+        std::vector<vec3> candidates = std::vector<vec3>();
+        float radius;
+        if (!groundCandidates(body, candidates, radius)) {
+            return false;
+        }
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            candidates[i].y -= radius;
+        }
+
+        distance = candidates[0].y;
+        for (size_t i = 1; i < candidates.size(); ++i) {
+            distance = std::min(distance, candidates[i].y);
+        }
+
+        points.clear();
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            if (candidates[i].y == distance) {
+                points.push_back(candidates[i]);
+            }
+        }
+        return true;
+    }
+
+    bool groundCandidates(RigidBody &body, std::vector<vec3> &points, float &radius) {
+        if (body.getPrimitive().type == Primitive::MESH) {
+            return false;
+        }
+        Placed placed = place(body);
+
+        points.clear();
+        radius = 0;
+        if (placed.type == Primitive::SPHERE) {
+            points.push_back(placed.center);
+            radius = placed.radius;
+        } else if (placed.type == Primitive::BOX) {
+            for (int corner = 0; corner < 8; ++corner) {
+                points.push_back(boxCorner(placed, corner));
+            }
+        } else if (placed.type == Primitive::CAPSULE) {
+            points.push_back(placed.center - placed.halfAxis);
+            points.push_back(placed.center + placed.halfAxis);
+            radius = placed.radius;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,422 @@
+#include "Regression.h"
+
+#include "Simulation.h"
+#include "StateHash.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace glm;
+
+Regression::Regression(const RegressionConfig &config) {
+    m_config = config;
+    m_budgetTolerance = config.budgetTolerance >= 0 ? config.budgetTolerance : 0.25f;
+}
+
+bool Regression::parseArguments(int argc, char *argv[], RegressionConfig &config) {
+    for (int i = 0; i < argc; ++i) {
+        const char *separator = strchr(argv[i], '=');
+        if (separator == nullptr) {
+            printf("ERROR: Argument '%s' is not of the form key=value.\n", argv[i]);
+            return false;
+        }
+
+        std::string key = std::string(argv[i], separator - argv[i]);
+        std::string value = std::string(separator + 1);
+
+        if (key == "dir") {
+            config.directory = value;
+        } else if (key == "scene") {
+            config.scene = value;
+        } else if (key == "budgets") {
+            config.budgets = value;
+        } else if (key == "record") {
+            if (value == "budgets") {
+                config.recordBudgets = true;
+            } else {
+                config.record = atoi(value.c_str()) != 0;
+            }
+        } else if (key == "position") {
+            config.positionTolerance = (float)atof(value.c_str());
+        } else if (key == "orientation") {
+            config.orientationTolerance = (float)atof(value.c_str());
+        } else if (key == "budget") {
+            config.budgetTolerance = (float)atof(value.c_str());
+        } else if (key == "repeats") {
+            config.repeats = std::max(1, atoi(value.c_str()));
+        } else if (key == "interval") {
+            config.sampleInterval = std::max(1, atoi(value.c_str()));
+        } else {
+            printf("ERROR: Unknown argument '%s'.\n", key.c_str());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::vector<RegressionScene> Regression::getScenes() {
+    std::vector<RegressionScene> scenes = std::vector<RegressionScene>();
+
+    // every spinning top on its own
+    for (int type = 1; type <= 6; ++type) {
+        RegressionScene scene;
+        scene.name = "spin" + std::to_string(type);
+        scene.bodies.push_back({type, true, false, 0, 0});
+        scene.steps = 1000;
+        scene.timeStep = 0.01f;
+        scenes.push_back(scene);
+    }
+
+    // upside down tops which have to flip over
+    const int upsidedownTypes[2] = {3, 6};
+    for (int i = 0; i < 2; ++i) {
+        RegressionScene scene;
+        scene.name = "upsidedown" + std::to_string(upsidedownTypes[i]);
+        scene.bodies.push_back({upsidedownTypes[i], true, true, 0, 0});
+        scene.steps = 1000;
+        scene.timeStep = 0.01f;
+        scenes.push_back(scene);
+    }
+
+    // two tops close enough to touch
+    RegressionScene pair;
+    pair.name = "collision-pair";
+    pair.bodies.push_back({3, true, false, 0, 0});
+    pair.bodies.push_back({3, false, false, 1.9f, 0.2f});
+    pair.steps = 500;
+    pair.timeStep = 0.01f;
+    scenes.push_back(pair);
+
+    // the 2x2 grid of the V key, moved closer together
+    RegressionScene grid;
+    grid.name = "collision-grid";
+    for (int i = 0; i < 2; ++i) {
+        for (int j = 0; j < 2; ++j) {
+            grid.bodies.push_back({1, true, false, 1.9f * i, 1.9f * j});
+        }
+    }
+    grid.steps = 500;
+    grid.timeStep = 0.01f;
+    scenes.push_back(grid);
+
+    return scenes;
+}
+
+bool Regression::run() {
+    m_results = std::vector<RegressionResult>();
+
+    bool recording = m_config.record || m_config.recordBudgets;
+    std::map<std::string, float> budgets = readBudgets();
+
+    std::vector<RegressionScene> scenes = getScenes();
+    for (size_t i = 0; i < scenes.size(); ++i) {
+        const RegressionScene &scene = scenes[i];
+        if (!m_config.scene.empty() && scene.name.find(m_config.scene) == std::string::npos) {
+            continue;
+        }
+
+        RegressionResult result;
+        result.scene = scene.name;
+        result.passed = false;
+        result.positionError = 0;
+        result.orientationError = 0;
+        result.msPerStep = 0;
+        result.budget = 0;
+        result.identical = false;
+
+        std::map<std::string, float>::const_iterator budget = budgets.find(scene.name);
+
+        if (recording) {
+            RegressionTrajectory trajectory = simulate(scene, m_config.sampleInterval);
+            result.passed = !m_config.record || writeGolden(scene, trajectory);
+            result.msPerStep = trajectory.msPerStep;
+            result.budget = trajectory.msPerStep;
+            result.identical = true;
+            result.message = result.passed ? (m_config.record ? "recorded" : "budget recorded") : "could not write " + getFilename(scene);
+            budgets[scene.name] = trajectory.msPerStep;
+        } else {
+            RegressionTrajectory golden;
+            if (!readGolden(scene, golden)) {
+                result.message = "no golden file " + getFilename(scene) + " (create it with record=1)";
+            } else if (golden.steps != scene.steps || golden.numberOfBodies != scene.bodies.size()) {
+                result.message = "golden file does not match the scene (record it again)";
+            } else {
+                result = compare(scene, simulate(scene, golden.sampleInterval), golden, budget != budgets.end() ? budget->second : 0.f);
+            }
+        }
+
+        printf("%s %-16s %9.4f ms/step (budget %.4f) position error %g orientation error %g%s%s%s\n",
+               result.passed ? "PASS" : "FAIL", result.scene.c_str(), result.msPerStep, result.budget,
+               result.positionError, result.orientationError, result.identical ? " (identical)" : "",
+               result.message.empty() ? "" : ": ", result.message.c_str());
+
+        m_results.push_back(result);
+    }
+
+    bool passed = true;
+    for (size_t i = 0; i < m_results.size(); ++i) {
+        passed = passed && m_results[i].passed;
+    }
+
+    if (recording && !writeBudgets(budgets)) {
+        passed = false;
+    }
+    return passed;
+}
+
+const std::vector<RegressionResult> &Regression::getResults() const {
+    return m_results;
+}
+
+void Regression::printReport() const {
+    int failed = 0;
+
+    // the metric closest to (or furthest beyond) its tolerance
+    float worstRatio = -1;
+    const RegressionResult *worst = nullptr;
+    std::string worstMetric;
+
+    for (size_t i = 0; i < m_results.size(); ++i) {
+        const RegressionResult &result = m_results[i];
+        if (!result.passed) {
+            failed++;
+        }
+        if (m_config.record) {
+            continue;
+        }
+
+        float ratios[3] = {
+            result.positionError / m_config.positionTolerance,
+            result.orientationError / m_config.orientationTolerance,
+            result.budget > 0 ? result.msPerStep / (result.budget * (1 + m_budgetTolerance)) : 0.f
+        };
+        const char *metrics[3] = {"position error", "orientation error", "ms/step"};
+
+        for (int j = 0; j < 3; ++j) {
+            if (ratios[j] > worstRatio) {
+                worstRatio = ratios[j];
+                worst = &result;
+                worstMetric = metrics[j];
+            }
+        }
+    }
+
+    printf("Regression: %lu scenes, %d failed -> %s\n", m_results.size(), failed, failed == 0 ? "PASS" : "FAIL");
+
+    if (worst != nullptr) {
+        printf("\tworst: %s %s at %.0f%% of its tolerance\n", worst->scene.c_str(), worstMetric.c_str(), worstRatio * 100);
+    }
+}
+
+RegressionTrajectory Regression::simulate(const RegressionScene &scene, int sampleInterval) const {
+    RegressionTrajectory trajectory;
+    trajectory.steps = scene.steps;
+    trajectory.sampleInterval = sampleInterval;
+    trajectory.numberOfBodies = scene.bodies.size();
+    trajectory.hash = 0;
+    trajectory.msPerStep = 0;
+
+    for (int repeat = 0; repeat < std::max(1, m_config.repeats); ++repeat) {
+        Simulation simulation;
+        simulation.setMaxNumberOfStates(2);
+        simulation.setDeterministic(true);
+
+        for (size_t i = 0; i < scene.bodies.size(); ++i) {
+            const RegressionBody &body = scene.bodies[i];
+            simulation.addRigidBody(body.type, body.rotating, body.upsidedown, body.xOffset, body.yOffset);
+        }
+
+        // only the first repeat is sampled, the others are just timed
+        bool sample = repeat == 0;
+        double seconds = 0;
+
+        for (int step = 0; step < scene.steps; ++step) {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            simulation.forwardStep(scene.timeStep);
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            if (sample && ((step + 1) % sampleInterval == 0 || step + 1 == scene.steps)) {
+                std::vector<RigidBody> *state = simulation.getCurrentState();
+                for (size_t i = 0; i < state->size(); ++i) {
+                    trajectory.positions.push_back(state->at(i).getPosition());
+                    trajectory.orientations.push_back(state->at(i).getOrientation());
+                }
+            }
+        }
+
+        if (sample) {
+            trajectory.hash = StateHash::hash(*simulation.getCurrentState());
+        }
+
+        float msPerStep = scene.steps > 0 ? (float)(seconds * 1000.0 / scene.steps) : 0.f;
+        if (repeat == 0 || msPerStep < trajectory.msPerStep) {
+            trajectory.msPerStep = msPerStep;
+        }
+    }
+
+    return trajectory;
+}
+
+RegressionResult Regression::compare(const RegressionScene &scene, const RegressionTrajectory &trajectory, const RegressionTrajectory &golden, float budget) const {
+    RegressionResult result;
+    result.scene = scene.name;
+    result.positionError = 0;
+    result.orientationError = 0;
+    result.msPerStep = trajectory.msPerStep;
+    result.budget = budget;
+    result.identical = trajectory.hash == golden.hash;
+
+    if (trajectory.positions.size() != golden.positions.size()) {
+        result.passed = false;
+        result.message = "different number of samples (record it again)";
+        return result;
+    }
+
+    for (size_t i = 0; i < golden.positions.size(); ++i) {
+        result.positionError = std::max(result.positionError, length(trajectory.positions[i] - golden.positions[i]));
+
+        // angle of the rotation between both, q and -q are the same rotation. atan2 instead of acos of the dot
+        // product, which is off by ~1e-3 rad for identical unit quaternions due to float rounding.
+        quat difference = trajectory.orientations[i] * conjugate(golden.orientations[i]);
+        float angle = 2.f * std::atan2(length(vec3(difference.x, difference.y, difference.z)), std::abs(difference.w));
+        result.orientationError = std::max(result.orientationError, angle);
+    }
+
+    std::vector<std::string> failures = std::vector<std::string>();
+    if (!(result.positionError <= m_config.positionTolerance)) {
+        failures.push_back("position");
+    }
+    if (!(result.orientationError <= m_config.orientationTolerance)) {
+        failures.push_back("orientation");
+    }
+    if (result.budget > 0 && result.msPerStep > result.budget * (1 + m_budgetTolerance)) {
+        failures.push_back("over budget");
+    }
+
+    result.passed = failures.empty();
+    for (size_t i = 0; i < failures.size(); ++i) {
+        result.message += (i > 0 ? ", " : "") + failures[i];
+    }
+    if (result.budget <= 0) {
+        result.message += std::string(failures.empty() ? "" : ", ") + "no budget (record=budgets)";
+    }
+
+    return result;
+}
+
+std::string Regression::getFilename(const RegressionScene &scene) const {
+    return m_config.directory + "/" + scene.name + ".txt";
+}
+
+bool Regression::readGolden(const RegressionScene &scene, RegressionTrajectory &golden) const {
+    FILE *file = fopen(getFilename(scene).c_str(), "r");
+    if (file == nullptr) {
+        return false;
+    }
+
+    unsigned long numberOfBodies = 0;
+    unsigned long samples = 0;
+    bool valid = fscanf(file, " steps %d", &golden.steps) == 1 &&
+                 fscanf(file, " interval %d", &golden.sampleInterval) == 1 &&
+                 fscanf(file, " bodies %lu", &numberOfBodies) == 1 &&
+                 fscanf(file, " samples %lu", &samples) == 1 &&
+                 fscanf(file, " hash %" SCNx64, &golden.hash) == 1 &&
+                 golden.sampleInterval > 0;
+
+    golden.numberOfBodies = numberOfBodies;
+    golden.msPerStep = 0;
+    golden.positions = std::vector<vec3>();
+    golden.orientations = std::vector<quat>();
+
+    for (unsigned long i = 0; valid && i < samples * numberOfBodies; ++i) {
+        vec3 p;
+        quat q;
+        valid = fscanf(file, "%f %f %f %f %f %f %f", &p.x, &p.y, &p.z, &q.w, &q.x, &q.y, &q.z) == 7;
+        golden.positions.push_back(p);
+        golden.orientations.push_back(q);
+    }
+
+    fclose(file);
+
+    if (!valid) {
+        printf("ERROR: Invalid golden file %s.\n", getFilename(scene).c_str());
+    }
+    return valid;
+}
+
+bool Regression::writeGolden(const RegressionScene &scene, const RegressionTrajectory &trajectory) const {
+    FILE *file = fopen(getFilename(scene).c_str(), "w");
+    if (file == nullptr) {
+        printf("ERROR: Could not write golden file %s.\n", getFilename(scene).c_str());
+        return false;
+    }
+
+    size_t samples = trajectory.numberOfBodies > 0 ? trajectory.positions.size() / trajectory.numberOfBodies : 0;
+
+    fprintf(file, "steps %d\n", trajectory.steps);
+    fprintf(file, "interval %d\n", trajectory.sampleInterval);
+    fprintf(file, "bodies %lu\n", trajectory.numberOfBodies);
+    fprintf(file, "samples %lu\n", samples);
+    fprintf(file, "hash %016" PRIx64 "\n", trajectory.hash);
+
+    // one line per body and sample, enough digits to read the same floats back
+    for (size_t i = 0; i < trajectory.positions.size(); ++i) {
+        const vec3 &p = trajectory.positions[i];
+        const quat &q = trajectory.orientations[i];
+        fprintf(file, "%.9g %.9g %.9g %.9g %.9g %.9g %.9g\n", p.x, p.y, p.z, q.w, q.x, q.y, q.z);
+    }
+
+    fclose(file);
+    return true;
+}
+
+std::string Regression::getBudgetsFilename() const {
+    return m_config.budgets.empty() ? m_config.directory + "/budgets.txt" : m_config.budgets;
+}
+
+std::map<std::string, float> Regression::readBudgets() {
+    std::map<std::string, float> budgets = std::map<std::string, float>();
+
+    FILE *file = fopen(getBudgetsFilename().c_str(), "r");
+    if (file == nullptr) {
+        return budgets;
+    }
+
+    // "tolerance <relative slowdown>" followed by "<scene> <ms/step>" lines
+    char name[256];
+    float value;
+    while (fscanf(file, " %255s %f", name, &value) == 2) {
+        if (strcmp(name, "tolerance") == 0) {
+            if (m_config.budgetTolerance < 0) {
+                m_budgetTolerance = value;
+            }
+        } else {
+            budgets[name] = value;
+        }
+    }
+
+    fclose(file);
+    return budgets;
+}
+
+bool Regression::writeBudgets(const std::map<std::string, float> &budgets) const {
+    FILE *file = fopen(getBudgetsFilename().c_str(), "w");
+    if (file == nullptr) {
+        printf("ERROR: Could not write budget file %s.\n", getBudgetsFilename().c_str());
+        return false;
+    }
+
+    fprintf(file, "tolerance %g\n", m_budgetTolerance);
+    for (std::map<std::string, float>::const_iterator it = budgets.begin(); it != budgets.end(); ++it) {
+        fprintf(file, "%s %.9g\n", it->first.c_str(), it->second);
+    }
+
+    fclose(file);
+    return true;
+}
@@ -1,13 +1,15 @@
 #include "RigidBody.h"
 
 #include "Assets.h"
+#include "GJK.h"
 #include "InertiaTensor.h"
+#include "Shape.h"
 
 #include <algorithm>
+#include <cmath>
 #include <numeric>
 #include <queue>
 
-#include <GLFW/glfw3.h>
 #include <glm/gtc/matrix_access.hpp>
 #include <glm/ext.hpp>
 
@@ -19,10 +21,6 @@ using namespace glm;
 
 vec3 maxAngularVelocity = vec3(1,1,1) * 100000000.f; // 100 000 000 is an arbitrary but resonable limit to avoid nan
 
-int frictionMethod = 3; // default = forced based friction; 1 = Impulse-Based Friction Model (Coulomb friction model); NYI 2 = Wikipedia; 3 = MatLab
-
-bool firstTime;
-
 mat3 star(const vec3 v) {
     glm::mat3 m = glm::mat3();
     m[0] = glm::vec3(0, v.z, -v.y);
@@ -45,15 +43,20 @@ RigidBody::RigidBody() : Body() {
 
 void RigidBody::setDefaults() {
     m_active = true;
+    m_static = false;
+    m_collisionLayer = 1;
+    m_collisionMask = 0xffffffff;
     m_mass = 1;
     m_linearMomentum = vec3(0, 0, 0);
     m_angularMomentum = vec3(0, 0, 0);
     m_angularVelocity = vec3(0, 0, 0);
     m_force = vec3(0, 0, 0);
     m_torque = vec3(0, 0, 0);
-    firstTime = true;
     m_lastVelocities = std::vector<float>();
     isCurrentlyActive = false;
+    m_shape = nullptr;
+    m_groundVertex = 0;
+    m_boundingBox = nullptr;
     octreeMeshes = new std::vector<Body>();
 }
 
@@ -74,7 +77,9 @@ void RigidBody::setBodyInertiaTensorInv(const mat3 bodyInertiaTensorInv) {
 void RigidBody::setMesh(Mesh *mesh) {
     Body::setMesh(mesh);
 
-    m_boundingBox = new OOBB(mesh);
+    m_shape = Shape::get(mesh);
+    m_groundVertex = 0;
+    m_boundingBox = m_shape->getBoundingBox();
     
     // m_bodyInertiaTensorInv = InertiaTensor::calculateInertiaTensor(this);
     // printf("body inertia tensor inv:\n\t%f %f %f\n\t%f %f %f\n\t%f %f %f\n", m_bodyInertiaTensorInv[0][0], m_bodyInertiaTensorInv[0][1], m_bodyInertiaTensorInv[0][2], m_bodyInertiaTensorInv[1][0], m_bodyInertiaTensorInv[1][1], m_bodyInertiaTensorInv[1][2], m_bodyInertiaTensorInv[2][0], m_bodyInertiaTensorInv[2][1], m_bodyInertiaTensorInv[2][2]);
@@ -84,11 +89,57 @@ OOBB * RigidBody::getBoundingBox() {
     return m_boundingBox;
 }
 
+Shape * RigidBody::getShape() {
+    return m_shape;
+}
+
+RigidBodyState RigidBody::getState() const {
+    RigidBodyState state;
+    state.position = m_position;
+    state.orientation = m_orientation;
+    state.linearMomentum = m_linearMomentum;
+    state.angularMomentum = m_angularMomentum;
+    state.angularVelocity = m_angularVelocity;
+    state.force = m_force;
+    state.torque = m_torque;
+    
+    // update keeps at most 10 velocities
+    state.numberOfLastVelocities = (unsigned char)std::min(m_lastVelocities.size(), (size_t)10);
+    std::copy(m_lastVelocities.end() - state.numberOfLastVelocities, m_lastVelocities.end(), state.lastVelocities);
+    
+    state.active = m_active;
+    state.isCurrentlyActive = isCurrentlyActive;
+    state.groundVertex = m_groundVertex;
+    return state;
+}
+
+void RigidBody::setState(const RigidBodyState &state) {
+    m_position = state.position;
+    m_orientation = state.orientation;
+    m_linearMomentum = state.linearMomentum;
+    m_angularMomentum = state.angularMomentum;
+    m_angularVelocity = state.angularVelocity;
+    m_force = state.force;
+    m_torque = state.torque;
+    m_lastVelocities = std::vector<float>(state.lastVelocities, state.lastVelocities + state.numberOfLastVelocities);
+    m_active = state.active;
+    isCurrentlyActive = state.isCurrentlyActive;
+    m_groundVertex = state.groundVertex;
+    
+    // derived quantities, computed the same way as in update
+    m_rotationMatrix = mat3(mat3_cast(m_orientation));
+    m_inertiaTensorInv = m_rotationMatrix * m_bodyInertiaTensorInv * transpose(m_rotationMatrix);
+}
+
 void RigidBody::addForce(const vec3 force) {
     addForce(force, m_position);
 }
 
 void RigidBody::addForce(const vec3 force, const vec3 position) {
+    if (m_static) {
+        return;
+    }
+    
     // PBS slides
     m_force += force;
     
@@ -103,6 +154,10 @@ void RigidBody::addImpulse(const vec3 impulse) {
 }
 
 void RigidBody::addImpulse(const vec3 impulse, const vec3 position) {
+    if (m_static) {
+        return;
+    }
+    
     m_linearMomentum += impulse;
     
     vec3 torqueImpulse = cross(position - m_position, impulse);
@@ -115,12 +170,106 @@ void RigidBody::addImpulse(const vec3 impulse, const vec3 position) {
 }
 
 void RigidBody::addTorque(const glm::vec3 torque) {
+    if (m_static) {
+        return;
+    }
+    
     m_torque += torque;
 }
 
-std::vector<Contact> intersectOctrees(OOBB *one, mat4 &modelOne, OOBB *two, mat4 &modelTwo, mat4 &invBox2ModelMatTimesBox1ModelMat) {
+void RigidBody::setPrimitive(const Primitive &primitive) {
+    m_primitive = primitive;
+}
+
+const Primitive &RigidBody::getPrimitive() const {
+    return m_primitive;
+}
+
+void RigidBody::setStatic(bool isStatic) {
+    m_static = isStatic;
+    if (m_static) {
+        m_linearMomentum = vec3(0, 0, 0);
+        m_angularMomentum = vec3(0, 0, 0);
+        m_angularVelocity = vec3(0, 0, 0);
+        m_force = vec3(0, 0, 0);
+        m_torque = vec3(0, 0, 0);
+        m_inertiaTensorInv = mat3(0.f);
+    }
+}
+
+bool RigidBody::isStatic() const {
+    return m_static;
+}
+
+void RigidBody::setCollisionLayer(uint32_t layer) {
+    m_collisionLayer = layer;
+}
+
+void RigidBody::setCollisionMask(uint32_t mask) {
+    m_collisionMask = mask;
+}
+
+uint32_t RigidBody::getCollisionLayer() const {
+    return m_collisionLayer;
+}
+
+uint32_t RigidBody::getCollisionMask() const {
+    return m_collisionMask;
+}
+
+bool RigidBody::collidesWith(const RigidBody &body) const {
+    return (m_collisionLayer & body.m_collisionMask) != 0 && (body.m_collisionLayer & m_collisionMask) != 0;
+}
+
+namespace {
+    thread_local TraversalCounters traversalCounters = TraversalCounters();
+}
+
+TraversalCounters RigidBody::getTraversalCounters() {
+    return traversalCounters;
+}
+
+void RigidBody::resetTraversalCounters() {
+    traversalCounters = TraversalCounters();
+}
+
+// Triangle pairs of two leaves, in the local space of two: only the triangles of one are transformed (with
+// invBox2ModelMatTimesBox1ModelMat and its normal matrix normalOneToTwo). Contacts go back to world space with modelTwo and normalTwo.
+void intersectLeaves(OOBB *one, OOBB *two, const mat4 &modelTwo, const mat3 &normalTwo, const mat4 &invBox2ModelMatTimesBox1ModelMat, const mat3 &normalOneToTwo, std::vector<Contact> &intersectionPoints) {
+    const std::vector<Triangle> &trianglesOne = one->getIncludedTriangles();
+    const std::vector<Triangle> &trianglesTwo = two->getIncludedTriangles();
+    const TriangleBatch &batchTwo = two->getTriangleBatch();
+    
+    std::vector<TriangleHit> hits = std::vector<TriangleHit>();
+    
+    for (size_t i = 0; i < trianglesOne.size() /*&& intersectionPoints.size() == 0*/; ++i) {
+        Triangle triangleOne = trianglesOne[i].transformWith(invBox2ModelMatTimesBox1ModelMat, normalOneToTwo);
+        
+        // all triangles of two at once, same results as IntersectionTest::intersectionTriangleTriangle per pair
+        traversalCounters.trianglePairs += batchTwo.size();
+        hits.clear();
+        batchTwo.intersect(triangleOne, hits);
+        
+        for (size_t j = 0; j < hits.size(); ++j) {
+            glm::vec3 intersectionNormal = hits[j].normal;
+            
+            if (intersectionNormal == trianglesTwo[hits[j].index].normal) {
+                // printf("changed normal: %f %f %f\n", intersectionNormal.x, intersectionNormal.y, intersectionNormal.z);
+                intersectionNormal *= -1.f;
+            }
+            
+            Contact contact;
+            contact.p = vec3(modelTwo * vec4(hits[j].point, 1.f));
+            contact.n = normalTwo * intersectionNormal;
+            
+            intersectionPoints.push_back(contact);
+        }
+    }
+}
+
+std::vector<Contact> intersectOctrees(OOBB *one, OOBB *two, const mat4 &modelTwo, const mat3 &normalTwo, const mat4 &invBox2ModelMatTimesBox1ModelMat, const mat3 &normalOneToTwo, std::pair<OOBB *, OOBB *> *contactLeaves) {
     std::vector<Contact> intersectionPoints = std::vector<Contact>();
-    // countBoxBox++;
+    traversalCounters.nodeVisits++;
     if (IntersectionTest::intersectionBoxBox(one->getOrigin(), one->getRadii(), two->getOrigin(), two->getRadii(), invBox2ModelMatTimesBox1ModelMat)) {
         
         std::vector<OOBB> * childrenOne = one->getChildren();
@@ -129,57 +278,24 @@ std::vector<Contact> intersectOctrees(OOBB *one, mat4 &modelOne, OOBB *two, mat4
         if (childrenOne->size() > 0 && childrenTwo->size() > 0) {
             for (size_t i = 0; i < childrenOne->size() && intersectionPoints.size() == 0; ++i) {
                 for (size_t j = 0; j < childrenTwo->size() && intersectionPoints.size() == 0; ++j) {
-                    std::vector<Contact> newPoints = intersectOctrees(&childrenOne->at(i), modelOne, &childrenTwo->at(j), modelTwo, invBox2ModelMatTimesBox1ModelMat);
+                    std::vector<Contact> newPoints = intersectOctrees(&childrenOne->at(i), &childrenTwo->at(j), modelTwo, normalTwo, invBox2ModelMatTimesBox1ModelMat, normalOneToTwo, contactLeaves);
                     intersectionPoints.insert(intersectionPoints.end(), newPoints.begin(), newPoints.end());
                 }
             }
         } else if (childrenOne->size() > 0) {
             for (size_t i = 0; i < childrenOne->size() && intersectionPoints.size() == 0; ++i) {
-                std::vector<Contact> newPoints = intersectOctrees(&childrenOne->at(i), modelOne, two, modelTwo, invBox2ModelMatTimesBox1ModelMat);
+                std::vector<Contact> newPoints = intersectOctrees(&childrenOne->at(i), two, modelTwo, normalTwo, invBox2ModelMatTimesBox1ModelMat, normalOneToTwo, contactLeaves);
                 intersectionPoints.insert(intersectionPoints.end(), newPoints.begin(), newPoints.end());
             }
         } else if (childrenTwo->size() > 0) {
             for (size_t i = 0; i < childrenTwo->size() && intersectionPoints.size() == 0; ++i) {
-                std::vector<Contact> newPoints = intersectOctrees(one, modelOne, &childrenTwo->at(i), modelTwo, invBox2ModelMatTimesBox1ModelMat);
+                std::vector<Contact> newPoints = intersectOctrees(one, &childrenTwo->at(i), modelTwo, normalTwo, invBox2ModelMatTimesBox1ModelMat, normalOneToTwo, contactLeaves);
                 intersectionPoints.insert(intersectionPoints.end(), newPoints.begin(), newPoints.end());
             }
         } else {
-            std::vector<Triangle> trianglesOne =  one->getIncludedTriangles();
-            std::vector<Triangle> trianglesTwo =  two->getIncludedTriangles();
-            
-            std::vector<Triangle> trianglesOneWorld = std::vector<Triangle>();
-            std::vector<Triangle> trianglesTwoWorld = std::vector<Triangle>();
-            
-            for (size_t i = 0; i < trianglesOne.size(); ++i) {
-                trianglesOneWorld.push_back(trianglesOne[i].transformWith(modelOne));
-            }
-            
-            for (size_t i = 0; i < trianglesTwo.size(); ++i) {
-                trianglesTwoWorld.push_back(trianglesTwo[i].transformWith(modelTwo));
-            }
-            
-            for (size_t i = 0; i < trianglesOneWorld.size() /*&& intersectionPoints.size() == 0*/; ++i) {
-                for (size_t j = 0; j < trianglesTwoWorld.size() /*&& intersectionPoints.size() == 0*/; ++j) {
-
-                    glm::vec3 intersectionPoint;
-                    glm::vec3 intersectionNormal;
-                    // countTriangleTriangle++;
-                    if (IntersectionTest::intersectionTriangleTriangle(trianglesOneWorld[i], trianglesTwoWorld[j], intersectionPoint, intersectionNormal)) {
-                        
-                        Contact contact;
-                        contact.p = intersectionPoint;
-                        contact.n = intersectionNormal;
-                        
-                        if (intersectionNormal == trianglesTwoWorld[j].normal) {
-                            // printf("changed normal: %f %f %f\n", contact.n.x, contact.n.y, contact.n.z);
-                            contact.n *= -1.f;
-                        } else {
-                            // printf("non changed normal: %f %f %f\n", contact.n.x, contact.n.y, contact.n.z);
-                        }
-                        
-                        intersectionPoints.push_back(contact);
-                    }
-                }
+            intersectLeaves(one, two, modelTwo, normalTwo, invBox2ModelMatTimesBox1ModelMat, normalOneToTwo, intersectionPoints);
+            if (intersectionPoints.size() > 0 && contactLeaves != nullptr) {
+                *contactLeaves = std::make_pair(one, two);
             }
         }
     }
@@ -187,7 +303,70 @@ std::vector<Contact> intersectOctrees(OOBB *one, mat4 &modelOne, OOBB *two, mat4
     return intersectionPoints;
 }
 
-std::vector<Contact> RigidBody::intersectWith(RigidBody &body) {
+// Upper bound on how far any point of box one moves in the space of two when its transform changes from one to the other
+float motionBetween(const mat4 &from, const mat4 &to, OOBB *one) {
+    vec3 farthest = max(abs(one->getOrigin()), abs(one->getOrigin() + one->getRadii()));
+    
+    // the frobenius norm bounds how much the linear part stretches a vector
+    float linear = 0;
+    for (int column = 0; column < 3; ++column) {
+        for (int row = 0; row < 3; ++row) {
+            float difference = to[column][row] - from[column][row];
+            linear += difference * difference;
+        }
+    }
+    
+    return length(vec3(to[3]) - vec3(from[3])) + std::sqrt(linear) * length(farthest);
+}
+
+// Starts where the last test ended while the bodies moved less than the margin relative to each other: roots which
+// were apart by more than the margin are still apart, and the leaf pair which gave the last contacts is tested first.
+std::vector<Contact> intersectOctreesCoherent(OOBB *one, OOBB *two, const mat4 &modelTwo, const mat3 &normalTwo, const mat4 &invBox2ModelMatTimesBox1ModelMat, const mat3 &normalOneToTwo, PairCache &cache) {
+    if (cache.one != one || cache.two != two) {
+        cache.one = one;
+        cache.two = two;
+        cache.valid = false;
+    }
+    
+    float margin = cache.margin * length(two->getRadii());
+    
+    std::vector<Contact> intersectionPoints = std::vector<Contact>();
+    
+    if (cache.valid && motionBetween(cache.transform, invBox2ModelMatTimesBox1ModelMat, one) <= margin) {
+        traversalCounters.cachedTests++;
+        
+        OOBB *leafOne = cache.contactLeaves.first;
+        OOBB *leafTwo = cache.contactLeaves.second;
+        if (leafOne == nullptr) {
+            return intersectionPoints;
+        }
+        
+        traversalCounters.nodeVisits++;
+        if (IntersectionTest::intersectionBoxBox(leafOne->getOrigin(), leafOne->getRadii(), leafTwo->getOrigin(), leafTwo->getRadii(), invBox2ModelMatTimesBox1ModelMat)) {
+            intersectLeaves(leafOne, leafTwo, modelTwo, normalTwo, invBox2ModelMatTimesBox1ModelMat, normalOneToTwo, intersectionPoints);
+        }
+        if (intersectionPoints.size() > 0) {
+            return intersectionPoints;
+        }
+    }
+    
+    std::pair<OOBB *, OOBB *> contactLeaves = std::pair<OOBB *, OOBB *>(nullptr, nullptr);
+    intersectionPoints = intersectOctrees(one, two, modelTwo, normalTwo, invBox2ModelMatTimesBox1ModelMat, normalOneToTwo, &contactLeaves);
+    
+    if (intersectionPoints.size() > 0) {
+        cache.valid = true;
+    } else {
+        // a surface of the root of one moving less than the margin cannot reach the root of two grown by it
+        traversalCounters.nodeVisits++;
+        cache.valid = !IntersectionTest::intersectionBoxBox(one->getOrigin(), one->getRadii(), two->getOrigin() - vec3(margin), two->getRadii() + vec3(2.f * margin), invBox2ModelMatTimesBox1ModelMat);
+    }
+    cache.transform = invBox2ModelMatTimesBox1ModelMat;
+    cache.contactLeaves = contactLeaves;
+    
+    return intersectionPoints;
+}
+
+std::vector<Contact> RigidBody::intersectWith(RigidBody &body, bool convexContacts, PairCache *cache) {
     std::vector<Contact> intersectionPoints = std::vector<Contact>();
     
     // int oldcountBoxBox = countBoxBox;
@@ -200,7 +379,29 @@ std::vector<Contact> RigidBody::intersectWith(RigidBody &body) {
     OOBB *myBoundingBox = getBoundingBox();
     OOBB *bodyBoundingBox = body.getBoundingBox();
     mat4 invBox2ModelMatTimesBox1ModelMat = inverse(bodyModel) * myModel;
-    intersectionPoints = intersectOctrees(myBoundingBox, myModel, bodyBoundingBox, bodyModel, invBox2ModelMatTimesBox1ModelMat);
+    
+    // normal matrices, only once per pair (the rotation for unscaled bodies)
+    mat3 bodyNormal = transpose(inverse(mat3(bodyModel)));
+    mat3 myNormalToBody = transpose(inverse(mat3(invBox2ModelMatTimesBox1ModelMat)));
+    
+    if (convexContacts && m_shape != nullptr && body.m_shape != nullptr && m_shape->isConvex() && body.m_shape->isConvex()) {
+        vec3 point;
+        vec3 normal;
+        float depth;
+        if (GJK::penetration(m_shape->getConvexHull(), invBox2ModelMatTimesBox1ModelMat, body.m_shape->getConvexHull(), point, normal, depth)) {
+            Contact contact;
+            contact.p = vec3(bodyModel * vec4(point, 1.f));
+            contact.n = normalize(bodyNormal * normal);
+            intersectionPoints.push_back(contact);
+        }
+        return intersectionPoints;
+    }
+    
+    if (cache != nullptr && cache->margin > 0) {
+        intersectionPoints = intersectOctreesCoherent(myBoundingBox, bodyBoundingBox, bodyModel, bodyNormal, invBox2ModelMatTimesBox1ModelMat, myNormalToBody, *cache);
+    } else {
+        intersectionPoints = intersectOctrees(myBoundingBox, bodyBoundingBox, bodyModel, bodyNormal, invBox2ModelMatTimesBox1ModelMat, myNormalToBody, nullptr);
+    }
     
     // countBoxBox = max(countBoxBox, oldcountBoxBox);
     // countTriangleTriangle = max(countTriangleTriangle, oldcountTriangleTriangle);
@@ -209,9 +410,259 @@ std::vector<Contact> RigidBody::intersectWith(RigidBody &body) {
     return intersectionPoints;
 }
 
+// Vertices of a mesh which lie inside of the distance field of another body, with the normal pointing out of the field
+void penetratingVertices(Mesh *mesh, const mat4 &vertexModel, const DistanceField &field, const mat4 &fieldModel, std::vector<Contact> &intersectionPoints, float normalSign) {
+    mat4 vertexToField = inverse(fieldModel) * vertexModel;
+    mat3 fieldNormal = transpose(inverse(mat3(fieldModel)));
+    
+    GLfloat *vertices = mesh->getDistinctVertices();
+    for (GLuint i = 0; i + 2 < mesh->getNumDistinctVertices(); i += 3) {
+        vec3 point = vec3(vertexToField * vec4(vertices[i], vertices[i+1], vertices[i+2], 1.f));
+        if (!field.contains(point)) {
+            continue;
+        }
+        
+        float distance = field.distanceAt(point);
+        if (distance >= 0) {
+            continue;
+        }
+        
+        // deeper than the band the field is flat and gives no direction
+        vec3 gradient = field.gradientAt(point);
+        if (gradient == vec3(0, 0, 0)) {
+            continue;
+        }
+        
+        // halfway between the vertex and the surface of the field
+        vec3 normal = normalize(fieldNormal * gradient);
+        vec3 surface = vec3(fieldModel * vec4(point - distance * gradient, 1.f));
+        
+        Contact contact;
+        contact.p = 0.5f * (vec3(vertexModel * vec4(vertices[i], vertices[i+1], vertices[i+2], 1.f)) + surface);
+        contact.n = normalSign * normal;
+        intersectionPoints.push_back(contact);
+    }
+}
+
+std::vector<Contact> RigidBody::intersectDistanceFields(RigidBody &body) {
+    std::vector<Contact> intersectionPoints = std::vector<Contact>();
+    if (m_shape == nullptr || body.m_shape == nullptr) {
+        return intersectionPoints;
+    }
+    
+    mat4 myModel = model();
+    mat4 bodyModel = body.model();
+    
+    // bounding spheres of the roots
+    OOBB *myBoundingBox = getBoundingBox();
+    OOBB *bodyBoundingBox = body.getBoundingBox();
+    vec3 myCenter = vec3(myModel * vec4(myBoundingBox->getOrigin() + 0.5f * myBoundingBox->getRadii(), 1.f));
+    vec3 bodyCenter = vec3(bodyModel * vec4(bodyBoundingBox->getOrigin() + 0.5f * bodyBoundingBox->getRadii(), 1.f));
+    float radii = 0.5f * (length(getScale() * myBoundingBox->getRadii()) + length(body.getScale() * bodyBoundingBox->getRadii()));
+    if (length(myCenter - bodyCenter) > radii) {
+        return intersectionPoints;
+    }
+    
+    const DistanceField &myField = m_shape->getDistanceField();
+    const DistanceField &bodyField = body.m_shape->getDistanceField();
+    if (!myField.isValid() || !bodyField.isValid()) {
+        return intersectionPoints;
+    }
+    
+    // the outward normal of the other body points toward this one, the own outward normal toward the other
+    penetratingVertices(m_mesh, myModel, bodyField, bodyModel, intersectionPoints, -1.f);
+    penetratingVertices(body.m_mesh, bodyModel, myField, myModel, intersectionPoints, 1.f);
+    
+    return intersectionPoints;
+}
+
+// the lowest vertex of the hull, found by walking from the one of the last step
+float RigidBody::distanceToGround(bool primitives, const Ground &ground, vec3 &normal) {
+    normal = vec3(0, 1, 0);
+    if (!ground.isFlat()) {
+        vec3 point;
+        return deepestPointInGround(primitives, ground, point, normal);
+    }
+    
+    // ground at (x, 0, z)
+    float distance;
+    std::vector<vec3> points = std::vector<vec3>();
+    if (primitives && PrimitiveCollision::lowestPoints(*this, distance, points)) {
+        return distance;
+    }
+    
+    if (m_shape == nullptr || !m_shape->getConvexHull().isValid()) {
+        return distanceToGroundOfVertices();
+    }
+    const ConvexHull &hull = m_shape->getConvexHull();
+    
+    mat4 myModel = model();
+    
+    // the lowest vertex is the one farthest along the world down direction in model space
+    vec3 down = -vec3(myModel[0][1], myModel[1][1], myModel[2][1]);
+    m_groundVertex = hull.supportIndex(down, m_groundVertex);
+    
+    // the model matrix rounds differently than the dot product, so descend to the lowest neighbour by world height
+    float height = (myModel * vec4(hull.getVertices()[m_groundVertex], 1.f)).y;
+    for (bool lower = true; lower;) {
+        lower = false;
+        const std::vector<int> &neighbours = hull.getNeighbours(m_groundVertex);
+        for (size_t i = 0; i < neighbours.size() && !lower; ++i) {
+            float neighbourHeight = (myModel * vec4(hull.getVertices()[neighbours[i]], 1.f)).y;
+            if (neighbourHeight < height) {
+                m_groundVertex = neighbours[i];
+                height = neighbourHeight;
+                lower = true;
+            }
+        }
+    }
+    
+    return heightOfSurface(hull, m_groundVertex, myModel);
+}
+
+// the lowest of the hull vertex and the mesh points on its faces, which can lie lower within the tolerance of the hull
+float RigidBody::heightOfSurface(const ConvexHull &hull, int vertex, const mat4 &myModel) {
+    float height = (myModel * vec4(hull.getVertices()[vertex], 1.f)).y;
+    
+    const std::vector<int> &surfacePoints = hull.getSurfacePoints(vertex);
+    GLfloat *vertices = m_shape->getMesh()->getDistinctVertices();
+    for (size_t i = 0; i < surfacePoints.size(); ++i) {
+        GLfloat *point = vertices + 3 * surfacePoints[i];
+        height = std::min(height, (myModel * vec4(point[0], point[1], point[2], 1.f)).y);
+    }
+    return height;
+}
+
+// after distanceToGround in the same step
+// the lowest distinct vertices, like intersectWithGroundOfVertices: the lowest hull vertex, the hull vertices at the same
+// height connected to it and the mesh points on their faces, e.g. inside a face lying flat on the ground
+std::vector<vec3> RigidBody::intersectWithGround(bool primitives, const Ground &ground) {
+    if (!ground.isFlat()) {
+        vec3 point;
+        vec3 normal;
+        float depth = deepestPointInGround(primitives, ground, point, normal);
+        return depth < 0 ? std::vector<vec3>(1, point) : std::vector<vec3>();
+    }
+    
+    // ground at (x, 0, z)
+    float distance;
+    std::vector<vec3> lowestPoints = std::vector<vec3>();
+    if (primitives && PrimitiveCollision::lowestPoints(*this, distance, lowestPoints)) {
+        return distance < 0 ? groundContacts(lowestPoints) : std::vector<vec3>();
+    }
+    
+    if (m_shape == nullptr || !m_shape->getConvexHull().isValid()) {
+        return intersectWithGroundOfVertices();
+    }
+    const ConvexHull &hull = m_shape->getConvexHull();
+    
+    std::vector<vec3> points = std::vector<vec3>();
+    
+    mat4 myModel = model();
+    if (heightOfSurface(hull, m_groundVertex, myModel) >= 0) {
+        return points;
+    }
+    
+    // only a face lying flat on the ground has more than one lowest vertex, and they share its edges
+    float height = (myModel * vec4(hull.getVertices()[m_groundVertex], 1.f)).y;
+    std::vector<int> lowest = std::vector<int>(1, m_groundVertex);
+    for (size_t i = 0; i < lowest.size(); ++i) {
+        const std::vector<int> &neighbours = hull.getNeighbours(lowest[i]);
+        for (size_t j = 0; j < neighbours.size(); ++j) {
+            if (std::find(lowest.begin(), lowest.end(), neighbours[j]) == lowest.end() && (myModel * vec4(hull.getVertices()[neighbours[j]], 1.f)).y == height) {
+                lowest.push_back(neighbours[j]);
+            }
+        }
+    }
+    
+    // the candidates by their distinct vertex, of which the ones at the lowest height are the contacts
+    std::vector<int> candidates = std::vector<int>();
+    for (size_t i = 0; i < lowest.size(); ++i) {
+        candidates.push_back(hull.getPointIndex(lowest[i]));
+        const std::vector<int> &surfacePoints = hull.getSurfacePoints(lowest[i]);
+        candidates.insert(candidates.end(), surfacePoints.begin(), surfacePoints.end());
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    
+    GLfloat *vertices = m_shape->getMesh()->getDistinctVertices();
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        GLfloat *candidate = vertices + 3 * candidates[i];
+        vec3 point = vec3(myModel * vec4(candidate[0], candidate[1], candidate[2], 1.f));
+        if (point.y < height) {
+            height = point.y;
+            points.clear();
+        }
+        if (point.y == height) {
+            points.push_back(point);
+        }
+    }
+    
+    return groundContacts(points);
+}
+
+// the point of the body with the smallest signed distance to the ground, on the surface of a primitive or a hull vertex
+float RigidBody::deepestPointInGround(bool primitives, const Ground &ground, vec3 &point, vec3 &normal) {
+    float distance = MAXFLOAT;
+    normal = vec3(0, 1, 0);
+    point = m_position;
+    
+    mat4 myModel = model();
+    
+    // whole bodies above the surface under their box are rejected without looking at their points
+    if (m_boundingBox != nullptr) {
+        vec3 lower = vec3(MAXFLOAT, MAXFLOAT, MAXFLOAT);
+        vec3 upper = -lower;
+        for (int corner = 0; corner < 8; ++corner) {
+            vec3 offset = vec3((float)(corner & 1), (float)((corner >> 1) & 1), (float)((corner >> 2) & 1));
+            vec3 vertex = vec3(myModel * vec4(m_boundingBox->getOrigin() + offset * m_boundingBox->getRadii(), 1.f));
+            lower = min(lower, vertex);
+            upper = max(upper, vertex);
+        }
+        if (ground.isAbove(lower, upper)) {
+            return distance;
+        }
+    }
+    
+    std::vector<vec3> candidates = std::vector<vec3>();
+    float radius;
+    if (primitives && PrimitiveCollision::groundCandidates(*this, candidates, radius)) {
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            vec3 candidateNormal;
+            float candidateDistance = ground.distanceAt(candidates[i], candidateNormal) - radius;
+            if (candidateDistance < distance) {
+                distance = candidateDistance;
+                normal = candidateNormal;
+                point = candidates[i] - radius * candidateNormal;
+            }
+        }
+        return distance;
+    }
+    
+    if (m_shape != nullptr && m_shape->getConvexHull().isValid()) {
+        const ConvexHull &hull = m_shape->getConvexHull();
+        m_groundVertex = ground.lowestVertex(hull, myModel, m_groundVertex, distance, normal);
+        point = vec3(myModel * vec4(hull.getVertices()[m_groundVertex], 1.f));
+        return distance;
+    }
+    
+    GLfloat *vertices = m_mesh->getDistinctVertices();
+    for (GLuint i = 0; i < m_mesh->getNumDistinctVertices(); i += 3) {
+        vec3 vertex = vec3(myModel * vec4(vertices[i], vertices[i+1], vertices[i+2], 1.f));
+        vec3 vertexNormal;
+        float vertexDistance = ground.distanceAt(vertex, vertexNormal);
+        if (vertexDistance < distance) {
+            distance = vertexDistance;
+            normal = vertexNormal;
+            point = vertex;
+        }
+    }
+    return distance;
+}
+
 // assume ground at (x, 0, z)
 // only accurate if rigidbody is below the ground, otherwise it returns the distance of the boundingBox to the ground
-float RigidBody::distanceToGround() {
+float RigidBody::distanceToGroundOfVertices() {
     GLfloat dist = MAXFLOAT;
     GLfloat *vertices = m_boundingBox->getVertices();
     
@@ -245,7 +696,7 @@ float RigidBody::distanceToGround() {
 // assume ground at (x, 0, z)
 // returns the colliding vertices with their world coordinates
 // The first entry is the one for collision response. The others are for the friction
-std::vector<vec3> RigidBody::intersectWithGround() {
+std::vector<vec3> RigidBody::intersectWithGroundOfVertices() {
     // vec3 normal = vec3(0,1,0);
     std::vector<vec3> points = std::vector<vec3>();
     
@@ -276,6 +727,11 @@ std::vector<vec3> RigidBody::intersectWithGround() {
         }
     }
     
+    return groundContacts(points);
+}
+
+// Adds the point for the collision response in front of the lowest points
+std::vector<vec3> RigidBody::groundContacts(std::vector<vec3> points) {
     vec3 point = vec3(); //final point
     
     // get the point closest to the COM
@@ -312,10 +768,22 @@ std::vector<vec3> RigidBody::intersectWithGround() {
 }
 
 void RigidBody::update(float dt) {
+    update(dt, Parameters());
+}
+
+void RigidBody::update(float dt, const Parameters &parameters) {
+    update(dt, parameters, Ground(parameters));
+}
+
+void RigidBody::update(float dt, const Parameters &parameters, const Ground &ground) {
+    if (m_static) {
+        return;
+    }
+    
     if (!m_active) {
         // return;      // Hacked "resting contacts"
-        m_angularMomentum *= 0.7f; // new attempt for resting contacts
-        m_linearMomentum *= 0.7f;
+        m_angularMomentum *= parameters.sleepDamping; // new attempt for resting contacts
+        m_linearMomentum *= parameters.sleepDamping;
     }
     
     // Gravity
@@ -338,8 +806,8 @@ void RigidBody::update(float dt) {
     m_angularVelocity = min(max(m_inertiaTensorInv * m_angularMomentum, -1.f * maxAngularVelocity), maxAngularVelocity);    // omega(t) = I(t)^-1 * L(t)
     // m_linearVelocity = m_linearMomentum / m_mass;
     
-    float distanceGround = distanceToGround();
     vec3 normal = vec3(0, 1, 0);
+    float distanceGround = parameters.ground != 0 && parameters.contactSolver == 0 ? distanceToGround(parameters.primitiveColliders != 0, ground, normal) : MAXFLOAT;
     
     // printf("m_torque: %f %f %f\n", m_torque.x, m_torque.y, m_torque.z);
     // printf("m_angularVelocity.y: %f\n",m_angularVelocity.y);
@@ -354,10 +822,8 @@ void RigidBody::update(float dt) {
         //     printf("First contact with ground:\n\tdistance: %f\n", distanceGround);
         // }
         
-        double tBeforIntersection = glfwGetTime();
-        std::vector<vec3> collisionPoints = intersectWithGround();
-        double tAfterIntersection = glfwGetTime();
-        // printf("collisionPoints.size: %lu time used: %f\n", collisionPoints.size(), tAfterIntersection - tBeforIntersection);
+        std::vector<vec3> collisionPoints = intersectWithGround(parameters.primitiveColliders != 0, ground);
+        // printf("collisionPoints.size: %lu\n", collisionPoints.size());
         
         vec3 org_linearMomentum = m_linearMomentum;
         
@@ -375,7 +841,7 @@ void RigidBody::update(float dt) {
         
         // Colliding contact
         
-        float e = 0.3f;  // Coefficient of restitution
+        float e = parameters.restitution;  // Coefficient of restitution
         float j = -(1.f+e)*dot(vrel, normal)/(1.f/m_mass + dot(normal, cross(m_inertiaTensorInv * cross(r, normal), r)));
         j = max(0.0f, j);   // not sure... part of 'Realtime Rigid Body Simulation Using Impulses' paper
         // printf("j: %f\n", j);
@@ -385,23 +851,23 @@ void RigidBody::update(float dt) {
         addImpulse(impulse, collisionPoints[0]);
         
         for (size_t i = collisionPoints.size() == 1 ? 0 : 1; i < collisionPoints.size(); i++) {
-            if (frictionMethod == 0) {  // forced based friction model
+            if (parameters.frictionMethod == 0) {  // forced based friction model
                 r = collisionPoints[i] - m_position;
                 vrel = org_linearMomentum/m_mass + cross(m_angularVelocity, r); // http://en.wikipedia.org/wiki/Angular_velocity
 
                 // printf("bla: %f\n", abs(mat3(model()) * m_angularVelocity).y);
                 // if (abs(mat3(model()) * m_angularVelocity).y < 10)
                 // {
-                    addForce(vrel * 1.f /* (dot(m_angularMomentum, r) / length(part))*/, collisionPoints[i] - vec3(0, distanceGround, 0)); // don't know why this works.
+                    addForce(vrel * 1.f /* (dot(m_angularMomentum, r) / length(part))*/, collisionPoints[i] - distanceGround * normal); // don't know why this works.
                 // m_angularMomentum *= 0.999f;
                 // } else {
-                //    addForce(vrel * -1.f, collisionPoints[i] - vec3(0, distanceGround, 0)); // don't know why this works.
+                //    addForce(vrel * -1.f, collisionPoints[i] - distanceGround * normal); // don't know why this works.
                 // }
-            } else if (frictionMethod == 1) { // Impulse-Based Friction Model (Coulomb friction model)
+            } else if (parameters.frictionMethod == 1) { // Impulse-Based Friction Model (Coulomb friction model)
                 r = collisionPoints[i] - m_position;
                 vrel = org_linearMomentum/m_mass + cross(m_angularVelocity, r);
                 
-                float mu = 0.8; // wild guess
+                float mu = parameters.frictionCoefficient; // wild guess
                 vec3 tangent = cross(cross(normal, vrel), normal)/length(vrel);
                 
                 float jt = -(1.f+e)*dot(vrel, tangent)/(1.f/m_mass + dot(tangent, cross(m_inertiaTensorInv * cross(r, tangent), r)));
@@ -413,7 +879,7 @@ void RigidBody::update(float dt) {
                 
                 addImpulse(frictionImpulse, collisionPoints[i]);
             
-            } else if (frictionMethod == 3) { // MatLab friction
+            } else if (parameters.frictionMethod == 3) { // MatLab friction
                 int collisionPointsSize = collisionPoints.size() == 1 ? 1 : (int)collisionPoints.size() - 1;
                 r = collisionPoints[i] - m_position;
                 vrel = org_linearMomentum/m_mass + cross(m_angularVelocity, r);
@@ -421,19 +887,20 @@ void RigidBody::update(float dt) {
                 // Torque Friction from http://ch.mathworks.com/help/physmod/simscape/ref/rotationalfriction.html
                 
                 float frictionTorque; // T
-                float coulombFrictionTorque = 20; // T_C; [N*m]
-                float breakawayFrictionTorque = 25; // T_brk; [N*m];
+                float coulombFrictionTorque = parameters.coulombFrictionTorque; // T_C; [N*m]
+                float breakawayFrictionTorque = parameters.breakawayFrictionTorque; // T_brk; [N*m];
                 float omega = m_angularVelocity.x; // w
-                float velocityThreshold = 0.001; // omega_th; should be between 10^-3 and 10^-5
-                float viscousFrictionCoefficient = 0.001; // f; [N*m/(rad/s)];
-                float coefficient = 10; // c_v; [rad/s]
+                float velocityThreshold = parameters.torqueVelocityThreshold; // omega_th; should be between 10^-3 and 10^-5
+                float viscousFrictionCoefficient = parameters.viscousFrictionTorque; // f; [N*m/(rad/s)];
+                float coefficient = parameters.torqueCoefficient; // c_v; [rad/s]
+                float frictionScale = parameters.frictionScale;
                 
                 if (abs(omega) >= velocityThreshold) {
                     frictionTorque = (coulombFrictionTorque + (breakawayFrictionTorque - coulombFrictionTorque) * exp(-coefficient * abs(omega))) * sign(omega) + viscousFrictionCoefficient * omega;
                 } else {
                     frictionTorque = omega * (viscousFrictionCoefficient * velocityThreshold + (coulombFrictionTorque + (breakawayFrictionTorque - coulombFrictionTorque) * exp(-coefficient * velocityThreshold))) / velocityThreshold;
                 }
-                m_torque += 0.1f * vec3(-frictionTorque / collisionPointsSize,0,0);
+                m_torque += frictionScale * vec3(-frictionTorque / collisionPointsSize,0,0);
                 
                 omega = m_angularVelocity.y;
                 
@@ -442,7 +909,7 @@ void RigidBody::update(float dt) {
                 } else {
                     frictionTorque = omega * (viscousFrictionCoefficient * velocityThreshold + (coulombFrictionTorque + (breakawayFrictionTorque - coulombFrictionTorque) * exp(-coefficient * velocityThreshold))) / velocityThreshold;
                 }
-                m_torque += 0.1f * vec3(0,-frictionTorque / collisionPointsSize,0);
+                m_torque += frictionScale * vec3(0,-frictionTorque / collisionPointsSize,0);
                 
                 omega = m_angularVelocity.z;
                 
@@ -451,17 +918,17 @@ void RigidBody::update(float dt) {
                 } else {
                     frictionTorque = omega * (viscousFrictionCoefficient * velocityThreshold + (coulombFrictionTorque + (breakawayFrictionTorque - coulombFrictionTorque) * exp(-coefficient * velocityThreshold))) / velocityThreshold;
                 }
-                m_torque += 0.1f * vec3(0,0,-frictionTorque / collisionPointsSize);
+                m_torque += frictionScale * vec3(0,0,-frictionTorque / collisionPointsSize);
                 
                 // Linear Friction from http://ch.mathworks.com/help/physmod/simscape/ref/translationalfriction.html
                 // x component
                 float frictionForce; // F
-                float coulombFrictionForce = 20; // F_C; [N]
-                float breakawayFrictionForce = 25; // F_brk; [N];
+                float coulombFrictionForce = parameters.coulombFrictionForce; // F_C; [N]
+                float breakawayFrictionForce = parameters.breakawayFrictionForce; // F_brk; [N];
                 float v = vrel.x; //m_linearMomentum.x / m_mass; // v
-                velocityThreshold = 0.0001; // omega_th; should be between 10^-4 and 10^-6
-                viscousFrictionCoefficient = 10; // f; [N/(m//s)]; default = 100;
-                coefficient = 10; // c_v; [s/m]
+                velocityThreshold = parameters.forceVelocityThreshold; // omega_th; should be between 10^-4 and 10^-6
+                viscousFrictionCoefficient = parameters.viscousFrictionForce; // f; [N/(m//s)]; default = 100;
+                coefficient = parameters.forceCoefficient; // c_v; [s/m]
                 
                 if (abs(v) >= velocityThreshold) {
                     frictionForce = (coulombFrictionForce + (breakawayFrictionForce - coulombFrictionForce) * exp(-coefficient * abs(v))) * sign(v) + viscousFrictionCoefficient * v;
@@ -469,7 +936,7 @@ void RigidBody::update(float dt) {
                     frictionForce = v * (viscousFrictionCoefficient * velocityThreshold + (coulombFrictionForce + (breakawayFrictionForce - coulombFrictionForce) * exp(-coefficient * velocityThreshold))) / velocityThreshold;
                 }
                 
-                addForce(0.1f * vec3(-frictionForce / collisionPointsSize,0,0), collisionPoints[i] - vec3(0, distanceGround, 0));
+                addForce(frictionScale * vec3(-frictionForce / collisionPointsSize,0,0), collisionPoints[i] - distanceGround * normal);
                 
                 // y component
                 v = vrel.y; // m_linearMomentum.z / m_mass; // v
@@ -479,7 +946,7 @@ void RigidBody::update(float dt) {
                     frictionForce = v * (viscousFrictionCoefficient * velocityThreshold + (coulombFrictionForce + (breakawayFrictionForce - coulombFrictionForce) * exp(-coefficient * velocityThreshold))) / velocityThreshold;
                 }
                 
-                addForce(0.1f * vec3(0,-frictionForce / collisionPointsSize, 0), collisionPoints[i] - vec3(0, distanceGround, 0));
+                addForce(frictionScale * vec3(0,-frictionForce / collisionPointsSize, 0), collisionPoints[i] - distanceGround * normal);
                 
                 // z component
                 v = vrel.z; // m_linearMomentum.z / m_mass; // v
@@ -489,29 +956,15 @@ void RigidBody::update(float dt) {
                     frictionForce = v * (viscousFrictionCoefficient * velocityThreshold + (coulombFrictionForce + (breakawayFrictionForce - coulombFrictionForce) * exp(-coefficient * velocityThreshold))) / velocityThreshold;
                 }
                 
-                addForce(0.1f * vec3(0,0,-frictionForce / collisionPointsSize), collisionPoints[i] - vec3(0, distanceGround, 0));
+                addForce(frictionScale * vec3(0,0,-frictionForce / collisionPointsSize), collisionPoints[i] - distanceGround * normal);
                 
             }
         }
         
         // avoid overshooting and undershooting
-        m_position.y -= distanceGround;
+        m_position -= distanceGround * normal;
         
-        float vel = length(m_linearMomentum/m_mass) + length(m_angularVelocity);
-        m_lastVelocities.push_back(vel);
-        if (m_lastVelocities.size() > 10) {
-            auto start = m_lastVelocities.end() - 10;
-            auto end = m_lastVelocities.end();
-            
-            m_lastVelocities = std::vector<float>(start, end);
-        }
-        float average = std::accumulate(m_lastVelocities.begin(), m_lastVelocities.end(), 0.0);
-        average /= m_lastVelocities.size();
-        // printf("vel: %f\n", average);
-        
-        if (average < 0.6) m_active = false;
-        
-        // if (length(m_linearMomentum) < 0.15 && length(m_angularMomentum) < 0.15) m_active = false;
+        restIfSlow(parameters);
     }
     
     // Fake slowing down
@@ -521,6 +974,52 @@ void RigidBody::update(float dt) {
     // printState();
 }
 
+std::vector<Contact> RigidBody::contactsWithGround(const Parameters &parameters, const Ground &ground) {
+    std::vector<Contact> contacts = std::vector<Contact>();
+    if (m_static || parameters.ground == 0) {
+        return contacts;
+    }
+    
+    vec3 normal = vec3(0, 1, 0);
+    float distanceGround = distanceToGround(parameters.primitiveColliders != 0, ground, normal);
+    if (distanceGround >= 0) {
+        return contacts;
+    }
+    
+    // the points themselves, without the one below the center of mass which groundContacts puts in front
+    std::vector<vec3> collisionPoints = intersectWithGround(parameters.primitiveColliders != 0, ground);
+    for (size_t i = collisionPoints.size() == 1 ? 0 : 1; i < collisionPoints.size(); ++i) {
+        Contact contact;
+        contact.p = collisionPoints[i] - distanceGround * normal;
+        contact.n = normal;
+        contacts.push_back(contact);
+    }
+    
+    // avoid overshooting and undershooting, the points above are already on the surface
+    m_position -= distanceGround * normal;
+    
+    restIfSlow(parameters);
+    return contacts;
+}
+
+void RigidBody::restIfSlow(const Parameters &parameters) {
+    float vel = length(m_linearMomentum/m_mass) + length(m_angularVelocity);
+    m_lastVelocities.push_back(vel);
+    if (m_lastVelocities.size() > 10) {
+        auto start = m_lastVelocities.end() - 10;
+        auto end = m_lastVelocities.end();
+        
+        m_lastVelocities = std::vector<float>(start, end);
+    }
+    float average = std::accumulate(m_lastVelocities.begin(), m_lastVelocities.end(), 0.0);
+    average /= m_lastVelocities.size();
+    // printf("vel: %f\n", average);
+    
+    if (average < parameters.sleepVelocity) m_active = false;
+    
+    // if (length(m_linearMomentum) < 0.15 && length(m_angularMomentum) < 0.15) m_active = false;
+}
+
 void RigidBody::renderOctree() {
     if (octreeMeshes->size() == 0) {
         Material *pointMaterial = new Material(vec3(1,0,0));
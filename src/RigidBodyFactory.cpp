@@ -16,6 +16,7 @@ void resetSphere(RigidBody &rb) {
     rb.setBodyInertiaTensorInv(glm::diagonal3x3(glm::vec3(2.5, 2.5, 2.5)));
     
     rb.setMesh(Assets::getSphere());
+    rb.setPrimitive(Primitive::sphere(1));
     
     rb.type = 0;
 }
@@ -25,6 +26,7 @@ void resetCube(RigidBody &rb) {
     rb.setBodyInertiaTensorInv(glm::diagonal3x3(glm::vec3(1.5, 1.5, 1.5)));
     
     rb.setMesh(Assets::getCube());
+    rb.setPrimitive(Primitive::box(glm::vec3(1, 1, 1)));
     
     rb.type = 9;
 }
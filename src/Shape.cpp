@@ -0,0 +1,146 @@
+#include "Shape.h"
+
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace {
+    const float convexTolerance = 0.01f;
+    const int defaultDistanceFieldResolution = 32;
+
+    std::mutex mutex;
+    std::map<std::pair<Mesh *, OOBB::SplitMethod>, Shape *> shapes;
+    std::map<Mesh *, OOBB::SplitMethod> splitMethods;
+    OOBB::SplitMethod defaultSplitMethod = OOBB::OCTREE;
+    std::map<Mesh *, int> distanceFieldResolutions;
+
+    bool isConvexWithin(Mesh *mesh, const std::vector<glm::vec3> &points, const ConvexHull &hull, float tolerance) {
+        if (!hull.isValid()) {
+            return false;
+        }
+
+        glm::vec3 lower = hull.getVertices()[0];
+        glm::vec3 upper = hull.getVertices()[0];
+        for (size_t i = 1; i < hull.getVertices().size(); ++i) {
+            lower = glm::min(lower, hull.getVertices()[i]);
+            upper = glm::max(upper, hull.getVertices()[i]);
+        }
+        float size = glm::length(upper - lower);
+
+        // dents: vertices inside of the hull
+        for (size_t i = 0; i < points.size(); ++i) {
+            if (hull.depthOf(points[i]) > tolerance * size) {
+                return false;
+            }
+        }
+
+        // cavities without vertices inside, e.g. a folded face
+        GLfloat *vertices = mesh->getVertices();
+        float volume = 0;
+        for (GLuint i = 0; i + 8 < mesh->getNumVertices(); i += 9) {
+            glm::vec3 vertex1 = glm::vec3(vertices[i+0], vertices[i+1], vertices[i+2]);
+            glm::vec3 vertex2 = glm::vec3(vertices[i+3], vertices[i+4], vertices[i+5]);
+            glm::vec3 vertex3 = glm::vec3(vertices[i+6], vertices[i+7], vertices[i+8]);
+            volume += glm::dot(vertex1, glm::cross(vertex2, vertex3)) / 6.f;
+        }
+
+        return std::abs(volume) >= (1.f - tolerance) * hull.getVolume();
+    }
+}
+
+Shape::Shape(Mesh *mesh, OOBB::SplitMethod splitMethod) {
+    m_mesh = mesh;
+    m_splitMethod = splitMethod;
+    m_boundingBox = new OOBB(mesh, splitMethod);
+
+    std::vector<glm::vec3> points = std::vector<glm::vec3>();
+    GLfloat *vertices = mesh->getDistinctVertices();
+    for (GLuint i = 0; i + 2 < mesh->getNumDistinctVertices(); i += 3) {
+        points.push_back(glm::vec3(vertices[i], vertices[i+1], vertices[i+2]));
+    }
+
+    m_convexHull = ConvexHull(points);
+    m_convex = isConvexWithin(mesh, points, m_convexHull, convexTolerance);
+}
+
+Mesh *Shape::getMesh() const {
+    return m_mesh;
+}
+
+OOBB *Shape::getBoundingBox() const {
+    return m_boundingBox;
+}
+
+OOBB::SplitMethod Shape::getSplitMethod() const {
+    return m_splitMethod;
+}
+
+const ConvexHull &Shape::getConvexHull() const {
+    return m_convexHull;
+}
+
+bool Shape::isConvex() const {
+    return m_convex;
+}
+
+const DistanceField &Shape::getDistanceField() const {
+    std::call_once(m_distanceFieldBuilt, [this]() {
+        m_distanceField = DistanceField(m_mesh, m_boundingBox, getDistanceFieldResolutionOf(m_mesh));
+    });
+    return m_distanceField;
+}
+
+Shape *Shape::get(Mesh *mesh) {
+    return get(mesh, getSplitMethodOf(mesh));
+}
+
+Shape *Shape::get(Mesh *mesh, OOBB::SplitMethod splitMethod) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::pair<Mesh *, OOBB::SplitMethod> key = std::make_pair(mesh, splitMethod);
+    std::map<std::pair<Mesh *, OOBB::SplitMethod>, Shape *>::iterator it = shapes.find(key);
+    if (it != shapes.end()) {
+        return it->second;
+    }
+
+    Shape *shape = new Shape(mesh, splitMethod);
+    shapes[key] = shape;
+    return shape;
+}
+
+void Shape::setSplitMethod(Mesh *mesh, OOBB::SplitMethod splitMethod) {
+    std::lock_guard<std::mutex> lock(mutex);
+    splitMethods[mesh] = splitMethod;
+}
+
+void Shape::setDefaultSplitMethod(OOBB::SplitMethod splitMethod) {
+    std::lock_guard<std::mutex> lock(mutex);
+    defaultSplitMethod = splitMethod;
+}
+
+OOBB::SplitMethod Shape::getSplitMethodOf(Mesh *mesh) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::map<Mesh *, OOBB::SplitMethod>::iterator it = splitMethods.find(mesh);
+    if (it != splitMethods.end()) {
+        return it->second;
+    }
+    return defaultSplitMethod;
+}
+
+void Shape::setDistanceFieldResolution(Mesh *mesh, int resolution) {
+    std::lock_guard<std::mutex> lock(mutex);
+    distanceFieldResolutions[mesh] = resolution;
+}
+
+int Shape::getDistanceFieldResolutionOf(Mesh *mesh) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::map<Mesh *, int>::iterator it = distanceFieldResolutions.find(mesh);
+    if (it != distanceFieldResolutions.end()) {
+        return it->second;
+    }
+    return defaultDistanceFieldResolution;
+}
@@ -1,82 +1,587 @@
 #include "Simulation.h"
 
 #include "Collision.h"
+#include "ContinuousCollision.h"
+#include "StateHash.h"
+
+#include <algorithm>
+#include <cmath>
 
 using namespace std;
 
-const int MAX_SIMULATION_SAVE_STATES = 1000;
+const int MAX_NUMBER_OF_SUBSTEPS = 16;
+
+namespace {
+    // lexicographic order of point and normal
+    bool contactLess(const Contact &a, const Contact &b) {
+        for (int i = 0; i < 3; ++i) {
+            if (a.p[i] != b.p[i]) {
+                return a.p[i] < b.p[i];
+            }
+        }
+        for (int i = 0; i < 3; ++i) {
+            if (a.n[i] != b.n[i]) {
+                return a.n[i] < b.n[i];
+            }
+        }
+        return false;
+    }
+    
+    // Everything a ray needs of a body, computed once per body
+    struct RaycastBody {
+        OOBB *hierarchy;
+        glm::vec3 center;               // bounding sphere in world space
+        float radius;
+        glm::mat4 worldToBody;
+        glm::mat3 normalToWorld;
+    };
+    
+    bool prepareRaycast(RigidBody &body, RaycastBody &prepared) {
+        prepared.hierarchy = body.getBoundingBox();
+        if (prepared.hierarchy == nullptr) {
+            return false;
+        }
+        
+        glm::mat4 model = body.model();
+        glm::vec3 scale = body.getScale();
+        glm::vec3 radii = prepared.hierarchy->getRadii();
+        prepared.center = glm::vec3(model * glm::vec4(prepared.hierarchy->getOrigin() + 0.5f * radii, 1.f));
+        prepared.radius = 0.5f * glm::length(radii) * std::max(std::max(std::abs(scale.x), std::abs(scale.y)), std::abs(scale.z));
+        prepared.worldToBody = glm::inverse(model);
+        prepared.normalToWorld = glm::transpose(glm::mat3(prepared.worldToBody));
+        return true;
+    }
+    
+    // the affine transformation keeps the distances along the ray in units of its direction
+    void raycastBody(const RaycastBody &body, const Ray &ray, int index, bool isStatic, RayHit &hit) {
+        float maxDistance = hit.hit ? hit.distance : ray.maxDistance;
+        
+        // broad phase: the distance at which the ray enters the bounding sphere
+        glm::vec3 toCenter = body.center - ray.origin;
+        float lengthSquared = glm::dot(ray.direction, ray.direction);
+        float closest = glm::dot(toCenter, ray.direction) / lengthSquared;
+        float missSquared = glm::dot(toCenter, toCenter) - closest * closest * lengthSquared;
+        if (missSquared > body.radius * body.radius) {
+            return;
+        }
+        float halfChord = std::sqrt((body.radius * body.radius - missSquared) / lengthSquared);
+        if (closest - halfChord >= maxDistance || closest + halfChord < 0) {
+            return;
+        }
+        
+        glm::vec3 origin = glm::vec3(body.worldToBody * glm::vec4(ray.origin, 1.f));
+        glm::vec3 direction = glm::mat3(body.worldToBody) * ray.direction;
+        float distance = maxDistance;
+        int triangle;
+        glm::vec3 normal;
+        if (!body.hierarchy->intersectRay(origin, direction, distance, triangle, normal)) {
+            return;
+        }
+        
+        hit.hit = true;
+        hit.distance = distance;
+        hit.point = ray.origin + distance * ray.direction;
+        hit.normal = glm::normalize(body.normalToWorld * normal);
+        hit.body = index;
+        hit.isStatic = isStatic;
+        hit.triangle = triangle;
+    }
+}
 
 Simulation::Simulation() {
+    m_ground.setStatic(true);
+    m_heightfield = nullptr;
+    m_deterministic = false;
+    m_recordStateHashes = false;
     reset();
 }
 
 void Simulation::reset() {
     m_activeRigidBody = -1;
-    vector<RigidBody> state = vector<RigidBody>();
-    m_simulationStates = vector<vector<RigidBody> >();
-    m_simulationStates.push_back(state);
+    m_currentState = vector<RigidBody>();
+    m_lastState = vector<RigidBody>();
+    m_hasLastState = false;
+    m_history.clear();
+    m_currentStep = 0;
+    m_time = 0;
+    m_structureChanged = false;
+    m_stateHashes.clear();
+    m_staticBodies = vector<RigidBody>();
+    m_bodyPairs.clear();
+    m_groundPairs.clear();
+    m_staticPairs.clear();
+    m_keyframePairs.clear();
+    m_replayPairs = false;
+    m_ignoredPairs.clear();
+    m_numberOfSubsteps = 0;
 }
 
 vector<RigidBody> *Simulation::getCurrentState() {
-    vector<RigidBody> *state = &m_simulationStates.back();
-    return state;
+    return &m_currentState;
 }
 
 vector<RigidBody> *Simulation::getLastState() {
-    if (m_simulationStates.size() < 2) {
+    if (!m_hasLastState) {
         return nullptr;
     } else {
-        return &m_simulationStates.at(m_simulationStates.size() - 2);
+        return &m_lastState;
     }
 }
 
 size_t Simulation::getNumberOfStates() {
-    return m_simulationStates.size();
+    return std::max((size_t)1, m_history.getNumberOfSteps());
+}
+
+void Simulation::setMaxNumberOfStates(size_t maxNumberOfStates) {
+    m_history.setMaxNumberOfSteps(maxNumberOfStates);
+}
+
+void Simulation::setKeyframeInterval(size_t keyframeInterval) {
+    m_history.setKeyframeInterval(keyframeInterval);
+}
+
+Parameters *Simulation::getParameters() {
+    return &m_parameters;
+}
+
+void Simulation::setParameters(const Parameters &parameters) {
+    m_parameters = parameters;
+}
+
+void Simulation::setHeightfield(const Heightfield *heightfield) {
+    m_heightfield = heightfield;
+}
+
+const Heightfield *Simulation::getHeightfield() {
+    return m_heightfield;
+}
+
+void Simulation::setDeterministic(bool deterministic) {
+    m_deterministic = deterministic;
+}
+
+bool Simulation::isDeterministic() {
+    return m_deterministic;
+}
+
+void Simulation::setSolverPool(ThreadPool *pool) {
+    m_contactSolver.setPool(pool);
+}
+
+void Simulation::setRecordStateHashes(bool recordStateHashes) {
+    m_recordStateHashes = recordStateHashes;
+    if (!recordStateHashes) {
+        m_stateHashes.clear();
+    }
+}
+
+const std::vector<uint64_t> &Simulation::getStateHashes() {
+    return m_stateHashes;
+}
+
+bool Simulation::writeStateHashes(const std::string &filename) {
+    return StateHash::write(filename, m_stateHashes);
 }
 
 void Simulation::forwardStep(float dt) {
     m_debugPoints.clear();
     
-    vector<RigidBody> newState = m_simulationStates.back();
+    // continue from a seek: the pairs have to catch up, the old future is no longer valid
+    if (m_replayPairs && !m_structureChanged) {
+        replayPairs();
+    }
+    m_replayPairs = false;
+    if (!m_history.isEmpty() && m_currentStep < m_history.getLastStep()) {
+        m_history.erase(m_currentStep + 1);
+        m_keyframePairs.erase(m_keyframePairs.upper_bound(m_currentStep), m_keyframePairs.end());
+    }
+    if (m_stateHashes.size() > m_currentStep) {
+        m_stateHashes.resize(m_currentStep);
+    }
+    
+    // the recorded current step does not contain the added or removed bodies yet
+    if (m_structureChanged || m_history.isEmpty()) {
+        m_history.erase(m_currentStep);
+        m_keyframePairs.erase(m_keyframePairs.lower_bound(m_currentStep), m_keyframePairs.end());
+        recordPairs(m_currentStep, m_history.record(m_currentState, m_time, true));
+        m_structureChanged = false;
+    }
+    
+    m_lastState = m_currentState;
+    m_hasLastState = true;
+    
+    step(dt);
+    
+    m_currentStep++;
+    m_time += dt;
+    
+    if (m_recordStateHashes) {
+        m_stateHashes.push_back(StateHash::hash(m_currentState));
+    }
+    recordPairs(m_currentStep, m_history.record(m_currentState, m_time, false));
+}
+
+void Simulation::step(float dt) {
+    vector<RigidBody> &newState = m_currentState;
+
+    // with continuous collisions, bodies which could hit something within the step move in substeps
+    std::vector<bool> substepped = std::vector<bool>(newState.size(), false);
+    if (m_parameters.continuousCollisions != 0) {
+        std::vector<float> times = timesToPenetration(std::vector<bool>(newState.size(), true), dt);
+        for (size_t i = 0; i < newState.size(); ++i) {
+            substepped[i] = times[i] < dt;
+        }
+    }
 
     // update rigidbodies
+    Ground ground = Ground(m_parameters, m_heightfield);
+    for (size_t i = 0; i < newState.size(); i++) {
+        if (!substepped[i]) {
+            newState[i].update(dt, m_parameters, ground);
+        }
+    }
+    
+    updateInSubsteps(substepped, dt);
+    
     for (size_t i = 0; i < newState.size(); i++) {
-        newState[i].update(dt);
-
         showDebugPoint(newState[i].getPosition());
     }
 
-    // collision detection and response
+    // collision detection and response, pairs of substepped bodies had theirs after every substep
     for (size_t i = 0; i < newState.size(); ++i) {
         for (size_t j = i+1; j < newState.size(); ++j) {
-            
-            std::vector<Contact> contacts = newState[i].intersectWith(newState[j]);
-            if (contacts.size() > 0) {
-                // printf("collisionPoints: %lu\n", contacts.size());
-                Collision::collisionResponseBetween(newState[j], newState[i], contacts);
+            if ((!substepped[i] || !substepped[j]) && canCollide(i, j)) {
+                collide(i, j);
             }
         }
+        if (!substepped[i]) {
+            collideWithStaticBodies(i);
+            collideWithGround(i, ground);
+        }
+    }
+    solveContacts();
+}
+
+void Simulation::recordPairs(size_t step, bool keyframe) {
+    if (keyframe) {
+        KeyframePairs &pairs = m_keyframePairs[step];
+        pairs.bodyPairs = m_bodyPairs;
+        pairs.staticPairs = m_staticPairs;
+        pairs.groundPairs = m_groundPairs;
     }
     
-    m_simulationStates.push_back(newState);
+    size_t firstKeyframe = m_history.getKeyframeStep(m_history.getFirstStep());
+    m_keyframePairs.erase(m_keyframePairs.begin(), m_keyframePairs.lower_bound(firstKeyframe));
+}
+
+void Simulation::replayPairs() {
+    size_t keyframe = m_history.getKeyframeStep(m_currentStep);
+    std::map<size_t, KeyframePairs>::const_iterator pairs = m_keyframePairs.find(keyframe);
+    if (pairs == m_keyframePairs.end()) {
+        return;
+    }
+    
+    // the bodies of the current step are kept as recorded, only the pairs are taken from the replay
+    std::vector<RigidBody> currentState = m_currentState;
+    size_t numberOfSubsteps = m_numberOfSubsteps;
+    
+    m_history.restore(keyframe, m_currentState);
+    m_bodyPairs = pairs->second.bodyPairs;
+    m_staticPairs = pairs->second.staticPairs;
+    m_groundPairs = pairs->second.groundPairs;
+    
+    for (size_t s = keyframe; s < m_currentStep; ++s) {
+        step((float)(m_history.getTime(s + 1) - m_history.getTime(s)));
+    }
     
-    if (m_simulationStates.size() > MAX_SIMULATION_SAVE_STATES) {
-        m_simulationStates.erase(m_simulationStates.begin());
+    m_currentState = currentState;
+    m_numberOfSubsteps = numberOfSubsteps;
+    m_debugPoints.clear();
+}
+
+void Simulation::collide(size_t i, size_t j) {
+    collide(m_currentState[i], m_currentState[j], m_bodyPairs[std::make_pair(i, j)]);
+}
+
+void Simulation::collideWithStaticBodies(size_t i) {
+    for (size_t k = 0; k < m_staticBodies.size(); ++k) {
+        if (m_currentState[i].collidesWith(m_staticBodies[k])) {
+            collide(m_currentState[i], m_staticBodies[k], m_staticPairs[std::make_pair(i, k)]);
+        }
+    }
+}
+
+void Simulation::collideWithGround(size_t i, const Ground &ground) {
+    if (m_parameters.contactSolver == 0) {
+        return;
+    }
+    
+    // the ground is a static body at the origin, so the manifold keeps the points in world space
+    BodyPair &pair = m_groundPairs[i];
+    std::vector<Contact> contacts = m_currentState[i].contactsWithGround(m_parameters, ground);
+    if (contacts.size() > 0) {
+        if (m_parameters.contactManifold != 0) {
+            pair.manifold.update(contacts, m_ground, m_currentState[i]);
+            contacts = pair.manifold.getContacts();
+        }
+        m_contactSolver.add(m_currentState[i], m_ground, contacts, m_parameters.contactManifold != 0 ? &pair.manifold : nullptr, m_parameters);
+    } else {
+        pair.manifold.clear();
+    }
+}
+
+void Simulation::setCollisionFilter(size_t body, uint32_t layer, uint32_t mask) {
+    if (body >= m_currentState.size()) {
+        return;
+    }
+    m_currentState[body].setCollisionLayer(layer);
+    m_currentState[body].setCollisionMask(mask);
+    forgetPairsOf(body);
+    // the filter is not part of the per step states, the next step records a keyframe
+    m_structureChanged = true;
+}
+
+void Simulation::setPairIgnored(size_t one, size_t two, bool ignored) {
+    if (one == two) {
+        return;
+    }
+    std::pair<size_t, size_t> pair = std::make_pair(std::min(one, two), std::max(one, two));
+    if (ignored) {
+        m_ignoredPairs.insert(pair);
+        m_bodyPairs.erase(pair);
+    } else {
+        m_ignoredPairs.erase(pair);
+    }
+}
+
+void Simulation::clearIgnoredPairs() {
+    m_ignoredPairs.clear();
+}
+
+bool Simulation::canCollide(size_t one, size_t two) {
+    if (!m_currentState[one].collidesWith(m_currentState[two])) {
+        return false;
+    }
+    return m_ignoredPairs.empty() || m_ignoredPairs.count(std::make_pair(std::min(one, two), std::max(one, two))) == 0;
+}
+
+void Simulation::forgetPairsOf(size_t body) {
+    for (auto it = m_bodyPairs.begin(); it != m_bodyPairs.end();) {
+        if (it->first.first == body || it->first.second == body) {
+            it = m_bodyPairs.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (auto it = m_staticPairs.begin(); it != m_staticPairs.end();) {
+        if (it->first.first == body) {
+            it = m_staticPairs.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void Simulation::removeIgnoredPairsOf(size_t body) {
+    std::set<std::pair<size_t, size_t> > ignoredPairs;
+    for (const std::pair<size_t, size_t> &pair : m_ignoredPairs) {
+        if (pair.first != body && pair.second != body) {
+            ignoredPairs.insert(std::make_pair(pair.first > body ? pair.first - 1 : pair.first, pair.second > body ? pair.second - 1 : pair.second));
+        }
+    }
+    m_ignoredPairs = ignoredPairs;
+}
+
+void Simulation::collide(RigidBody &one, RigidBody &two, BodyPair &pair) {
+    PairCache *cache = nullptr;
+    if (m_parameters.coherenceMargin > 0) {
+        cache = &pair.cache;
+        cache->margin = m_parameters.coherenceMargin;
+    }
+    
+    std::vector<Contact> contacts;
+    if (m_parameters.primitiveColliders != 0 && PrimitiveCollision::intersect(one, two, contacts)) {
+        // closed form for the pair of primitives
+    } else if (m_parameters.distanceFieldContacts != 0) {
+        contacts = one.intersectDistanceFields(two);
+    } else {
+        contacts = one.intersectWith(two, m_parameters.convexContacts != 0, cache);
+    }
+    if (contacts.size() > 0) {
+        if (m_deterministic) {
+            std::sort(contacts.begin(), contacts.end(), contactLess);
+        }
+        if (m_parameters.contactManifold != 0) {
+            pair.manifold.update(contacts, one, two);
+            contacts = pair.manifold.getContacts();
+        }
+        // printf("collisionPoints: %lu\n", contacts.size());
+        if (m_parameters.contactSolver != 0) {
+            m_contactSolver.add(two, one, contacts, m_parameters.contactManifold != 0 ? &pair.manifold : nullptr, m_parameters);
+        } else {
+            float impulse = Collision::collisionResponseBetween(two, one, contacts, m_parameters);
+            pair.manifold.setNormalImpulse(impulse);
+        }
+    } else {
+        pair.manifold.clear();
+    }
+}
+
+void Simulation::solveContacts() {
+    if (m_contactSolver.getNumberOfContacts() > 0) {
+        m_contactSolver.solve(m_parameters);
+    } else {
+        // the bodies of contacts which were all separating, their velocities would be stale in the next step
+        m_contactSolver.clear();
+    }
+}
+
+std::vector<float> Simulation::timesToPenetration(const std::vector<bool> &included, float maxTime) {
+    std::vector<float> times = std::vector<float>(m_currentState.size(), maxTime);
+    
+    std::vector<ContinuousCollision::Motion> motions = std::vector<ContinuousCollision::Motion>();
+    for (size_t i = 0; i < m_currentState.size(); ++i) {
+        motions.push_back(ContinuousCollision::Motion(m_currentState[i]));
+    }
+    
+    std::vector<ContinuousCollision::Motion> staticMotions = std::vector<ContinuousCollision::Motion>();
+    for (size_t k = 0; k < m_staticBodies.size(); ++k) {
+        staticMotions.push_back(ContinuousCollision::Motion(m_staticBodies[k]));
+    }
+    
+    Ground ground = Ground(m_parameters, m_heightfield);
+    for (size_t i = 0; i < m_currentState.size(); ++i) {
+        if (!included[i]) {
+            continue;
+        }
+        
+        if (m_parameters.ground != 0) {
+            times[i] = std::min(times[i], ContinuousCollision::timeToGroundPenetration(motions[i], ground, maxTime, m_parameters.maxPenetration));
+        }
+        
+        for (size_t k = 0; k < staticMotions.size(); ++k) {
+            if (m_currentState[i].collidesWith(m_staticBodies[k])) {
+                times[i] = std::min(times[i], ContinuousCollision::timeToPenetration(motions[i], staticMotions[k], maxTime, m_parameters.maxPenetration));
+            }
+        }
+        
+        for (size_t j = i+1; j < m_currentState.size(); ++j) {
+            if (included[j] && canCollide(i, j)) {
+                float time = ContinuousCollision::timeToPenetration(motions[i], motions[j], maxTime, m_parameters.maxPenetration);
+                times[i] = std::min(times[i], time);
+                times[j] = std::min(times[j], time);
+            }
+        }
+    }
+    
+    return times;
+}
+
+void Simulation::updateInSubsteps(const std::vector<bool> &substepped, float dt) {
+    if (std::find(substepped.begin(), substepped.end(), true) == substepped.end()) {
+        return;
+    }
+    
+    // every substep ends before one of the bodies gets deeper than maxPenetration into another or the ground, but
+    // is not shorter than dt / MAX_NUMBER_OF_SUBSTEPS
+    Ground ground = Ground(m_parameters, m_heightfield);
+    float remaining = dt;
+    for (int substep = 0; remaining > 0; ++substep) {
+        float h = remaining;
+        if (substep < MAX_NUMBER_OF_SUBSTEPS - 1) {
+            std::vector<float> times = timesToPenetration(substepped, remaining);
+            for (size_t i = 0; i < substepped.size(); ++i) {
+                h = std::min(h, times[i]);
+            }
+            h = std::max(h, std::min(dt / MAX_NUMBER_OF_SUBSTEPS, remaining));
+        }
+        
+        for (size_t i = 0; i < m_currentState.size(); ++i) {
+            if (substepped[i]) {
+                m_currentState[i].update(h, m_parameters, ground);
+            }
+        }
+        
+        for (size_t i = 0; i < m_currentState.size(); ++i) {
+            for (size_t j = i+1; j < m_currentState.size(); ++j) {
+                if (substepped[i] && substepped[j] && canCollide(i, j)) {
+                    collide(i, j);
+                }
+            }
+            if (substepped[i]) {
+                collideWithStaticBodies(i);
+                collideWithGround(i, ground);
+            }
+        }
+        solveContacts();
+        
+        m_numberOfSubsteps++;
+        remaining = h < remaining ? remaining - h : 0;
     }
 }
 
 void Simulation::backwardStep() {
+    if (m_currentStep > m_history.getFirstStep()) {
+        seekStep(m_currentStep - 1);
+    }
+}
+
+double Simulation::getTime() {
+    return m_time;
+}
+
+size_t Simulation::getCurrentStep() {
+    return m_currentStep;
+}
+
+size_t Simulation::getNumberOfSubsteps() {
+    return m_numberOfSubsteps;
+}
+
+double Simulation::getFirstTime() {
+    return m_history.getTime(m_history.getFirstStep());
+}
+
+double Simulation::getLastTime() {
+    return m_history.isEmpty() ? m_time : m_history.getTime(m_history.getLastStep());
+}
+
+bool Simulation::seek(double time) {
+    if (m_history.isEmpty()) {
+        return false;
+    }
+    return seekStep(m_history.findStep(time));
+}
+
+bool Simulation::seekStep(size_t step) {
+    if (!m_history.restore(step, m_currentState)) {
+        return false;
+    }
+    
     m_debugPoints.clear();
     
-    if (m_simulationStates.size() > 1) {
-        m_simulationStates.pop_back();
-    }
+    m_hasLastState = step > m_history.getFirstStep() && m_history.restore(step - 1, m_lastState);
+    
+    m_currentStep = step;
+    m_time = m_history.getTime(step);
+    m_structureChanged = false;
+    m_bodyPairs.clear();
+    m_groundPairs.clear();
+    m_staticPairs.clear();
+    m_replayPairs = true;
     
-    vector<RigidBody> *state = &m_simulationStates.back();
+    updateActiveRigidBody();
+    return true;
+}
+
+void Simulation::updateActiveRigidBody() {
     m_activeRigidBody = -1;
-    for (size_t i = 0; i < state->size(); i++) {
-        if (state->at(i).isCurrentlyActive) {
+    for (size_t i = 0; i < m_currentState.size(); i++) {
+        if (m_currentState[i].isCurrentlyActive) {
             m_activeRigidBody = i;
+            m_currentState[i].setMaterial(Assets::getSlightlyGreenMaterial());
+        } else {
+            m_currentState[i].setMaterial(Assets::getWhiteMaterial());
         }
     }
 }
@@ -85,7 +590,7 @@ RigidBody *Simulation::getActiveRigidBody() {
     if (m_activeRigidBody == -1) {
         return nullptr;
     } else {
-        vector<RigidBody> *state = &m_simulationStates.back();
+        vector<RigidBody> *state = &m_currentState;
         return &state->at(m_activeRigidBody);
     }
 }
@@ -97,8 +602,13 @@ void Simulation::removeActiveRigidBody() {
     getActiveRigidBody()->isCurrentlyActive = false;
     getActiveRigidBody()->setMaterial(Assets::getWhiteMaterial());
     
-    vector<RigidBody> *state = &m_simulationStates.back();
+    vector<RigidBody> *state = &m_currentState;
     state->erase(state->begin() + m_activeRigidBody);
+    removeIgnoredPairsOf(m_activeRigidBody);
+    m_structureChanged = true;
+    m_bodyPairs.clear();
+    m_groundPairs.clear();
+    m_staticPairs.clear();
     m_activeRigidBody++;
 
     if (m_activeRigidBody > (int)state->size() - 1) {
@@ -118,13 +628,50 @@ void Simulation::removeActiveRigidBody() {
 }
 
 void Simulation::removeAllRigidBodies() {
-    vector<RigidBody> *state = &m_simulationStates.back();
+    vector<RigidBody> *state = &m_currentState;
     state->erase(state->begin(), state->end());
+    m_structureChanged = true;
+    m_bodyPairs.clear();
+    m_groundPairs.clear();
+    m_staticPairs.clear();
+    m_ignoredPairs.clear();
     m_activeRigidBody = -1;
 }
 
+void Simulation::addStaticBody(Mesh *mesh, const glm::vec3 &position, const glm::quat &orientation, const glm::vec3 &scale) {
+    RigidBody rb = RigidBody(position, orientation, scale);
+    rb.setMesh(mesh);
+    rb.setStatic(true);
+    rb.setMaterial(Assets::getWhiteMaterial());
+    
+    m_staticBodies.push_back(rb);
+    m_staticPairs.clear();
+}
+
+void Simulation::removeAllStaticBodies() {
+    m_staticBodies = vector<RigidBody>();
+    m_staticPairs.clear();
+}
+
+vector<RigidBody> *Simulation::getStaticBodies() {
+    return &m_staticBodies;
+}
+
+void Simulation::setActiveRigidBody(int index) {
+    if (index < 0 || index >= (int)m_currentState.size() || index == m_activeRigidBody) {
+        return;
+    }
+    if (getActiveRigidBody() != nullptr) {
+        getActiveRigidBody()->isCurrentlyActive = false;
+        getActiveRigidBody()->setMaterial(Assets::getWhiteMaterial());
+    }
+    m_activeRigidBody = index;
+    getActiveRigidBody()->isCurrentlyActive = true;
+    getActiveRigidBody()->setMaterial(Assets::getSlightlyGreenMaterial());
+}
+
 void Simulation::toggleActiveRigidBody() {
-    vector<RigidBody> *state = &m_simulationStates.back();
+    vector<RigidBody> *state = &m_currentState;
     
     if (m_activeRigidBody < 0) {
         return;
@@ -145,8 +692,12 @@ void Simulation::addRigidBody(int type, bool rotating, bool upsidedown, float xO
     RigidBody rb;
     RigidBodyFactory::resetSpinningTop(rb, type, rotating, upsidedown, xOffset, yOffset);
     
-    vector<RigidBody> *state = &m_simulationStates.back();
+    vector<RigidBody> *state = &m_currentState;
     state->push_back(rb);
+    m_structureChanged = true;
+    m_bodyPairs.clear();
+    m_groundPairs.clear();
+    m_staticPairs.clear();
     
     if (m_activeRigidBody == -1) {
         m_activeRigidBody = 0;
@@ -155,6 +706,41 @@ void Simulation::addRigidBody(int type, bool rotating, bool upsidedown, float xO
     }
 }
 
+bool Simulation::raycast(const Ray &ray, RayHit &hit) {
+    hit = RayHit();
+    RaycastBody prepared;
+    for (size_t i = 0; i < m_currentState.size(); ++i) {
+        if (prepareRaycast(m_currentState[i], prepared)) {
+            raycastBody(prepared, ray, (int)i, false, hit);
+        }
+    }
+    for (size_t i = 0; i < m_staticBodies.size(); ++i) {
+        if (prepareRaycast(m_staticBodies[i], prepared)) {
+            raycastBody(prepared, ray, (int)i, true, hit);
+        }
+    }
+    return hit.hit;
+}
+
+void Simulation::raycast(const std::vector<Ray> &rays, std::vector<RayHit> &hits) {
+    hits = std::vector<RayHit>(rays.size());
+    RaycastBody prepared;
+    for (size_t i = 0; i < m_currentState.size(); ++i) {
+        if (prepareRaycast(m_currentState[i], prepared)) {
+            for (size_t j = 0; j < rays.size(); ++j) {
+                raycastBody(prepared, rays[j], (int)i, false, hits[j]);
+            }
+        }
+    }
+    for (size_t i = 0; i < m_staticBodies.size(); ++i) {
+        if (prepareRaycast(m_staticBodies[i], prepared)) {
+            for (size_t j = 0; j < rays.size(); ++j) {
+                raycastBody(prepared, rays[j], (int)i, true, hits[j]);
+            }
+        }
+    }
+}
+
 std::vector<DebugPoint> Simulation::getDebugPoints() {
     return m_debugPoints;
 }
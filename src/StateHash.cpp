@@ -0,0 +1,100 @@
+#include "StateHash.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+    const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+    const uint64_t FNV_PRIME = 1099511628211ull;
+
+    void hashBytes(uint64_t &hash, const void *data, size_t size) {
+        const unsigned char *bytes = (const unsigned char *)data;
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= FNV_PRIME;
+        }
+    }
+
+    void hashFloats(uint64_t &hash, const float *values, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t bits;
+            memcpy(&bits, &values[i], sizeof(bits));
+            hashBytes(hash, &bits, sizeof(bits));
+        }
+    }
+}
+
+uint64_t StateHash::hash(const std::vector<RigidBody> &state) {
+    uint64_t hash = FNV_OFFSET_BASIS;
+
+    uint64_t count = state.size();
+    hashBytes(hash, &count, sizeof(count));
+
+    for (size_t i = 0; i < state.size(); ++i) {
+        const RigidBody &rb = state[i];
+
+        glm::vec3 position = rb.getPosition();
+        glm::quat orientation = rb.getOrientation();
+        glm::vec3 linearMomentum = rb.getLinearMomentum();
+        glm::vec3 angularMomentum = rb.getAngularMomentum();
+
+        float values[13] = {position.x, position.y, position.z,
+                            orientation.w, orientation.x, orientation.y, orientation.z,
+                            linearMomentum.x, linearMomentum.y, linearMomentum.z,
+                            angularMomentum.x, angularMomentum.y, angularMomentum.z};
+        hashFloats(hash, values, 13);
+    }
+
+    return hash;
+}
+
+bool StateHash::write(const std::string &filename, const std::vector<uint64_t> &hashes) {
+    FILE *file = fopen(filename.c_str(), "w");
+    if (file == nullptr) {
+        printf("ERROR: Could not write state hashes to %s.\n", filename.c_str());
+        return false;
+    }
+
+    for (size_t i = 0; i < hashes.size(); ++i) {
+        fprintf(file, "%016" PRIx64 "\n", hashes[i]);
+    }
+
+    fclose(file);
+    return true;
+}
+
+bool StateHash::read(const std::string &filename, std::vector<uint64_t> &hashes) {
+    FILE *file = fopen(filename.c_str(), "r");
+    if (file == nullptr) {
+        printf("ERROR: Could not read state hashes from %s.\n", filename.c_str());
+        return false;
+    }
+
+    hashes.clear();
+
+    uint64_t hash;
+    while (fscanf(file, "%" SCNx64, &hash) == 1) {
+        hashes.push_back(hash);
+    }
+
+    fclose(file);
+    return true;
+}
+
+long StateHash::firstDivergence(const std::vector<uint64_t> &a, const std::vector<uint64_t> &b) {
+    size_t count = std::min(a.size(), b.size());
+
+    for (size_t i = 0; i < count; ++i) {
+        if (a[i] != b[i]) {
+            return (long)i;
+        }
+    }
+
+    if (a.size() != b.size()) {
+        return (long)count;
+    }
+
+    return -1;
+}
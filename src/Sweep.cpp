@@ -0,0 +1,186 @@
+#include "Sweep.h"
+
+#include "Simulation.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+Sweep::Sweep(const SweepConfig &config) {
+    m_config = config;
+}
+
+bool Sweep::parseArguments(int argc, char *argv[], SweepConfig &config) {
+    for (int i = 0; i < argc; ++i) {
+        const char *separator = strchr(argv[i], '=');
+        if (separator == nullptr) {
+            printf("ERROR: Argument '%s' is not of the form key=value.\n", argv[i]);
+            return false;
+        }
+
+        std::string key = std::string(argv[i], separator - argv[i]);
+        std::string value = std::string(separator + 1);
+
+        if (key == "samples") {
+            config.samples = atoi(value.c_str());
+        } else if (key == "out") {
+            config.output = value;
+        } else if (value.find(':') != std::string::npos) {
+            SweepRange range;
+            range.name = key;
+            range.steps = 2;
+
+            float unused;
+            if (!config.scene.parameters.get(key, unused) ||
+                sscanf(value.c_str(), "%f:%f:%d", &range.min, &range.max, &range.steps) < 2) {
+                printf("ERROR: Invalid range '%s'. Expected parameter=min:max:steps.\n", argv[i]);
+                return false;
+            }
+
+            range.steps = std::max(1, range.steps);
+            config.ranges.push_back(range);
+        } else if (!Ensemble::parseArgument(key, value, config.scene)) {
+            return false;
+        }
+    }
+
+    return Ensemble::loadHeightfield(config.scene);
+}
+
+std::vector<Parameters> Sweep::createConfigurations() const {
+    std::vector<Parameters> configurations = std::vector<Parameters>();
+
+    if (m_config.samples > 0) {
+        std::mt19937 random(m_config.scene.seed);
+        std::uniform_real_distribution<float> uniform(0.f, 1.f);
+
+        for (int i = 0; i < m_config.samples; ++i) {
+            Parameters parameters = m_config.scene.parameters;
+            for (size_t j = 0; j < m_config.ranges.size(); ++j) {
+                const SweepRange &range = m_config.ranges[j];
+                parameters.set(range.name, range.min + uniform(random) * (range.max - range.min));
+            }
+            configurations.push_back(parameters);
+        }
+    } else {
+        size_t count = 1;
+        for (size_t j = 0; j < m_config.ranges.size(); ++j) {
+            count *= m_config.ranges[j].steps;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            Parameters parameters = m_config.scene.parameters;
+
+            // the first range changes fastest
+            size_t index = i;
+            for (size_t j = 0; j < m_config.ranges.size(); ++j) {
+                const SweepRange &range = m_config.ranges[j];
+                int step = (int)(index % range.steps);
+                index /= range.steps;
+
+                float alpha = range.steps > 1 ? (float)step / (range.steps - 1) : 0.f;
+                parameters.set(range.name, range.min + alpha * (range.max - range.min));
+            }
+            configurations.push_back(parameters);
+        }
+    }
+
+    return configurations;
+}
+
+void Sweep::run() {
+    std::vector<Parameters> configurations = createConfigurations();
+    int runs = std::max(1, m_config.scene.runs);
+
+    // Meshes and textures need the GL context of this thread. Load them (and the shared shape) before starting the workers.
+    Simulation warmup;
+    warmup.addRigidBody(m_config.scene.type, m_config.scene.rotating, m_config.scene.upsidedown, 0, 0);
+
+    ThreadPool pool(m_config.scene.threads);
+    printf("Info: Sweeping %lu configurations with %d runs each on %u threads.\n", configurations.size(), runs, pool.getNumberOfThreads());
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // every run of every configuration is a task of its own, which balances the load better than one task per configuration
+    std::vector<EnsembleResult> runResults = std::vector<EnsembleResult>(configurations.size() * runs);
+    pool.parallelFor(runResults.size(), [this, &configurations, &runResults, runs](size_t i) {
+        EnsembleConfig scene = m_config.scene;
+        scene.parameters = configurations[i / runs];
+        runResults[i] = Ensemble::simulate(scene, (int)(i % runs));
+    });
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    m_results = std::vector<SweepResult>();
+    for (size_t i = 0; i < configurations.size(); ++i) {
+        SweepResult result;
+        result.parameters = configurations[i];
+        result.toppled = 0;
+        result.meanTimeToTopple = 0;
+        result.meanSpinLifetime = 0;
+        result.meanFinalTilt = 0;
+        result.meanFinalHeight = 0;
+
+        for (int j = 0; j < runs; ++j) {
+            const EnsembleResult &run = runResults[i * runs + j];
+            if (run.timeToTopple >= 0) {
+                result.toppled++;
+                result.meanTimeToTopple += run.timeToTopple;
+            }
+            result.meanSpinLifetime += run.spinLifetime / runs;
+            result.meanFinalTilt += run.finalTilt / runs;
+            result.meanFinalHeight += run.finalPosition.y / runs;
+        }
+
+        if (result.toppled > 0) {
+            result.meanTimeToTopple /= result.toppled;
+        }
+
+        m_results.push_back(result);
+    }
+
+    printf("Sweep: %lu configurations (%lu scenes) in %.2f s (%.0f scenes/hour)\n", m_results.size(), runResults.size(), seconds, seconds > 0 ? runResults.size() / seconds * 3600.0 : 0.0);
+
+    if (!m_config.output.empty()) {
+        writeResults(m_config.output);
+    }
+}
+
+const std::vector<SweepResult> &Sweep::getResults() const {
+    return m_results;
+}
+
+bool Sweep::writeResults(const std::string &filename) const {
+    FILE *file = fopen(filename.c_str(), "w");
+    if (file == nullptr) {
+        printf("ERROR: Could not write sweep results to %s.\n", filename.c_str());
+        return false;
+    }
+
+    std::vector<std::string> names = Parameters::getNames();
+
+    fprintf(file, "configuration");
+    for (size_t i = 0; i < names.size(); ++i) {
+        fprintf(file, ",%s", names[i].c_str());
+    }
+    fprintf(file, ",toppled,meanTimeToTopple,meanSpinLifetime,meanFinalTilt,meanFinalHeight\n");
+
+    for (size_t i = 0; i < m_results.size(); ++i) {
+        const SweepResult &result = m_results[i];
+
+        fprintf(file, "%lu", i);
+        for (size_t j = 0; j < names.size(); ++j) {
+            float value = 0;
+            result.parameters.get(names[j], value);
+            fprintf(file, ",%g", value);
+        }
+        fprintf(file, ",%d,%f,%f,%f,%f\n", result.toppled, result.meanTimeToTopple, result.meanSpinLifetime, result.meanFinalTilt, result.meanFinalHeight);
+    }
+
+    fclose(file);
+    return true;
+}
@@ -8,14 +8,18 @@ int Texture::nextTextureUnit = 0;
 Texture::Texture(const std::string &texturePath) {
     m_textureUnit = Texture::nextTextureUnit;
     Texture::nextTextureUnit++;
-    
+    m_path = texturePath;
+    m_textureID = 0;
+}
+
+void Texture::upload() {
     glGenTextures(1, &m_textureID);
     
     glActiveTexture(GL_TEXTURE0 + m_textureUnit);
     glBindTexture(GL_TEXTURE_2D, m_textureID);
     
     int width, height, channels;
-    uint8_t *image = stbi_load(texturePath.c_str(), &width, &height, &channels, 0);
+    uint8_t *image = stbi_load(m_path.c_str(), &width, &height, &channels, 0);
     
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
     glGenerateMipmap(GL_TEXTURE_2D);
@@ -78,6 +82,9 @@ GLint Texture::getTextureID() const {
 }
 
 void Texture::use() {
+    if (m_textureID == 0 && !m_path.empty()) {
+        upload();
+    }
     glActiveTexture(GL_TEXTURE0 + m_textureUnit);
     // glBindTexture(GL_TEXTURE_2D, m_textureID);
 }
\ No newline at end of file
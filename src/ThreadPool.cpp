@@ -0,0 +1,131 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+// queue of the current thread, if it is a worker of some pool
+static thread_local ThreadPool *currentPool = nullptr;
+static thread_local size_t currentQueue = 0;
+
+ThreadPool::ThreadPool(unsigned int numberOfThreads) {
+    if (numberOfThreads == 0) {
+        numberOfThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    m_pendingTasks = 0;
+    m_nextQueue = 0;
+    m_stop = false;
+
+    // the last queue is shared by all threads which are not workers of this pool
+    for (unsigned int i = 0; i < numberOfThreads + 1; ++i) {
+        m_queues.push_back(std::unique_ptr<Queue>(new Queue()));
+    }
+
+    for (unsigned int i = 0; i < numberOfThreads; ++i) {
+        m_threads.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+
+    for (size_t i = 0; i < m_threads.size(); ++i) {
+        m_threads[i].join();
+    }
+}
+
+unsigned int ThreadPool::getNumberOfThreads() const {
+    return (unsigned int)m_threads.size();
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)> &task) {
+    if (count == 0) {
+        return;
+    }
+
+    bool isWorker = currentPool == this;
+    size_t ownQueue = isWorker ? currentQueue : m_queues.size() - 1;
+
+    std::atomic<size_t> remaining(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        // Workers keep their tasks local, the others steal them. Outside threads spread them round robin.
+        size_t queue = isWorker ? ownQueue : m_nextQueue++ % m_threads.size();
+        push(queue, [&task, &remaining, i]() {
+            task(i);
+            remaining--;
+        });
+    }
+
+    // help until all our tasks are done
+    while (remaining > 0) {
+        if (!runPendingTask(ownQueue)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void ThreadPool::push(size_t queue, std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(m_queues[queue]->mutex);
+        m_queues[queue]->tasks.push_back(task);
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_pendingTasks++;
+    }
+    m_wake.notify_one();
+}
+
+bool ThreadPool::runPendingTask(size_t queue) {
+    std::function<void()> task;
+
+    // newest task of our own queue first
+    {
+        std::lock_guard<std::mutex> lock(m_queues[queue]->mutex);
+        if (!m_queues[queue]->tasks.empty()) {
+            task = m_queues[queue]->tasks.back();
+            m_queues[queue]->tasks.pop_back();
+        }
+    }
+
+    // otherwise steal the oldest task of another queue
+    for (size_t i = 1; !task && i < m_queues.size(); ++i) {
+        Queue *victim = m_queues[(queue + i) % m_queues.size()].get();
+
+        std::lock_guard<std::mutex> lock(victim->mutex);
+        if (!victim->tasks.empty()) {
+            task = victim->tasks.front();
+            victim->tasks.pop_front();
+        }
+    }
+
+    if (!task) {
+        return false;
+    }
+
+    m_pendingTasks--;
+    task();
+    return true;
+}
+
+void ThreadPool::workerLoop(size_t queue) {
+    currentPool = this;
+    currentQueue = queue;
+
+    while (true) {
+        if (runPendingTask(queue)) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_wake.wait(lock, [this]() { return m_stop || m_pendingTasks > 0; });
+
+        if (m_stop) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,361 @@
+#include "TriangleBatch.h"
+
+#if defined(__AVX__)
+    #include <immintrin.h>
+    #define TRIANGLE_BATCH_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define TRIANGLE_BATCH_SSE
+#endif
+
+const size_t MAX_WIDTH = 8;
+
+// same epsilon as IntersectionTest::intersectionRayTriangle
+const float RAY_EPSILON = 0.000001;
+
+namespace {
+
+    // The lane types offer the same operations for one float (scalar), 4 floats (SSE) and 8 floats (AVX).
+    // Comparisons are ordered (false for NaN) like the scalar comparisons of the original test.
+
+    struct ScalarLanes {
+        typedef float F;
+        typedef bool M;
+        static const int WIDTH = 1;
+
+        static F load(const float *p) { return *p; }
+        static F set1(float x) { return x; }
+        static F add(F a, F b) { return a + b; }
+        static F sub(F a, F b) { return a - b; }
+        static F mul(F a, F b) { return a * b; }
+        static F div(F a, F b) { return a / b; }
+        static M lt(F a, F b) { return a < b; }
+        static M gt(F a, F b) { return a > b; }
+        static M le(F a, F b) { return a <= b; }
+        static M both(M a, M b) { return a && b; }
+        static M either(M a, M b) { return a || b; }
+        static M andNot(M a, M b) { return !a && b; }   // !a && b
+        static M all() { return true; }
+        static int bits(M m) { return m ? 1 : 0; }
+        static void store(float *p, F a) { *p = a; }
+    };
+
+#if defined(TRIANGLE_BATCH_SSE) || defined(TRIANGLE_BATCH_AVX)
+    struct SSELanes {
+        typedef __m128 F;
+        typedef __m128 M;
+        static const int WIDTH = 4;
+
+        static F load(const float *p) { return _mm_loadu_ps(p); }
+        static F set1(float x) { return _mm_set1_ps(x); }
+        static F add(F a, F b) { return _mm_add_ps(a, b); }
+        static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+        static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+        static F div(F a, F b) { return _mm_div_ps(a, b); }
+        static M lt(F a, F b) { return _mm_cmplt_ps(a, b); }
+        static M gt(F a, F b) { return _mm_cmpgt_ps(a, b); }
+        static M le(F a, F b) { return _mm_cmple_ps(a, b); }
+        static M both(M a, M b) { return _mm_and_ps(a, b); }
+        static M either(M a, M b) { return _mm_or_ps(a, b); }
+        static M andNot(M a, M b) { return _mm_andnot_ps(a, b); }
+        static M all() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+        static int bits(M m) { return _mm_movemask_ps(m); }
+        static void store(float *p, F a) { _mm_storeu_ps(p, a); }
+    };
+#endif
+
+#if defined(TRIANGLE_BATCH_AVX)
+    struct AVXLanes {
+        typedef __m256 F;
+        typedef __m256 M;
+        static const int WIDTH = 8;
+
+        static F load(const float *p) { return _mm256_loadu_ps(p); }
+        static F set1(float x) { return _mm256_set1_ps(x); }
+        static F add(F a, F b) { return _mm256_add_ps(a, b); }
+        static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+        static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+        static F div(F a, F b) { return _mm256_div_ps(a, b); }
+        static M lt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+        static M gt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+        static M le(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+        static M both(M a, M b) { return _mm256_and_ps(a, b); }
+        static M either(M a, M b) { return _mm256_or_ps(a, b); }
+        static M andNot(M a, M b) { return _mm256_andnot_ps(a, b); }
+        static M all() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+        static int bits(M m) { return _mm256_movemask_ps(m); }
+        static void store(float *p, F a) { _mm256_storeu_ps(p, a); }
+    };
+#endif
+
+    template <class L>
+    struct Lanes3 {
+        typename L::F x, y, z;
+    };
+
+    template <class L>
+    Lanes3<L> broadcast(const glm::vec3 &v) {
+        Lanes3<L> r;
+        r.x = L::set1(v.x);
+        r.y = L::set1(v.y);
+        r.z = L::set1(v.z);
+        return r;
+    }
+
+    template <class L>
+    Lanes3<L> load(const TriangleBatch &batch, TriangleBatch::Row x, size_t first) {
+        Lanes3<L> r;
+        r.x = L::load(batch.getRow(x) + first);
+        r.y = L::load(batch.getRow((TriangleBatch::Row)(x + 1)) + first);
+        r.z = L::load(batch.getRow((TriangleBatch::Row)(x + 2)) + first);
+        return r;
+    }
+
+    // same order of operations as glm::cross and glm::dot, so the results are bitwise equal to the scalar test
+    template <class L>
+    Lanes3<L> cross(const Lanes3<L> &a, const Lanes3<L> &b) {
+        Lanes3<L> r;
+        r.x = L::sub(L::mul(a.y, b.z), L::mul(b.y, a.z));
+        r.y = L::sub(L::mul(a.z, b.x), L::mul(b.z, a.x));
+        r.z = L::sub(L::mul(a.x, b.y), L::mul(b.x, a.y));
+        return r;
+    }
+
+    template <class L>
+    typename L::F dot(const Lanes3<L> &a, const Lanes3<L> &b) {
+        return L::add(L::add(L::mul(a.x, b.x), L::mul(a.y, b.y)), L::mul(a.z, b.z));
+    }
+
+    template <class L>
+    Lanes3<L> sub(const Lanes3<L> &a, const Lanes3<L> &b) {
+        Lanes3<L> r;
+        r.x = L::sub(a.x, b.x);
+        r.y = L::sub(a.y, b.y);
+        r.z = L::sub(a.z, b.z);
+        return r;
+    }
+
+    // IntersectionTest::intersectionRayTriangle without early exits
+    template <class L>
+    typename L::M rayTriangle(const Lanes3<L> &point1, const Lanes3<L> &e1, const Lanes3<L> &e2,
+                              const Lanes3<L> &origin, const Lanes3<L> &direction, typename L::F &t) {
+        typename L::F eps = L::set1(RAY_EPSILON);
+        typename L::F zero = L::set1(0.f);
+        typename L::F one = L::set1(1.f);
+
+        Lanes3<L> P = cross(direction, e2);
+        typename L::F det = dot(e1, P);
+        typename L::M valid = L::andNot(L::both(L::gt(det, L::set1(-RAY_EPSILON)), L::lt(det, eps)), L::all());
+        typename L::F invDet = L::div(one, det);
+
+        Lanes3<L> T = sub(origin, point1);
+
+        typename L::F u = L::mul(dot(T, P), invDet);
+        valid = L::andNot(L::either(L::lt(u, zero), L::gt(u, one)), valid);
+
+        Lanes3<L> Q = cross(T, e1);
+
+        typename L::F v = L::mul(dot(direction, Q), invDet);
+        valid = L::andNot(L::either(L::lt(v, zero), L::gt(L::add(u, v), one)), valid);
+
+        t = L::mul(dot(e2, Q), invDet);
+
+        return L::both(valid, L::gt(t, eps));
+    }
+
+    // plus the 0 <= t <= 1 check of intersectionTriangleTriangle (t > eps implies t >= 0)
+    template <class L>
+    typename L::M segmentTriangle(const Lanes3<L> &point1, const Lanes3<L> &e1, const Lanes3<L> &e2,
+                                  const Lanes3<L> &origin, const Lanes3<L> &direction, typename L::F &t) {
+        typename L::M hit = rayTriangle<L>(point1, e1, e2, origin, direction, t);
+        return L::both(hit, L::le(t, L::set1(1.f)));
+    }
+
+    template <class L>
+    bool intersectRayLanes(const glm::vec3 &origin, const glm::vec3 &direction, const TriangleBatch &batch, float &nearest, size_t &index) {
+        Lanes3<L> o = broadcast<L>(origin);
+        Lanes3<L> d = broadcast<L>(direction);
+
+        bool found = false;
+        for (size_t first = 0; first < batch.size(); first += L::WIDTH) {
+            Lanes3<L> b1 = load<L>(batch, TriangleBatch::V1X, first);
+            Lanes3<L> bE12 = load<L>(batch, TriangleBatch::E12X, first);
+            Lanes3<L> bE13 = load<L>(batch, TriangleBatch::E13X, first);
+
+            typename L::F t;
+            typename L::M hit = rayTriangle<L>(b1, bE12, bE13, o, d, t);
+            int bits = L::bits(L::both(hit, L::lt(t, L::set1(nearest))));
+            if (bits == 0) {
+                continue;
+            }
+
+            float ts[MAX_WIDTH];
+            L::store(ts, t);
+            for (int lane = 0; lane < L::WIDTH && first + lane < batch.size(); ++lane) {
+                if ((bits >> lane & 1) != 0 && ts[lane] < nearest) {
+                    nearest = ts[lane];
+                    index = first + lane;
+                    found = true;
+                }
+            }
+        }
+        return found;
+    }
+
+    glm::vec3 column(const TriangleBatch &batch, TriangleBatch::Row x, size_t i) {
+        return glm::vec3(batch.getRow(x)[i], batch.getRow((TriangleBatch::Row)(x + 1))[i], batch.getRow((TriangleBatch::Row)(x + 2))[i]);
+    }
+
+    template <class L>
+    void intersectLanes(const Triangle &one, const TriangleBatch &batch, std::vector<TriangleHit> &hits) {
+        glm::vec3 oneE12 = one.vertex2 - one.vertex1;
+        glm::vec3 oneE13 = one.vertex3 - one.vertex1;
+        glm::vec3 oneE23 = one.vertex3 - one.vertex2;
+
+        Lanes3<L> a1 = broadcast<L>(one.vertex1);
+        Lanes3<L> a2 = broadcast<L>(one.vertex2);
+        Lanes3<L> aE12 = broadcast<L>(oneE12);
+        Lanes3<L> aE13 = broadcast<L>(oneE13);
+        Lanes3<L> aE23 = broadcast<L>(oneE23);
+
+        for (size_t first = 0; first < batch.size(); first += L::WIDTH) {
+            Lanes3<L> b1 = load<L>(batch, TriangleBatch::V1X, first);
+            Lanes3<L> b2 = load<L>(batch, TriangleBatch::V2X, first);
+            Lanes3<L> bE12 = load<L>(batch, TriangleBatch::E12X, first);
+            Lanes3<L> bE13 = load<L>(batch, TriangleBatch::E13X, first);
+            Lanes3<L> bE23 = load<L>(batch, TriangleBatch::E23X, first);
+
+            // the six tests of intersectionTriangleTriangle: edges of two against one, then edges of one against two
+            typename L::F t[6];
+            int bits[6];
+            bits[0] = L::bits(segmentTriangle<L>(a1, aE12, aE13, b1, bE12, t[0]));
+            bits[1] = L::bits(segmentTriangle<L>(a1, aE12, aE13, b1, bE13, t[1]));
+            bits[2] = L::bits(segmentTriangle<L>(a1, aE12, aE13, b2, bE23, t[2]));
+            bits[3] = L::bits(segmentTriangle<L>(b1, bE12, bE13, a1, aE12, t[3]));
+            bits[4] = L::bits(segmentTriangle<L>(b1, bE12, bE13, a1, aE13, t[4]));
+            bits[5] = L::bits(segmentTriangle<L>(b1, bE12, bE13, a2, aE23, t[5]));
+
+            if ((bits[0] | bits[1] | bits[2] | bits[3] | bits[4] | bits[5]) == 0) {
+                continue;
+            }
+
+            float ts[6][MAX_WIDTH];
+            for (int k = 0; k < 6; ++k) {
+                L::store(ts[k], t[k]);
+            }
+
+            for (int lane = 0; lane < L::WIDTH && first + lane < batch.size(); ++lane) {
+                size_t i = first + lane;
+
+                // the first test that hits decides, like the early returns of the scalar test
+                for (int k = 0; k < 6; ++k) {
+                    if ((bits[k] >> lane & 1) == 0) {
+                        continue;
+                    }
+
+                    float tk = ts[k][lane];
+
+                    TriangleHit hit;
+                    hit.index = i;
+                    if (k == 0) {
+                        hit.point = column(batch, TriangleBatch::V1X, i) + tk * column(batch, TriangleBatch::E12X, i);
+                    } else if (k == 1) {
+                        hit.point = column(batch, TriangleBatch::V1X, i) + tk * column(batch, TriangleBatch::E13X, i);
+                    } else if (k == 2) {
+                        hit.point = column(batch, TriangleBatch::V2X, i) + tk * column(batch, TriangleBatch::E23X, i);
+                    } else if (k == 3) {
+                        hit.point = one.vertex1 + tk * oneE12;
+                    } else if (k == 4) {
+                        hit.point = one.vertex1 + tk * oneE13;
+                    } else {
+                        hit.point = one.vertex2 + tk * oneE23;
+                    }
+                    hit.normal = k < 3 ? one.normal : column(batch, TriangleBatch::NX, i);
+
+                    hits.push_back(hit);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+TriangleBatch::TriangleBatch() {
+    m_size = 0;
+    m_paddedSize = 0;
+}
+
+TriangleBatch::TriangleBatch(const std::vector<Triangle> &triangles) {
+    m_size = triangles.size();
+    m_paddedSize = (m_size + MAX_WIDTH - 1) / MAX_WIDTH * MAX_WIDTH;
+
+    // the padding are degenerated triangles, which never intersect
+    m_data = std::vector<float>(NUMBER_OF_ROWS * m_paddedSize, 0.f);
+
+    for (size_t i = 0; i < m_size; ++i) {
+        const Triangle &t = triangles[i];
+        glm::vec3 rows[6] = {t.vertex1, t.vertex2, t.vertex2 - t.vertex1, t.vertex3 - t.vertex1, t.vertex3 - t.vertex2, t.normal};
+
+        for (int r = 0; r < 6; ++r) {
+            m_data[(3 * r + 0) * m_paddedSize + i] = rows[r].x;
+            m_data[(3 * r + 1) * m_paddedSize + i] = rows[r].y;
+            m_data[(3 * r + 2) * m_paddedSize + i] = rows[r].z;
+        }
+    }
+}
+
+size_t TriangleBatch::size() const {
+    return m_size;
+}
+
+const float *TriangleBatch::getRow(Row row) const {
+    return m_data.data() + row * m_paddedSize;
+}
+
+void TriangleBatch::intersect(const Triangle &one, std::vector<TriangleHit> &hits) const {
+#if defined(TRIANGLE_BATCH_AVX)
+    intersectLanes<AVXLanes>(one, *this, hits);
+#elif defined(TRIANGLE_BATCH_SSE)
+    intersectLanes<SSELanes>(one, *this, hits);
+#else
+    intersectLanes<ScalarLanes>(one, *this, hits);
+#endif
+}
+
+void TriangleBatch::intersectScalar(const Triangle &one, std::vector<TriangleHit> &hits) const {
+    intersectLanes<ScalarLanes>(one, *this, hits);
+}
+
+bool TriangleBatch::intersectRay(const glm::vec3 &origin, const glm::vec3 &direction, float &t, size_t &index) const {
+#if defined(TRIANGLE_BATCH_AVX)
+    return intersectRayLanes<AVXLanes>(origin, direction, *this, t, index);
+#elif defined(TRIANGLE_BATCH_SSE)
+    return intersectRayLanes<SSELanes>(origin, direction, *this, t, index);
+#else
+    return intersectRayLanes<ScalarLanes>(origin, direction, *this, t, index);
+#endif
+}
+
+bool TriangleBatch::intersectRayScalar(const glm::vec3 &origin, const glm::vec3 &direction, float &t, size_t &index) const {
+    return intersectRayLanes<ScalarLanes>(origin, direction, *this, t, index);
+}
+
+const char *TriangleBatch::getInstructionSet() {
+#if defined(TRIANGLE_BATCH_AVX)
+    return "AVX";
+#elif defined(TRIANGLE_BATCH_SSE)
+    return "SSE";
+#else
+    return "scalar";
+#endif
+}
+
+int TriangleBatch::getWidth() {
+#if defined(TRIANGLE_BATCH_AVX)
+    return AVXLanes::WIDTH;
+#elif defined(TRIANGLE_BATCH_SSE)
+    return SSELanes::WIDTH;
+#else
+    return ScalarLanes::WIDTH;
+#endif
+}